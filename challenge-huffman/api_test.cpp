@@ -0,0 +1,487 @@
+// Regression test for the in-process library API (huffman.h).
+//
+// Round-trips messages through the buffer, dictionary and stream objects and
+// at every compression level, checks that damaged input is rejected, and
+// counts heap allocations to confirm that warm encoders and decoders don't
+// allocate per call.
+//
+//   ./huff_api_test
+//
+// Exits non-zero if any check fails.
+
+#include "crc32c.h"
+#include "huffman.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::size_t allocations = 0;
+    int failures = 0;
+
+    void check(bool ok, const std::string &what)
+    {
+        std::cout << "  " << what << ": " << (ok ? "PASS" : "FAIL") << "\n";
+        if (!ok)
+            ++failures;
+    }
+
+    template <typename F>
+    bool throws(F &&body)
+    {
+        try
+        {
+            body();
+        }
+        catch (const std::runtime_error &)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // Small JSON-ish messages, the workload the buffer API is meant for
+    std::vector<std::string> makeMessages()
+    {
+        std::vector<std::string> messages;
+        for (int i = 0; i < 64; ++i)
+        {
+            std::string message = "{\"id\":" + std::to_string(i * 7919) + ",\"user\":\"user" +
+                                  std::to_string(i % 13) + "\",\"event\":\"" +
+                                  (i % 3 ? "click" : "view") + "\",\"payload\":\"";
+            message.append(static_cast<std::size_t>(i * 11 % 200), static_cast<char>('a' + i % 26));
+            message += "\"}";
+            messages.push_back(message);
+        }
+        messages.push_back("");
+        messages.push_back("x");
+        return messages;
+    }
+
+    std::string makeStreamInput()
+    {
+        std::string input;
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < 300000; ++i)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            input += static_cast<char>(i % 5 ? 'a' + (state >> 59) : static_cast<char>(state >> 56));
+        }
+        return input;
+    }
+
+    void testBuffers(Codec codec, const std::string &name)
+    {
+        std::vector<std::string> messages = makeMessages();
+        Huffman::Encoder encoder(codec);
+        Huffman::Decoder decoder;
+
+        bool roundTrip = true;
+        for (const std::string &message : messages)
+        {
+            std::string compressed(encoder.encode(message.data(), message.size()));
+            roundTrip &= decoder.decodedSize(compressed.data(), compressed.size()) == message.size();
+            roundTrip &= decoder.decode(compressed.data(), compressed.size()) == message;
+        }
+        check(roundTrip, name + " buffer round trip");
+
+        // After one warm-up pass over the same messages, nothing allocates
+        std::vector<char> compressed(1 << 16);
+        std::vector<char> restored(1 << 16);
+        std::size_t before = allocations;
+        bool steadyRoundTrip = true;
+        for (const std::string &message : messages)
+        {
+            std::string_view view = encoder.encode(message.data(), message.size());
+            std::size_t n = encoder.encode(message.data(), message.size(), compressed.data(), compressed.size());
+            steadyRoundTrip &= view == std::string_view(compressed.data(), n);
+            std::size_t m = decoder.decode(compressed.data(), n, restored.data(), restored.size());
+            steadyRoundTrip &= std::string_view(restored.data(), m) == message;
+            steadyRoundTrip &= decoder.decode(compressed.data(), n) == message;
+        }
+        std::size_t allocated = allocations - before;
+        check(steadyRoundTrip, name + " caller-buffer round trip");
+        check(allocated == 0, name + " no allocation once warm");
+
+        const std::string &big = messages[40];
+        check(throws([&]
+                     { encoder.encode(big.data(), big.size(), compressed.data(), 8); }),
+              name + " rejects a too-small output buffer");
+    }
+
+    // Fibonacci-distributed symbols: order-0 codes run past TABLE_BITS (the
+    // decoder's long-code path); the interleaved codec has to limit them
+    void testLongCodes()
+    {
+        std::string input;
+        uint64_t a = 1, b = 1;
+        for (char sym = 'a'; sym < 'a' + 24; ++sym)
+        {
+            input.append(static_cast<std::size_t>(a), sym);
+            uint64_t next = a + b;
+            a = b;
+            b = next;
+        }
+        // Scattered, so the runs don't make RLE the better choice
+        std::shuffle(input.begin(), input.end(), std::mt19937(42));
+
+        Huffman::Decoder decoder;
+        for (Codec codec : {Codec::Order0, Codec::Interleaved})
+        {
+            Huffman::Encoder encoder(codec);
+            std::string compressed(encoder.encode(input.data(), input.size()));
+            check(decoder.decode(compressed.data(), compressed.size()) == input,
+                  std::string(codec == Codec::Order0 ? "order-0" : "order-0x4") + " long-code round trip");
+        }
+
+        // A length table that oversubscribes the code space must be refused
+        Huffman::Encoder encoder(Codec::Interleaved);
+        std::string damaged(encoder.encode(input.data(), input.size()));
+        // Lengths are the 128 bytes before the 16-byte jump table
+        std::size_t lengths = FileUtils::interleavedHeaderSize(input.size()) - 16 - 128;
+        for (std::size_t i = lengths; i < lengths + 128; ++i)
+            damaged[i] = 0x11;
+        check(throws([&]
+                     { decoder.decode(damaged.data(), damaged.size()); }),
+              "order-0x4 rejects an invalid code length table");
+    }
+
+    // Trailers and index entries are untrusted: offsets that wrap around
+    // 2^64 when added must be refused, not followed out of the buffer
+    void testForgedIndex()
+    {
+        const std::size_t trailerSize = 20;
+        const std::size_t entrySize = 28;
+        Container container;
+
+        // Claims 10 entries ending at the trailer in a 100-byte file
+        std::string forged(100, '\0');
+        std::memcpy(&forged[0], "HUFB", 4);
+        forged[4] = 0;
+        uint32_t blockSize = 1024;
+        std::memcpy(&forged[5], &blockSize, 4);
+        uint32_t numBlocks = 10;
+        uint64_t indexOffset = uint64_t(forged.size() - trailerSize) - 10 * entrySize;
+        std::size_t trailer = forged.size() - trailerSize;
+        std::memcpy(&forged[trailer], &numBlocks, 4);
+        std::memcpy(&forged[trailer + 4], &indexOffset, 8);
+        std::memcpy(&forged[trailer + 16], "HUFI", 4);
+        check(throws([&]
+                     { readContainer(forged.data(), forged.size(), container); }),
+              "container rejects an index that wraps past the file");
+
+        // A block whose offset plus size wraps, under a valid index CRC
+        std::string input(1000, 'x');
+        for (std::size_t i = 0; i < input.size(); ++i)
+            input[i] = static_cast<char>('a' + i * 7 % 26);
+        std::string image;
+        compressContainer(input.data(), input.size(), Codec::Order0, DEFAULT_BLOCK_SIZE,
+                          [&](const char *data, std::size_t size) { image.append(data, size); });
+        check(readContainer(image.data(), image.size(), container), "container index reads back");
+
+        // Detection only: any file can start with "HUFB", and one without a
+        // trailer that checks out is input to compress, not a broken container
+        std::string lookalike = "HUFB plain text that only looks like a block container header.";
+        check(looksLikeContainer(image.data(), image.size()) &&
+                  !looksLikeContainer(lookalike.data(), lookalike.size()) &&
+                  !looksLikeContainer(forged.data(), forged.size()) &&
+                  !looksLikeContainer(image.data(), image.size() - 1),
+              "containers are recognised by a trailer that checks out");
+        check(throws([&]
+                     { readContainer(lookalike.data(), lookalike.size(), container); }),
+              "reading a container without a trailer still fails");
+        trailer = image.size() - trailerSize;
+        std::memcpy(&indexOffset, &image[trailer + 4], 8);
+        uint64_t compressedOffset = ~uint64_t(0) - 8;
+        std::memcpy(&image[indexOffset + 8], &compressedOffset, 8);
+        uint32_t indexCrc = crc32c(image.data() + indexOffset, entrySize);
+        std::memcpy(&image[trailer + 12], &indexCrc, 4);
+        check(throws([&]
+                     { readContainer(image.data(), image.size(), container); }),
+              "container rejects a block offset that wraps");
+    }
+
+    // Per-block mode selection: incompressible blocks are stored, runs are
+    // run-length coded, and every level still round-trips everything
+    void testLevels()
+    {
+        std::string random(100000, '\0');
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for (char &c : random)
+        {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            c = static_cast<char>(state >> 56);
+        }
+        const std::string single(100000, 'a');
+        const std::string text = makeStreamInput();
+        // One container whose blocks need all three modes
+        const std::string mixed = text.substr(0, 70000) + random + single;
+
+        Huffman::Decoder decoder;
+        bool stored = true;
+        bool runs = true;
+        bool roundTrip = true;
+        for (int level = MIN_LEVEL; level <= MAX_LEVEL; ++level)
+        {
+            Huffman::Encoder encoder(Codec::Order0, level);
+            std::string compressed(encoder.encode(random.data(), random.size()));
+            stored &= compressed.compare(0, 4, "HUFR") == 0 &&
+                      compressed.size() == FileUtils::rawHeaderSize(random.size()) + random.size();
+            roundTrip &= decoder.decode(compressed.data(), compressed.size()) == random;
+
+            compressed = std::string(encoder.encode(single.data(), single.size()));
+            runs &= level < 3 || (compressed.compare(0, 4, "HUFL") == 0 && compressed.size() < 16);
+            roundTrip &= decoder.decode(compressed.data(), compressed.size()) == single;
+
+            compressed = std::string(encoder.encode(text.data(), text.size()));
+            roundTrip &= compressed.size() < text.size() && decoder.decode(compressed.data(), compressed.size()) == text;
+
+            compressed.clear();
+            compressContainer(mixed.data(), mixed.size(), Codec::Order1, 1 << 16,
+                              [&compressed](const char *data, std::size_t size)
+                              { compressed.append(data, size); },
+                              level);
+            roundTrip &= decoder.decode(compressed.data(), compressed.size()) == mixed;
+        }
+        check(stored, "random data is stored raw at every level");
+        check(runs, "single-symbol data is run-length coded from level 3");
+        check(roundTrip, "every level round-trips raw, RLE and Huffman blocks");
+
+        Huffman::Encoder encoder;
+        std::string damaged(encoder.encode(single.data(), single.size()));
+        damaged.back() ^= 0x01;
+        check(throws([&]
+                     { decoder.decode(damaged.data(), damaged.size()); }),
+              "RLE decoder rejects runs that don't add up");
+
+        // Plain text that happens to start with a mode magic is not an image
+        std::string extended(encoder.encode(single.data(), single.size()));
+        extended += '\n';
+        const char raw[] = "HUFR\x05hello world";
+        const char rle[] = "HUFL\x03\x02a\x03";
+        check(throws([&]
+                     { decoder.decode(raw, sizeof(raw) - 1); }) &&
+                  throws([&]
+                         { decoder.decode(rle, sizeof(rle) - 1); }) &&
+                  throws([&]
+                         { decoder.decode(extended.data(), extended.size()); }),
+              "raw and RLE images must fill the input exactly");
+
+        // The same for interleaved images, which huff would otherwise try
+        // to decompress from any long enough file starting "HUF4"
+        auto isImage = [](const std::string &data)
+        {
+            CompressedHeader header;
+            return FileUtils::parseCompressedHeader(data.data(), data.size(), header) && isExactImage(header);
+        };
+        std::string lookalike = "HUF4";
+        while (lookalike.size() < 300)
+            lookalike += "plain text that only looks like an interleaved header. ";
+        Huffman::Encoder interleaved(Codec::Interleaved);
+        std::string image(interleaved.encode(lookalike.data(), lookalike.size()));
+        std::string padded = image + "x";
+        check(image.compare(0, 4, "HUF4") == 0 && isImage(image) && !isImage(lookalike) && !isImage(padded),
+              "interleaved images must have a valid code table and fill the input");
+    }
+
+    void testDictionary()
+    {
+        std::vector<std::string> messages = makeMessages();
+        DictionaryTrainer trainer;
+        for (std::size_t i = 0; i < messages.size(); i += 2)
+            trainer.addSample(messages[i].data(), messages[i].size());
+        DictionaryPtr trained = trainer.build();
+
+        const char *path = "huff_api_test.hufd";
+        saveDictionary(*trained, path);
+        DictionaryPtr dictionary = loadDictionary(path);
+        std::remove(path);
+        check(dictionary->id == trained->id && dictionary->frequencies == trained->frequencies,
+              "dictionary file round trip");
+        check(loadDictionary(path) == dictionary, "loaded dictionaries are cached");
+
+        Huffman::Encoder encoder(dictionary);
+        EncodePlan plain;
+        Huffman::Decoder decoder;
+        std::size_t dictionaryBytes = 0;
+        std::size_t plainBytes = 0;
+        bool roundTrip = true;
+        for (const std::string &message : messages)
+        {
+            std::string compressed(encoder.encode(message.data(), message.size()));
+            dictionaryBytes += compressed.size();
+            // Huffman coded with the message's own table, never stored
+            planCompression(message.data(), message.size(), Codec::Order0, plain);
+            plainBytes += plain.compressedSize;
+            roundTrip &= decoder.decode(compressed.data(), compressed.size()) == message;
+        }
+        check(roundTrip, "dictionary round trip (odd messages unseen in training)");
+        check(dictionaryBytes < plainBytes, "dictionary images are smaller than order-0 images");
+
+        std::vector<char> compressed(1 << 16);
+        std::vector<char> restored(1 << 16);
+        std::size_t before = allocations;
+        bool steadyRoundTrip = true;
+        for (const std::string &message : messages)
+        {
+            std::size_t n = encoder.encode(message.data(), message.size(), compressed.data(), compressed.size());
+            std::size_t m = decoder.decode(compressed.data(), n, restored.data(), restored.size());
+            steadyRoundTrip &= std::string_view(restored.data(), m) == message;
+            // Exact-size capacity takes the counting path
+            std::size_t exact = encoder.encode(message.data(), message.size(), compressed.data(), n);
+            steadyRoundTrip &= exact == n;
+        }
+        std::size_t allocated = allocations - before;
+        check(steadyRoundTrip, "dictionary caller-buffer round trip");
+        check(allocated == 0, "dictionary no allocation once warm");
+
+        // A dictionary nobody loaded can't be found by its ID
+        DictionaryTrainer other;
+        other.addSample("zzzz", 4);
+        Huffman::Encoder stranger(other.build());
+        std::string foreign(stranger.encode("zz", 2));
+        check(throws([&]
+                     { decoder.decode(foreign.data(), foreign.size()); }),
+              "dictionary decoder rejects an unknown dictionary ID");
+
+        // Any file can start with "HUFT"; only a header whose code bits
+        // fill the rest of the file makes it a dictionary image
+        auto isImage = [](const std::string &data)
+        {
+            DictionaryImage image;
+            return FileUtils::parseDictionaryHeader(data.data(), data.size(), image) && isExactImage(image);
+        };
+        std::string lookalike = "HUFTbbbb plain text that only looks like a dictionary message.";
+        std::string image(encoder.encode(messages[0].data(), messages[0].size()));
+        check(isImage(image) && isImage(foreign) && !isImage(lookalike) && !isImage(image + "x") &&
+                  !isImage(image.substr(0, image.size() - 1)),
+              "dictionary images must fill the input exactly");
+    }
+
+    void testStreams(Codec codec, const std::string &name)
+    {
+        const std::string input = makeStreamInput();
+        const uint32_t blockSize = 1 << 16;
+
+        std::string compressed;
+        Huffman::StreamEncoder encoder([&compressed](const char *data, std::size_t size)
+                                       { compressed.append(data, size); },
+                                       codec, blockSize);
+        // Uneven pieces, including one larger than a block
+        std::size_t pieces[] = {1, 1000, 70000, 3, 150000};
+        std::size_t offset = 0;
+        for (std::size_t i = 0; offset < input.size(); ++i)
+        {
+            std::size_t take = std::min(pieces[i % 5], input.size() - offset);
+            encoder.write(input.data() + offset, take);
+            offset += take;
+        }
+        encoder.finish();
+
+        Huffman::Decoder decoder;
+        check(decoder.decode(compressed.data(), compressed.size()) == input,
+              name + " stream encoder output decodes as a container");
+
+        std::string restored;
+        Huffman::StreamDecoder streamDecoder([&restored](const char *data, std::size_t size)
+                                             { restored.append(data, size); });
+        for (std::size_t at = 0; at < compressed.size(); at += 777)
+            streamDecoder.write(compressed.data() + at, std::min<std::size_t>(777, compressed.size() - at));
+        uint64_t total = streamDecoder.finish();
+        check(total == input.size() && restored == input, name + " stream decoder round trip");
+
+        // Same objects again: a second stream after finish()
+        compressed.clear();
+        restored.clear();
+        encoder.write(input.data(), 5000);
+        encoder.finish();
+        streamDecoder.write(compressed.data(), compressed.size());
+        streamDecoder.finish();
+        check(restored == input.substr(0, 5000), name + " stream objects are reusable");
+
+        // Whole-buffer containers (what huff writes) stream-decode too
+        compressed.clear();
+        restored.clear();
+        compressContainer(input.data(), input.size(), codec, blockSize,
+                          [&compressed](const char *data, std::size_t size)
+                          { compressed.append(data, size); });
+        streamDecoder.write(compressed.data(), compressed.size());
+        streamDecoder.finish();
+        check(restored == input, name + " stream decoder reads huff output");
+
+        std::string damaged = compressed;
+        damaged[damaged.size() / 2] ^= 0x10;
+        Huffman::StreamDecoder rejecting([](const char *, std::size_t) {});
+        check(throws([&]
+                     {
+                         rejecting.write(damaged.data(), damaged.size());
+                         rejecting.finish();
+                     }),
+              name + " stream decoder rejects damaged data");
+
+        Huffman::StreamDecoder truncated([](const char *, std::size_t) {});
+        check(throws([&]
+                     {
+                         truncated.write(compressed.data(), compressed.size() - 10);
+                         truncated.finish();
+                     }),
+              name + " stream decoder rejects truncated data");
+    }
+}
+
+void *operator new(std::size_t size)
+{
+    ++allocations;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main()
+{
+    try
+    {
+        testBuffers(Codec::Order0, "order-0");
+        testBuffers(Codec::Order1, "order-1");
+        testBuffers(Codec::Interleaved, "order-0x4");
+        testLongCodes();
+        testLevels();
+        testForgedIndex();
+        testDictionary();
+        testStreams(Codec::Order0, "order-0");
+        testStreams(Codec::Order1, "order-1");
+        testStreams(Codec::Interleaved, "order-0x4");
+
+        Huffman::Decoder decoder;
+        const char junk[] = "not compressed";
+        check(throws([&]
+                     { decoder.decode(junk, sizeof(junk)); }),
+              "decoder rejects uncompressed input");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << (failures == 0 ? "All API checks passed\n" : "Some API checks failed\n");
+    return failures == 0 ? 0 : 1;
+}
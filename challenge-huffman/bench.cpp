@@ -0,0 +1,436 @@
+// Codec benchmark and round-trip regression harness.
+//
+// Compresses and decompresses each input in memory with every codec,
+// through the same block container huff writes, and reports ratio,
+// throughput, peak RSS and a round-trip check. With no files given it runs
+// over a generated corpus (text, logs, random, skewed, single-symbol, empty).
+// Each case runs in a forked child so its peak RSS is measured on its own.
+//
+//   ./huff_bench [--iterations N] [--corpus-size BYTES] [--level 1-9]
+//                [--json FILE] [--write-corpus DIR] [file...]
+//
+// Exits non-zero if any case fails to round-trip.
+
+#include "codec.h"
+#include "container.h"
+#include "file_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    struct CodecResult
+    {
+        uint64_t size = 0;
+        uint64_t compressedSize = 0;
+        double compressSeconds = 0;
+        double decompressSeconds = 0;
+        bool roundTrip = false;
+    };
+
+    struct BenchCase
+    {
+        std::string name;
+        std::string path; // empty for generated corpus entries
+    };
+
+    const struct
+    {
+        Codec codec;
+        const char *name;
+    } CODECS[] = {{Codec::Order0, "order-0"}, {Codec::Order1, "order-1"}, {Codec::Interleaved, "order-0x4"}};
+
+    const char *CORPUS_NAMES[] = {"text", "logs", "random", "skewed", "single-symbol", "empty"};
+
+    // xorshift64*: deterministic, so every run benchmarks identical bytes
+    struct Rng
+    {
+        uint64_t state;
+        uint64_t next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ULL;
+        }
+        uint32_t below(uint32_t bound) { return static_cast<uint32_t>(next() % bound); }
+    };
+
+    const char *WORDS[] = {
+        "the", "of", "and", "to", "a", "in", "is", "that", "it", "was", "for", "on", "as", "with",
+        "his", "he", "be", "at", "by", "had", "not", "but", "from", "this", "which", "or", "her",
+        "you", "all", "were", "they", "she", "one", "would", "there", "their", "we", "him", "been",
+        "has", "when", "who", "will", "more", "no", "if", "out", "so", "said", "what", "up", "its",
+        "about", "into", "than", "them", "can", "only", "other", "new", "some", "could", "time",
+        "these", "two", "may", "then", "do", "first", "any", "my", "now", "such", "like", "our",
+        "over", "man", "me", "even", "most", "made", "after", "also", "did", "many", "before",
+        "must", "through", "back", "years", "where", "much", "your", "way", "well", "down",
+        "should", "because", "each", "just", "those", "people", "how", "too", "little", "state",
+        "good", "very", "make", "world", "still", "own", "see", "men", "work", "long", "get",
+        "here", "between", "both", "life", "being", "under", "never", "day", "same", "another",
+        "know", "while", "last", "might", "us", "great", "old", "year", "off", "come", "since",
+        "against", "go", "came", "right", "used", "take", "three", "compression", "Huffman"};
+
+    std::string generateText(std::size_t size, Rng &rng)
+    {
+        const std::size_t numWords = sizeof(WORDS) / sizeof(WORDS[0]);
+        std::string out;
+        out.reserve(size + 16);
+        bool sentenceStart = true;
+        while (out.size() < size)
+        {
+            // Squaring a uniform draw skews picks toward the common words
+            uint32_t r = rng.below(1000);
+            std::string word = WORDS[(r * r / 1000) * numWords / 1000];
+            if (sentenceStart)
+                word[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+            out += word;
+            sentenceStart = false;
+            uint32_t p = rng.below(100);
+            if (p < 8)
+            {
+                out += ". ";
+                sentenceStart = true;
+            }
+            else if (p < 13)
+                out += ", ";
+            else if (p < 15)
+                out += ".\n";
+            else
+                out += ' ';
+        }
+        out.resize(size);
+        return out;
+    }
+
+    std::string generateLogs(std::size_t size, Rng &rng)
+    {
+        const char *levels[] = {"INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR"};
+        const char *paths[] = {"/api/v1/items", "/api/v1/users", "/healthz", "/api/v2/orders", "/static/app.js"};
+        const int statuses[] = {200, 200, 200, 200, 201, 204, 304, 404, 500};
+        std::string out;
+        out.reserve(size + 256);
+        uint64_t millis = 0;
+        char line[256];
+        while (out.size() < size)
+        {
+            millis += rng.below(50);
+            uint64_t secs = millis / 1000;
+            int len = std::snprintf(line, sizeof(line),
+                                    "2026-10-19T%02u:%02u:%02u.%03uZ %s [worker-%u] request id=%08x path=%s/%u status=%d latency_ms=%u\n",
+                                    static_cast<unsigned>((secs / 3600) % 24), static_cast<unsigned>((secs / 60) % 60),
+                                    static_cast<unsigned>(secs % 60), static_cast<unsigned>(millis % 1000),
+                                    levels[rng.below(6)], rng.below(8), static_cast<unsigned>(rng.next()),
+                                    paths[rng.below(5)], rng.below(10000), statuses[rng.below(9)], rng.below(400));
+            out.append(line, static_cast<std::size_t>(len));
+        }
+        out.resize(size);
+        return out;
+    }
+
+    std::string generateCorpusEntry(const std::string &name, std::size_t size)
+    {
+        Rng rng{0x9E3779B97F4A7C15ULL ^ std::hash<std::string>()(name)};
+        if (name == "text")
+            return generateText(size, rng);
+        if (name == "logs")
+            return generateLogs(size, rng);
+        if (name == "empty")
+            return {};
+        if (name == "single-symbol")
+            return std::string(size, 'a');
+
+        std::string out(size, '\0');
+        for (char &c : out)
+        {
+            if (name == "random")
+            {
+                c = static_cast<char>(rng.next() >> 56);
+            }
+            else
+            {
+                // skewed: geometric, half of all bytes are the same symbol
+                unsigned sym = 0;
+                while (sym < 255 && (rng.next() >> 63))
+                    ++sym;
+                c = static_cast<char>(sym);
+            }
+        }
+        return out;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    CodecResult runCodec(const char *data, std::size_t size, Codec codec, int level, int iterations)
+    {
+        CodecResult result;
+        result.size = size;
+        std::vector<char> compressed;
+        std::vector<char> restored(size);
+        auto append = [&compressed](const char *bytes, std::size_t n)
+        { compressed.insert(compressed.end(), bytes, bytes + n); };
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            compressed.clear();
+            compressContainer(data, size, codec, DEFAULT_BLOCK_SIZE, append, level);
+        }
+        result.compressSeconds = secondsSince(start) / iterations;
+        result.compressedSize = compressed.size();
+
+        Container container;
+        if (!readContainer(compressed.data(), compressed.size(), container))
+            throw std::runtime_error("Benchmark produced an unreadable container");
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            decompressContainer(container, 0, container.originalSize, restored.data());
+        result.decompressSeconds = secondsSince(start) / iterations;
+
+        result.roundTrip = container.originalSize == size &&
+                           std::memcmp(restored.data(), data, size) == 0;
+        return result;
+    }
+
+    // Runs one case in a child process; its peak RSS comes back from wait4
+    bool runIsolated(const BenchCase &bc, Codec codec, int level, int iterations, std::size_t corpusSize,
+                     CodecResult &result, long &peakRssKb, std::string &error)
+    {
+        int fds[2];
+        if (::pipe(fds) != 0)
+            throw std::runtime_error("pipe failed");
+
+        std::cout.flush();
+        pid_t pid = ::fork();
+        if (pid < 0)
+            throw std::runtime_error("fork failed");
+        if (pid == 0)
+        {
+            ::close(fds[0]);
+            std::string message;
+            CodecResult r;
+            try
+            {
+                if (bc.path.empty())
+                {
+                    std::string data = generateCorpusEntry(bc.name, corpusSize);
+                    r = runCodec(data.data(), data.size(), codec, level, iterations);
+                }
+                else
+                {
+                    FileUtils::MappedFile input(bc.path);
+                    r = runCodec(input.data(), input.size(), codec, level, iterations);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                message = e.what();
+            }
+            ssize_t ignored = ::write(fds[1], &r, sizeof(r));
+            ignored = ::write(fds[1], message.data(), message.size());
+            (void)ignored;
+            ::close(fds[1]);
+            ::_exit(0);
+        }
+
+        ::close(fds[1]);
+        std::string payload;
+        char buffer[4096];
+        ssize_t got;
+        while ((got = ::read(fds[0], buffer, sizeof(buffer))) > 0)
+            payload.append(buffer, static_cast<std::size_t>(got));
+        ::close(fds[0]);
+
+        int status = 0;
+        struct rusage usage;
+        ::wait4(pid, &status, 0, &usage);
+        peakRssKb = usage.ru_maxrss;
+
+        if (!WIFEXITED(status) || payload.size() < sizeof(CodecResult))
+        {
+            error = "benchmark child crashed";
+            return false;
+        }
+        std::memcpy(&result, payload.data(), sizeof(CodecResult));
+        error = payload.substr(sizeof(CodecResult));
+        return error.empty();
+    }
+
+    double megabytesPerSecond(uint64_t bytes, double seconds)
+    {
+        return seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0;
+    }
+
+    std::string jsonEscape(const std::string &text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+                continue;
+            out += c;
+        }
+        return out;
+    }
+
+    void writeCorpus(const std::string &dir, std::size_t corpusSize)
+    {
+        ::mkdir(dir.c_str(), 0755);
+        for (const char *name : CORPUS_NAMES)
+        {
+            std::string data = generateCorpusEntry(name, corpusSize);
+            std::string path = dir + "/" + name + ".bin";
+            FileUtils::OutputFile out(path);
+            out.write(data.data(), data.size());
+            std::cout << "Wrote " << path << " (" << data.size() << " bytes)\n";
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 3;
+    int level = DEFAULT_LEVEL;
+    std::size_t corpusSize = 4u << 20;
+    std::string jsonPath;
+    std::string corpusDir;
+    std::vector<BenchCase> cases;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+            iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--corpus-size" && i + 1 < argc)
+            corpusSize = static_cast<std::size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--level" && i + 1 < argc)
+            level = std::max(MIN_LEVEL, std::min(MAX_LEVEL, std::atoi(argv[++i])));
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--write-corpus" && i + 1 < argc)
+            corpusDir = argv[++i];
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            std::cout << "\nUsage: ./huff_bench [--iterations N] [--corpus-size BYTES] [--level 1-9]\n"
+                      << "                    [--json FILE] [--write-corpus DIR] [file...]\n"
+                      << "With no files, benchmarks a generated corpus.\n";
+            return 1;
+        }
+        else
+            cases.push_back({arg, arg});
+    }
+
+    try
+    {
+        if (!corpusDir.empty())
+        {
+            writeCorpus(corpusDir, corpusSize);
+            return 0;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    if (cases.empty())
+    {
+        for (const char *name : CORPUS_NAMES)
+            cases.push_back({name, ""});
+    }
+
+    std::cout << std::left << std::setw(24) << "input" << std::setw(10) << "codec"
+              << std::right << std::setw(12) << "size" << std::setw(12) << "compressed"
+              << std::setw(10) << "ratio" << std::setw(12) << "comp MB/s"
+              << std::setw(13) << "decomp MB/s" << std::setw(12) << "peak RSS"
+              << "  round-trip\n";
+
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"huff_bench\",\n  \"iterations\": " << iterations
+         << ",\n  \"level\": " << level
+         << ",\n  \"block_size\": " << DEFAULT_BLOCK_SIZE << ",\n  \"results\": [";
+
+    bool allOk = true;
+    bool first = true;
+    try
+    {
+        for (const BenchCase &bc : cases)
+        {
+            for (const auto &entry : CODECS)
+            {
+                CodecResult r;
+                long peakRssKb = 0;
+                std::string error;
+                bool ok = runIsolated(bc, entry.codec, level, iterations, corpusSize, r, peakRssKb, error) &&
+                          r.roundTrip;
+                allOk = allOk && ok;
+                double ratio = r.size ? 100.0 * r.compressedSize / r.size : 0.0;
+
+                std::cout << std::left << std::setw(24) << bc.name << std::setw(10) << entry.name
+                          << std::right << std::setw(12) << r.size
+                          << std::setw(12) << r.compressedSize
+                          << std::setw(9) << std::fixed << std::setprecision(2) << ratio << "%"
+                          << std::setw(12) << megabytesPerSecond(r.size, r.compressSeconds)
+                          << std::setw(13) << megabytesPerSecond(r.size, r.decompressSeconds)
+                          << std::setw(9) << peakRssKb / 1024.0 << " MB"
+                          << "  " << (ok ? "ok" : "FAILED") << (error.empty() ? "" : " (" + error + ")")
+                          << "\n";
+
+                json << (first ? "\n" : ",\n") << "    {\"input\": \"" << jsonEscape(bc.name)
+                     << "\", \"codec\": \"" << entry.name
+                     << "\", \"size\": " << r.size
+                     << ", \"compressed_size\": " << r.compressedSize
+                     << ", \"ratio\": " << std::fixed << std::setprecision(4) << ratio / 100.0
+                     << ", \"compress_mb_s\": " << std::setprecision(2) << megabytesPerSecond(r.size, r.compressSeconds)
+                     << ", \"decompress_mb_s\": " << megabytesPerSecond(r.size, r.decompressSeconds)
+                     << ", \"peak_rss_kb\": " << peakRssKb
+                     << ", \"round_trip\": " << (ok ? "true" : "false");
+                if (!error.empty())
+                    json << ", \"error\": \"" << jsonEscape(error) << "\"";
+                json << "}";
+                first = false;
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    json << "\n  ],\n  \"all_round_trips_ok\": " << (allOk ? "true" : "false") << "\n}\n";
+    if (!jsonPath.empty())
+    {
+        std::ofstream out(jsonPath);
+        out << json.str();
+        if (!out)
+        {
+            std::cerr << "Error: could not write " << jsonPath << "\n";
+            return 1;
+        }
+        std::cout << "\nWrote " << jsonPath << "\n";
+    }
+
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,1005 @@
+#include "codec.h"
+#include <stdexcept>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Packs codes MSB-first into dest; fewer than 8 bits are ever pending.
+    // dest must hold the encoded bit count, rounded up to whole bytes.
+    struct BitPacker
+    {
+        char *dest;
+        uint64_t acc = 0;
+        unsigned pending = 0;
+
+        void putBits(uint64_t bits, unsigned length)
+        {
+            acc = (acc << length) | bits;
+            pending += length;
+            while (pending >= 8)
+            {
+                pending -= 8;
+                *dest++ = static_cast<char>(acc >> pending);
+            }
+        }
+
+        void put(const Code &code)
+        {
+            if (code.length > 32)
+            {
+                putBits(code.bits >> 32, code.length - 32);
+                putBits(code.bits & 0xFFFFFFFFu, 32);
+            }
+            else
+            {
+                putBits(code.bits, code.length);
+            }
+        }
+
+        // Returns one past the last byte written
+        char *flush()
+        {
+            if (pending > 0)
+                *dest++ = static_cast<char>(acc << (8 - pending));
+            return dest;
+        }
+    };
+
+    // The 64 bits starting at `bit`, MSB-first; bytes past the end read as
+    // zero. At least 57 of the returned bits come from the input.
+    inline uint64_t peekBits(const unsigned char *packed, std::size_t packedSize, uint64_t bit)
+    {
+        std::size_t byte = static_cast<std::size_t>(bit >> 3);
+        uint64_t word = 0;
+        if (byte + 8 <= packedSize)
+        {
+            std::memcpy(&word, packed + byte, sizeof(word));
+            word = __builtin_bswap64(word);
+        }
+        else
+        {
+            for (unsigned i = 0; byte + i < packedSize; ++i)
+                word |= static_cast<uint64_t>(packed[byte + i]) << (56 - 8 * i);
+        }
+        return word << (bit & 7);
+    }
+
+    // Finishes a code longer than TABLE_BITS bit by bit from `node`.
+    char walkLongCode(const HuffmanTree &tree, uint16_t node,
+                      const unsigned char *packed, uint64_t availableBits, uint64_t &bit)
+    {
+        while (!tree.nodes[node].isLeaf())
+        {
+            if (bit >= availableBits)
+                throw std::runtime_error("Compressed data ended before its recorded size");
+            const Node &current = tree.nodes[node];
+            node = ((packed[bit >> 3] >> (7 - (bit & 7))) & 1) ? current.right : current.left;
+            ++bit;
+            if (node == NO_CHILD)
+                throw std::runtime_error("Invalid path in Huffman tree during decompression");
+        }
+        return tree.nodes[node].ch;
+    }
+
+    // Decodes `count` symbols of one bitstream starting at `bit` and returns
+    // the bit position after the last one. Callers check that position
+    // against the bits they know the stream holds. `tree` is only needed
+    // when the table has long-code entries.
+    uint64_t decodeStream(const HuffmanTree *tree, const DecodeTable &table,
+                          const unsigned char *packed, std::size_t packedSize,
+                          uint64_t bit, char *dest, std::size_t count)
+    {
+        const uint64_t availableBits = static_cast<uint64_t>(packedSize) * 8;
+        std::size_t written = 0;
+        while (written < count)
+        {
+            if (bit > availableBits)
+                throw std::runtime_error("Compressed data ended before its recorded size");
+
+            // One load serves codes while a full TABLE_BITS window is left
+            // of the 57 bits it guarantees: at least 4, more when codes are short
+            uint64_t word = peekBits(packed, packedSize, bit);
+            unsigned used = 0;
+            while (used <= 57 - TABLE_BITS && written < count)
+            {
+                const DecodeEntry &entry = table[(word << used) >> (64 - TABLE_BITS)];
+                if (entry.length == 0)
+                    throw std::runtime_error("Invalid path in Huffman tree during decompression");
+                if (entry.node != NO_CHILD)
+                {
+                    bit += used + TABLE_BITS;
+                    used = 0;
+                    dest[written++] = walkLongCode(*tree, entry.node, packed, availableBits, bit);
+                    break;
+                }
+                dest[written++] = static_cast<char>(entry.symbol);
+                used += entry.length;
+            }
+            bit += used;
+        }
+        return bit;
+    }
+
+    // Order-0 entropy of every stride-th byte, scaled to the whole input:
+    // a lower bound on what Huffman coding the input could save
+    double sampledEntropyBytes(const char *data, std::size_t size, std::size_t stride)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+        std::array<uint32_t, 256> counts{};
+        std::size_t samples = 0;
+        for (std::size_t i = 0; i < size; i += stride, ++samples)
+            ++counts[p[i]];
+
+        double bits = 0;
+        for (uint32_t count : counts)
+        {
+            if (count != 0)
+                bits -= count * std::log2(static_cast<double>(count) / samples);
+        }
+        return bits / 8 * (static_cast<double>(size) / samples);
+    }
+
+    void planStored(std::size_t size, EncodePlan &plan)
+    {
+        plan.codec = Codec::Raw;
+        plan.totalBits = 0;
+        plan.headerSize = FileUtils::rawHeaderSize(size);
+        plan.compressedSize = plan.headerSize + size;
+    }
+
+    void planRuns(std::size_t size, uint64_t runBytes, EncodePlan &plan)
+    {
+        plan.codec = Codec::Rle;
+        plan.totalBits = 0;
+        plan.runBytes = runBytes;
+        plan.headerSize = FileUtils::rleHeaderSize(size, runBytes);
+        plan.compressedSize = plan.headerSize + static_cast<std::size_t>(runBytes);
+    }
+}
+
+void frequencyMap(const char *book, std::size_t size, FrequencyTable &fillThis)
+{
+    // Four interleaved sub-histograms: runs of the same byte land in
+    // different counters, so increments don't wait on the previous store.
+    uint32_t counts[4][256] = {};
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(book);
+    const std::size_t n = size;
+    std::size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        uint64_t lo, hi;
+        std::memcpy(&lo, p + i, sizeof(lo));
+        std::memcpy(&hi, p + i + 8, sizeof(hi));
+        for (int shift = 0; shift < 64; shift += 16)
+        {
+            ++counts[0][(lo >> shift) & 0xFF];
+            ++counts[1][(lo >> (shift + 8)) & 0xFF];
+            ++counts[2][(hi >> shift) & 0xFF];
+            ++counts[3][(hi >> (shift + 8)) & 0xFF];
+        }
+    }
+    for (; i < n; ++i)
+        ++counts[0][p[i]];
+
+    for (std::size_t sym = 0; sym < 256; ++sym)
+        fillThis[sym] += counts[0][sym] + counts[1][sym] + counts[2][sym] + counts[3][sym];
+}
+
+void buildHuffmanTree(const FrequencyTable &fmap, HuffmanTree &tree)
+{
+    // Min-heap of node indices, driven by std::push_heap/pop_heap exactly as
+    // std::priority_queue would be, so ties resolve the same way as before.
+    std::array<uint16_t, 256> heap;
+    std::size_t heapSize = 0;
+    uint16_t used = 0;
+    auto greaterFreq = [&tree](uint16_t a, uint16_t b)
+    {
+        return tree.nodes[a].freq > tree.nodes[b].freq; // min-heap
+    };
+    auto push = [&](uint16_t idx)
+    {
+        heap[heapSize++] = idx;
+        std::push_heap(heap.begin(), heap.begin() + heapSize, greaterFreq);
+    };
+    auto pop = [&]()
+    {
+        std::pop_heap(heap.begin(), heap.begin() + heapSize, greaterFreq);
+        return heap[--heapSize];
+    };
+
+    // Push in char order: the heap's tie-breaking depends on insertion order,
+    // and decoders rebuild the tree from the header with this same loop.
+    for (int c = CHAR_MIN; c <= CHAR_MAX; ++c)
+    {
+        char ch = static_cast<char>(c);
+        uint32_t count = fmap[static_cast<unsigned char>(ch)];
+        if (count == 0)
+            continue;
+        tree.nodes[used] = {count, NO_CHILD, NO_CHILD, ch};
+        push(used++);
+    }
+
+    tree.root = NO_CHILD;
+    if (heapSize == 0)
+        return;
+    if (heapSize == 1)
+    {
+        // Common trick: make a parent so codes still exist
+        uint16_t only = pop();
+        tree.nodes[used] = {tree.nodes[only].freq, only, NO_CHILD, '\0'};
+        tree.root = used;
+        return;
+    }
+    while (heapSize > 1)
+    {
+        uint16_t left = pop();
+        uint16_t right = pop();
+        tree.nodes[used] = {tree.nodes[left].freq + tree.nodes[right].freq, left, right, '\0'};
+        push(used++);
+    }
+    tree.root = pop();
+}
+
+void buildCodes(const HuffmanTree &tree, CodeTable &codes)
+{
+    codes.fill(Code{});
+    if (tree.root == NO_CHILD)
+        return;
+
+    // Explicit DFS stack instead of recursion; each entry carries the code
+    // accumulated on the way down, so no strings are built.
+    struct Pending
+    {
+        uint16_t node;
+        Code code;
+    };
+    std::array<Pending, MAX_NODES> stack;
+    std::size_t depth = 0;
+    stack[depth++] = {tree.root, Code{}};
+
+    while (depth > 0)
+    {
+        Pending top = stack[--depth];
+        const Node &node = tree.nodes[top.node];
+        if (node.isLeaf())
+        {
+            codes[static_cast<unsigned char>(node.ch)] = top.code;
+            continue;
+        }
+        if (top.code.length == MAX_CODE_LENGTH)
+            throw std::runtime_error("Huffman code exceeds 64 bits");
+
+        Code next{top.code.bits << 1, top.code.length + 1};
+        if (node.right != NO_CHILD)
+            stack[depth++] = {node.right, {next.bits | 1, next.length}};
+        if (node.left != NO_CHILD)
+            stack[depth++] = {node.left, next};
+    }
+}
+
+void buildDecodeTable(const HuffmanTree &tree, DecodeTable &table)
+{
+    table.fill(DecodeEntry{});
+    if (tree.root == NO_CHILD)
+        return;
+
+    // Same explicit DFS as buildCodes, cut off at TABLE_BITS deep: a leaf
+    // above the cut fills every slot sharing its prefix, a node at the cut
+    // becomes a long-code entry
+    struct Pending
+    {
+        uint16_t node;
+        uint32_t prefix;
+        unsigned depth;
+    };
+    std::array<Pending, MAX_NODES> stack;
+    std::size_t depth = 0;
+    stack[depth++] = {tree.root, 0, 0};
+
+    while (depth > 0)
+    {
+        Pending top = stack[--depth];
+        const Node &node = tree.nodes[top.node];
+        if (node.isLeaf() || top.depth == TABLE_BITS)
+        {
+            DecodeEntry entry;
+            entry.length = static_cast<uint8_t>(top.depth);
+            if (node.isLeaf())
+                entry.symbol = static_cast<uint8_t>(node.ch);
+            else
+                entry.node = top.node;
+            uint32_t first = top.prefix << (TABLE_BITS - top.depth);
+            std::fill(table.begin() + first, table.begin() + first + (1u << (TABLE_BITS - top.depth)), entry);
+            continue;
+        }
+        if (node.right != NO_CHILD)
+            stack[depth++] = {node.right, (top.prefix << 1) | 1, top.depth + 1};
+        if (node.left != NO_CHILD)
+            stack[depth++] = {node.left, top.prefix << 1, top.depth + 1};
+    }
+}
+
+std::string codeToString(const Code &code)
+{
+    std::string result(code.length, '0');
+    for (unsigned i = 0; i < code.length; ++i)
+    {
+        if ((code.bits >> (code.length - 1 - i)) & 1)
+            result[i] = '1';
+    }
+    return result;
+}
+
+uint64_t encodedBitCount(const FrequencyTable &fmap, const CodeTable &codes)
+{
+    uint64_t totalBits = 0;
+    for (std::size_t sym = 0; sym < fmap.size(); ++sym)
+    {
+        if (fmap[sym] != 0 && codes[sym].length == 0)
+            throw std::runtime_error("Character not found in Huffman codes: " + std::to_string(sym));
+        totalBits += static_cast<uint64_t>(fmap[sym]) * codes[sym].length;
+    }
+    return totalBits;
+}
+
+std::size_t compressText(const char *text, std::size_t size,
+                         const CodeTable &codes,
+                         char *dest)
+{
+    BitPacker packer{dest};
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(text);
+    for (std::size_t i = 0; i < size; ++i)
+        packer.put(codes[p[i]]);
+    return static_cast<std::size_t>(packer.flush() - dest);
+}
+
+void decompressText(const CompressedHeader &header,
+                    const HuffmanTree &tree, const DecodeTable &table,
+                    char *dest, std::size_t destSize)
+{
+    if (tree.root == NO_CHILD || header.totalBits == 0)
+    {
+        if (destSize != 0)
+            throw std::runtime_error("Compressed data is missing");
+        return;
+    }
+    if (header.totalBits > static_cast<uint64_t>(header.payloadSize) * 8)
+        throw std::runtime_error("Compressed data is shorter than its bit count");
+
+    // Table lookups instead of a walk per bit; the symbol count bounds the
+    // loop and the bit count must come out exact
+    uint64_t bit = decodeStream(&tree, table, reinterpret_cast<const unsigned char *>(header.payload),
+                                header.payloadSize, 0, dest, destSize);
+    if (bit > header.totalBits)
+        throw std::runtime_error("Compressed data ended before its recorded size");
+    if (bit < header.totalBits)
+        throw std::runtime_error("Compressed data decodes past its recorded size");
+}
+
+void decodeSymbols(const HuffmanTree &tree, const DecodeTable &table,
+                   const char *payload, std::size_t payloadSize,
+                   char *dest, std::size_t count)
+{
+    // Same decode as decompressText, for formats that record the original
+    // size instead of the bit count
+    if (count == 0)
+        return;
+    if (tree.root == NO_CHILD)
+        throw std::runtime_error("Compressed data is missing");
+
+    uint64_t bit = decodeStream(&tree, table, reinterpret_cast<const unsigned char *>(payload),
+                                payloadSize, 0, dest, count);
+    if (bit > static_cast<uint64_t>(payloadSize) * 8)
+        throw std::runtime_error("Compressed data ended before its recorded size");
+    if ((bit + 7) / 8 != payloadSize)
+        throw std::runtime_error("Compressed data is longer than its recorded size");
+}
+
+void contextFrequencyMap(const char *book, std::size_t size, std::vector<FrequencyTable> &fillThis)
+{
+    // Consecutive increments hit the row of the byte just seen, so the
+    // order-0 interleaving trick isn't needed to avoid store-to-load stalls.
+    fillThis.assign(256, FrequencyTable{});
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(book);
+    unsigned char prev = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        ++fillThis[prev][p[i]];
+        prev = p[i];
+    }
+}
+
+void compressContextText(const char *text, std::size_t size,
+                         const std::vector<CodeTable> &codes,
+                         char *dest)
+{
+    BitPacker packer{dest};
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(text);
+    unsigned char prev = 0;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        packer.put(codes[prev][p[i]]);
+        prev = p[i];
+    }
+    packer.flush();
+}
+
+void decompressContextText(const CompressedHeader &header,
+                           char *dest, std::size_t destSize,
+                           std::vector<HuffmanTree> &trees)
+{
+    if (header.totalBits == 0)
+    {
+        if (destSize != 0)
+            throw std::runtime_error("Compressed data is missing");
+        return;
+    }
+    if (header.totalBits > static_cast<uint64_t>(header.payloadSize) * 8)
+        throw std::runtime_error("Compressed data is shorter than its bit count");
+
+    // Only contexts that occur get a tree; slot maps previous byte -> tree
+    std::array<uint16_t, 256> slot;
+    slot.fill(NO_CHILD);
+    uint16_t used = 0;
+    for (std::size_t ctx = 0; ctx < 256; ++ctx)
+    {
+        for (uint32_t freq : header.contextFrequencies[ctx])
+        {
+            if (freq != 0)
+            {
+                slot[ctx] = used++;
+                break;
+            }
+        }
+    }
+    trees.resize(used);
+    for (std::size_t ctx = 0; ctx < 256; ++ctx)
+    {
+        if (slot[ctx] != NO_CHILD)
+            buildHuffmanTree(header.contextFrequencies[ctx], trees[slot[ctx]]);
+    }
+
+    const unsigned char *packed = reinterpret_cast<const unsigned char *>(header.payload);
+    std::size_t written = 0;
+    const HuffmanTree *tree = nullptr;
+    uint16_t current = NO_CHILD;
+    auto enterContext = [&](unsigned char ctx)
+    {
+        if (slot[ctx] == NO_CHILD)
+            throw std::runtime_error("Compressed data uses a context with no table");
+        tree = &trees[slot[ctx]];
+        current = tree->root;
+    };
+    enterContext(0);
+
+    for (uint64_t i = 0; i < header.totalBits; ++i)
+    {
+        const Node &node = tree->nodes[current];
+        current = ((packed[i >> 3] >> (7 - (i & 7))) & 1) ? node.right : node.left;
+        if (current == NO_CHILD)
+            throw std::runtime_error("Invalid path in Huffman tree during decompression");
+
+        if (tree->nodes[current].isLeaf())
+        {
+            if (written == destSize)
+                throw std::runtime_error("Compressed data decodes past its recorded size");
+            char ch = tree->nodes[current].ch;
+            dest[written++] = ch;
+            if (written < destSize)
+                enterContext(static_cast<unsigned char>(ch));
+        }
+    }
+
+    if (written != destSize)
+        throw std::runtime_error("Compressed data ended before its recorded size");
+}
+
+void limitCodeLengths(const FrequencyTable &fmap, unsigned maxLength, CodeLengths &lengths)
+{
+    HuffmanTree tree;
+    CodeTable codes;
+    buildHuffmanTree(fmap, tree);
+    buildCodes(tree, codes);
+
+    unsigned longest = 0;
+    for (std::size_t sym = 0; sym < 256; ++sym)
+    {
+        longest = std::max(longest, codes[sym].length);
+        lengths[sym] = static_cast<uint8_t>(std::min(codes[sym].length, maxLength));
+    }
+    if (longest <= maxLength)
+        return;
+
+    // Clamping oversubscribed the code space. Kraft sum in units of
+    // 2^-maxLength; it must come back down to `capacity`.
+    const uint64_t capacity = uint64_t(1) << maxLength;
+    uint64_t kraft = 0;
+    std::array<uint8_t, 256> order;
+    std::size_t used = 0;
+    for (std::size_t sym = 0; sym < 256; ++sym)
+    {
+        if (lengths[sym] == 0)
+            continue;
+        kraft += capacity >> lengths[sym];
+        order[used++] = static_cast<uint8_t>(sym);
+    }
+    std::sort(order.begin(), order.begin() + used,
+              [&fmap](uint8_t a, uint8_t b) { return fmap[a] < fmap[b]; });
+
+    // Lengthen the rarest codes first until everything fits...
+    while (kraft > capacity)
+    {
+        for (std::size_t i = 0; i < used && kraft > capacity; ++i)
+        {
+            uint8_t &length = lengths[order[i]];
+            if (length < maxLength)
+            {
+                ++length;
+                kraft -= capacity >> length;
+            }
+        }
+    }
+    // ...then hand any slack back to the most frequent ones
+    for (std::size_t i = used; i-- > 0;)
+    {
+        uint8_t &length = lengths[order[i]];
+        while (length > 1 && kraft + (capacity >> length) <= capacity)
+        {
+            kraft += capacity >> length;
+            --length;
+        }
+    }
+}
+
+void buildCanonicalCodes(const CodeLengths &lengths, CodeTable &codes)
+{
+    // DEFLATE-style: codes ordered by length, then by byte value
+    std::array<uint32_t, 16> count{};
+    for (uint8_t length : lengths)
+        ++count[length];
+    count[0] = 0;
+
+    std::array<uint64_t, 16> next{};
+    uint64_t code = 0;
+    for (std::size_t length = 1; length < next.size(); ++length)
+    {
+        code = (code + count[length - 1]) << 1;
+        next[length] = code;
+    }
+
+    codes.fill(Code{});
+    for (std::size_t sym = 0; sym < 256; ++sym)
+    {
+        if (lengths[sym] != 0)
+            codes[sym] = {next[lengths[sym]]++, lengths[sym]};
+    }
+}
+
+void buildCanonicalDecodeTable(const CodeLengths &lengths, DecodeTable &table)
+{
+    // Lengths come from the file: reject any that can't form a prefix code
+    uint64_t kraft = 0;
+    for (uint8_t length : lengths)
+    {
+        if (length > TABLE_BITS)
+            throw std::runtime_error("Compressed data has an invalid code table");
+        if (length != 0)
+            kraft += 1u << (TABLE_BITS - length);
+    }
+    if (kraft > table.size())
+        throw std::runtime_error("Compressed data has an invalid code table");
+
+    CodeTable codes;
+    buildCanonicalCodes(lengths, codes);
+    table.fill(DecodeEntry{});
+    for (std::size_t sym = 0; sym < 256; ++sym)
+    {
+        if (lengths[sym] == 0)
+            continue;
+        DecodeEntry entry;
+        entry.symbol = static_cast<uint8_t>(sym);
+        entry.length = lengths[sym];
+        std::size_t first = static_cast<std::size_t>(codes[sym].bits << (TABLE_BITS - lengths[sym]));
+        std::fill(table.begin() + first, table.begin() + first + (1u << (TABLE_BITS - lengths[sym])), entry);
+    }
+}
+
+void decompressInterleaved(const CompressedHeader &header, const DecodeTable &table,
+                           char *dest, std::size_t destSize)
+{
+    if (header.originalSize != destSize)
+        throw std::runtime_error("Compressed data doesn't match its recorded size");
+
+    // Jump table: where each stream starts
+    const unsigned char *streams[INTERLEAVED_STREAMS];
+    std::size_t sizes[INTERLEAVED_STREAMS];
+    std::size_t counts[INTERLEAVED_STREAMS];
+    char *outputs[INTERLEAVED_STREAMS];
+    const std::size_t segment = (destSize + INTERLEAVED_STREAMS - 1) / INTERLEAVED_STREAMS;
+    uint64_t offset = 0;
+    for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+    {
+        streams[s] = reinterpret_cast<const unsigned char *>(header.payload) + offset;
+        sizes[s] = header.streamSizes[s];
+        offset += sizes[s];
+        std::size_t begin = std::min(s * segment, destSize);
+        counts[s] = std::min(segment, destSize - begin);
+        outputs[s] = dest + begin;
+    }
+    if (offset > header.payloadSize)
+        throw std::runtime_error("Compressed data is shorter than its stream sizes");
+
+    // Lockstep rounds: 4 codes from each stream per round. The four streams
+    // are independent dependency chains, so their lookups overlap. The last
+    // stream is the shortest; rounds stop while every stream still has
+    // 8 readable bytes, so loads need no bounds checks.
+    uint64_t bits[INTERLEAVED_STREAMS] = {};
+    std::size_t done = 0;
+    auto readable = [&]()
+    {
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+        {
+            if ((bits[s] >> 3) + 8 > sizes[s])
+                return false;
+        }
+        return true;
+    };
+    while (done + 4 <= counts[INTERLEAVED_STREAMS - 1] && readable())
+    {
+        uint64_t words[INTERLEAVED_STREAMS];
+        unsigned used[INTERLEAVED_STREAMS];
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+        {
+            std::memcpy(&words[s], streams[s] + (bits[s] >> 3), sizeof(words[s]));
+            words[s] = __builtin_bswap64(words[s]) << (bits[s] & 7);
+            used[s] = 0;
+        }
+        unsigned invalid = 0;
+        for (std::size_t k = 0; k < 4; ++k)
+        {
+            for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+            {
+                const DecodeEntry &entry = table[(words[s] << used[s]) >> (64 - TABLE_BITS)];
+                outputs[s][done + k] = static_cast<char>(entry.symbol);
+                used[s] += entry.length;
+                invalid |= entry.length == 0;
+            }
+        }
+        if (invalid)
+            throw std::runtime_error("Invalid path in Huffman tree during decompression");
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+            bits[s] += used[s];
+        done += 4;
+    }
+
+    // Tails, one stream at a time; each stream must end on its last byte
+    for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+    {
+        uint64_t end = decodeStream(nullptr, table, streams[s], sizes[s], bits[s],
+                                    outputs[s] + done, counts[s] - done);
+        if (end > static_cast<uint64_t>(sizes[s]) * 8)
+            throw std::runtime_error("Compressed data ended before its recorded size");
+        if ((end + 7) / 8 != sizes[s])
+            throw std::runtime_error("Compressed data decodes past its recorded size");
+    }
+}
+
+uint64_t runLengthBytes(const char *data, std::size_t size)
+{
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < size;)
+    {
+        std::size_t run = 1;
+        while (i + run < size && data[i + run] == data[i])
+            ++run;
+        total += 1 + FileUtils::varintSize(run);
+        i += run;
+    }
+    return total;
+}
+
+std::size_t compressRuns(const char *data, std::size_t size, char *dest)
+{
+    char *out = dest;
+    for (std::size_t i = 0; i < size;)
+    {
+        std::size_t run = 1;
+        while (i + run < size && data[i + run] == data[i])
+            ++run;
+        *out++ = data[i];
+        out = FileUtils::writeVarint(out, run);
+        i += run;
+    }
+    return static_cast<std::size_t>(out - dest);
+}
+
+void decompressRuns(const CompressedHeader &header, char *dest, std::size_t destSize)
+{
+    if (header.originalSize != destSize)
+        throw std::runtime_error("Compressed data doesn't match its recorded size");
+    if (header.storedSize > header.payloadSize)
+        throw std::runtime_error("Compressed data is shorter than its recorded size");
+
+    const char *in = header.payload;
+    const char *end = header.payload + header.storedSize;
+    std::size_t written = 0;
+    while (in < end)
+    {
+        char value = *in++;
+        uint64_t run;
+        if (!FileUtils::readVarint(in, end, run) || run == 0 || run > destSize - written)
+            throw std::runtime_error("Invalid run in compressed data");
+        std::memset(dest + written, value, static_cast<std::size_t>(run));
+        written += static_cast<std::size_t>(run);
+    }
+    if (written != destSize)
+        throw std::runtime_error("Compressed data ended before its recorded size");
+}
+
+bool isExactImage(const CompressedHeader &header)
+{
+    if (header.codec == Codec::Interleaved)
+    {
+        // The lengths must form a prefix code the decoder accepts, and the
+        // streams must fill the rest of the file
+        uint64_t kraft = 0;
+        for (uint8_t length : header.codeLengths)
+        {
+            if (length > TABLE_BITS)
+                return false;
+            if (length != 0)
+                kraft += 1u << (TABLE_BITS - length);
+        }
+        uint64_t streamBytes = 0;
+        for (uint32_t size : header.streamSizes)
+            streamBytes += size;
+        return kraft <= (1u << TABLE_BITS) && streamBytes == header.payloadSize;
+    }
+    if (header.codec != Codec::Raw && header.codec != Codec::Rle)
+        return true;
+    if (header.storedSize != header.payloadSize)
+        return false;
+    if (header.codec == Codec::Raw)
+        return true;
+
+    const char *in = header.payload;
+    const char *end = header.payload + header.payloadSize;
+    uint64_t total = 0;
+    while (in < end)
+    {
+        ++in; // the byte value
+        uint64_t run;
+        if (!FileUtils::readVarint(in, end, run) || run == 0 || run > header.originalSize - total)
+            return false;
+        total += run;
+    }
+    return total == header.originalSize;
+}
+
+void planCompression(const char *data, std::size_t size, Codec codec, int level, EncodePlan &plan)
+{
+    level = std::max(MIN_LEVEL, std::min(MAX_LEVEL, level));
+    if (size == 0)
+    {
+        planCompression(data, size, codec, plan);
+        return;
+    }
+
+    // Huffman coding can't beat the entropy, so a sample that is close to
+    // 8 bits per byte means the block is stored without building codes.
+    // The sample keeps at least 4096 bytes where the block has them.
+    if (level <= 6)
+    {
+        std::size_t stride = std::min<std::size_t>(std::size_t(1) << (7 - level),
+                                                   std::max<std::size_t>(1, size / 4096));
+        if (sampledEntropyBytes(data, size, stride) >= size * 31.0 / 32)
+        {
+            planStored(size, plan);
+            return;
+        }
+    }
+
+    // Huffman spends at least a bit per byte, so runs this long win outright
+    uint64_t runBytes = 0;
+    std::size_t runSize = SIZE_MAX;
+    if (level >= 3)
+    {
+        runBytes = runLengthBytes(data, size);
+        runSize = FileUtils::rleHeaderSize(size, runBytes) + static_cast<std::size_t>(runBytes);
+        if (runSize <= size / 8)
+        {
+            planRuns(size, runBytes, plan);
+            return;
+        }
+    }
+
+    planCompression(data, size, codec, plan);
+    // The interleaved codec is picked for decode speed, so it isn't traded
+    // for a smaller order; otherwise level 8 tries the other order when the
+    // data compresses well enough for context to matter, level 9 always
+    if ((level == 9 || (level == 8 && plan.compressedSize * 10 <= size * 9)) && codec != Codec::Interleaved)
+    {
+        std::size_t first = plan.compressedSize;
+        Codec other = codec == Codec::Order0 ? Codec::Order1 : Codec::Order0;
+        planCompression(data, size, other, plan);
+        if (plan.compressedSize >= first)
+            planCompression(data, size, codec, plan);
+    }
+
+    const std::size_t rawSize = FileUtils::rawHeaderSize(size) + size;
+    if (runSize < plan.compressedSize && runSize < rawSize)
+        planRuns(size, runBytes, plan);
+    else if (plan.compressedSize >= rawSize)
+        planStored(size, plan);
+}
+
+void planCompression(const char *data, std::size_t size, Codec codec, EncodePlan &plan)
+{
+    plan.codec = codec;
+    plan.totalBits = 0;
+    HuffmanTree tree;
+
+    if (codec == Codec::Order0)
+    {
+        plan.frequencies.fill(0);
+        frequencyMap(data, size, plan.frequencies);
+        buildHuffmanTree(plan.frequencies, tree);
+        buildCodes(tree, plan.codes);
+        plan.totalBits = encodedBitCount(plan.frequencies, plan.codes);
+        plan.headerSize = FileUtils::compressedHeaderSize(plan.frequencies);
+    }
+    else if (codec == Codec::Interleaved)
+    {
+        // Each segment's bit count sizes its stream, so count per segment
+        const std::size_t segment = (size + INTERLEAVED_STREAMS - 1) / INTERLEAVED_STREAMS;
+        std::array<FrequencyTable, INTERLEAVED_STREAMS> segments{};
+        plan.frequencies.fill(0);
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+        {
+            std::size_t begin = std::min(s * segment, size);
+            frequencyMap(data + begin, std::min(segment, size - begin), segments[s]);
+            for (std::size_t sym = 0; sym < 256; ++sym)
+                plan.frequencies[sym] += segments[s][sym];
+        }
+        limitCodeLengths(plan.frequencies, TABLE_BITS, plan.codeLengths);
+        buildCanonicalCodes(plan.codeLengths, plan.codes);
+
+        plan.headerSize = FileUtils::interleavedHeaderSize(size);
+        plan.compressedSize = plan.headerSize;
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+        {
+            plan.streamBits[s] = encodedBitCount(segments[s], plan.codes);
+            plan.totalBits += plan.streamBits[s];
+            plan.compressedSize += static_cast<std::size_t>((plan.streamBits[s] + 7) / 8);
+        }
+        return;
+    }
+    else
+    {
+        contextFrequencyMap(data, size, plan.contextFrequencies);
+        plan.contextCodes.resize(256);
+        for (std::size_t ctx = 0; ctx < 256; ++ctx)
+        {
+            buildHuffmanTree(plan.contextFrequencies[ctx], tree);
+            buildCodes(tree, plan.contextCodes[ctx]);
+            plan.totalBits += encodedBitCount(plan.contextFrequencies[ctx], plan.contextCodes[ctx]);
+        }
+        plan.headerSize = FileUtils::contextHeaderSize(plan.contextFrequencies);
+    }
+
+    plan.compressedSize = plan.headerSize + static_cast<std::size_t>((plan.totalBits + 7) / 8);
+}
+
+void compressWithPlan(const char *data, std::size_t size, const EncodePlan &plan, char *dest)
+{
+    if (plan.codec == Codec::Order0)
+    {
+        FileUtils::writeCompressedHeader(dest, plan.frequencies, plan.totalBits);
+        compressText(data, size, plan.codes, dest + plan.headerSize);
+    }
+    else if (plan.codec == Codec::Raw)
+    {
+        std::memcpy(dest + FileUtils::writeRawHeader(dest, size), data, size);
+    }
+    else if (plan.codec == Codec::Rle)
+    {
+        compressRuns(data, size, dest + FileUtils::writeRleHeader(dest, size, plan.runBytes));
+    }
+    else if (plan.codec == Codec::Interleaved)
+    {
+        std::array<uint32_t, INTERLEAVED_STREAMS> streamSizes;
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+            streamSizes[s] = static_cast<uint32_t>((plan.streamBits[s] + 7) / 8);
+        char *out = dest + FileUtils::writeInterleavedHeader(dest, size, plan.codeLengths, streamSizes);
+
+        const std::size_t segment = (size + INTERLEAVED_STREAMS - 1) / INTERLEAVED_STREAMS;
+        for (std::size_t s = 0; s < INTERLEAVED_STREAMS; ++s)
+        {
+            std::size_t begin = std::min(s * segment, size);
+            out += compressText(data + begin, std::min(segment, size - begin), plan.codes, out);
+        }
+    }
+    else
+    {
+        FileUtils::writeContextHeader(dest, plan.contextFrequencies, plan.totalBits);
+        compressContextText(data, size, plan.contextCodes, dest + plan.headerSize);
+    }
+}
+
+uint64_t decompressedSize(const CompressedHeader &header)
+{
+    uint64_t total = 0;
+    if (header.codec == Codec::Interleaved || header.codec == Codec::Raw || header.codec == Codec::Rle)
+    {
+        total = header.originalSize;
+    }
+    else if (header.codec == Codec::Order0)
+    {
+        for (uint32_t freq : header.frequencies)
+            total += freq;
+    }
+    else
+    {
+        for (const FrequencyTable &table : header.contextFrequencies)
+            for (uint32_t freq : table)
+                total += freq;
+    }
+    return total;
+}
+
+uint64_t payloadBytes(const CompressedHeader &header)
+{
+    if (header.codec == Codec::Raw || header.codec == Codec::Rle)
+        return header.storedSize;
+    if (header.codec != Codec::Interleaved)
+        return (header.totalBits + 7) / 8;
+    uint64_t total = 0;
+    for (uint32_t size : header.streamSizes)
+        total += size;
+    return total;
+}
+
+void decompress(const CompressedHeader &header, char *dest, std::size_t destSize)
+{
+    DecodeScratch scratch;
+    decompress(header, dest, destSize, scratch);
+}
+
+void decompress(const CompressedHeader &header, char *dest, std::size_t destSize,
+                DecodeScratch &scratch)
+{
+    if (header.codec == Codec::Order0)
+    {
+        HuffmanTree tree;
+        DecodeTable table;
+        buildHuffmanTree(header.frequencies, tree);
+        buildDecodeTable(tree, table);
+        decompressText(header, tree, table, dest, destSize);
+    }
+    else if (header.codec == Codec::Raw)
+    {
+        if (header.originalSize != destSize)
+            throw std::runtime_error("Compressed data doesn't match its recorded size");
+        if (header.storedSize > header.payloadSize)
+            throw std::runtime_error("Compressed data is shorter than its recorded size");
+        std::memcpy(dest, header.payload, destSize);
+    }
+    else if (header.codec == Codec::Rle)
+    {
+        decompressRuns(header, dest, destSize);
+    }
+    else if (header.codec == Codec::Interleaved)
+    {
+        DecodeTable table;
+        buildCanonicalDecodeTable(header.codeLengths, table);
+        decompressInterleaved(header, table, dest, destSize);
+    }
+    else
+    {
+        decompressContextText(header, dest, destSize, scratch.trees);
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "file_utils.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr uint16_t NO_CHILD = 0xFFFF;
+constexpr std::size_t MAX_NODES = 2 * 256 - 1;
+constexpr unsigned MAX_CODE_LENGTH = 64;
+
+// Tree node stored in HuffmanTree::nodes; children are indices, not pointers.
+struct Node
+{
+    uint64_t freq;
+    uint16_t left;
+    uint16_t right;
+    char ch;
+
+    bool isLeaf() const { return left == NO_CHILD && right == NO_CHILD; }
+};
+
+// Whole tree lives in one fixed array: building it never touches the heap.
+struct HuffmanTree
+{
+    std::array<Node, MAX_NODES> nodes;
+    uint16_t root = NO_CHILD;
+};
+
+// Code bits are right-aligned in `bits`, first bit to emit is the highest.
+struct Code
+{
+    uint64_t bits = 0;
+    unsigned length = 0;
+};
+
+using CodeTable = std::array<Code, 256>;
+
+// Decoders look codes up TABLE_BITS bits at a time. The interleaved codec
+// limits its codes to this length, so each of its codes is one lookup.
+constexpr unsigned TABLE_BITS = 11;
+
+// One slot per TABLE_BITS-bit prefix. Order-0 codes have no length limit:
+// a longer code continues down the tree from `node`, one bit at a time.
+struct DecodeEntry
+{
+    uint16_t node = NO_CHILD; // set when the code is longer than TABLE_BITS
+    uint8_t symbol = 0;
+    uint8_t length = 0;       // 0: no code starts with this prefix
+};
+
+using DecodeTable = std::array<DecodeEntry, 1u << TABLE_BITS>;
+
+// Compression levels trade analysis time for size. Every level stores a
+// block raw when coding wouldn't shrink it; levels 1-6 decide that from a
+// sampled entropy estimate before building any codes (level 1 samples
+// 1 byte in 64, level 6 1 in 2), levels 3 and up also consider RLE, 7 and
+// up measure exactly, 8 and 9 also try the other context order.
+constexpr int MIN_LEVEL = 1;
+constexpr int MAX_LEVEL = 9;
+constexpr int DEFAULT_LEVEL = 6;
+
+// Everything needed to write a .huf image for one input: the statistics,
+// the codes derived from them and the exact output size.
+struct EncodePlan
+{
+    Codec codec = Codec::Order0;
+    FrequencyTable frequencies{};                  // Order0
+    CodeTable codes{};                             // Order0
+    std::vector<FrequencyTable> contextFrequencies; // Order1, indexed by previous byte
+    std::vector<CodeTable> contextCodes;            // Order1, indexed by previous byte
+    CodeLengths codeLengths{};                      // Interleaved
+    std::array<uint64_t, INTERLEAVED_STREAMS> streamBits{}; // Interleaved
+    uint64_t runBytes = 0;                          // Rle
+    uint64_t totalBits = 0;
+    std::size_t headerSize = 0;
+    std::size_t compressedSize = 0; // header + packed bits
+};
+
+// Decoder working memory. Vectors keep their capacity between calls, so a
+// long-lived decoder stops allocating once it has seen its largest input.
+struct DecodeScratch
+{
+    CompressedHeader header;        // parsed image header
+    std::vector<HuffmanTree> trees; // Order1 context trees
+    std::vector<char> block;        // edge blocks of a ranged container decode
+};
+
+// Order-0 building blocks
+void frequencyMap(const char *book, std::size_t size, FrequencyTable &fillThis);
+void buildHuffmanTree(const FrequencyTable &fmap, HuffmanTree &tree);
+void buildCodes(const HuffmanTree &tree, CodeTable &codes);
+void buildDecodeTable(const HuffmanTree &tree, DecodeTable &table);
+std::string codeToString(const Code &code);
+uint64_t encodedBitCount(const FrequencyTable &fmap, const CodeTable &codes);
+std::size_t compressText(const char *text, std::size_t size,
+                         const CodeTable &codes,
+                         char *dest);
+void decompressText(const CompressedHeader &header,
+                    const HuffmanTree &tree, const DecodeTable &table,
+                    char *dest, std::size_t destSize);
+void decodeSymbols(const HuffmanTree &tree, const DecodeTable &table,
+                   const char *payload, std::size_t payloadSize,
+                   char *dest, std::size_t count);
+
+// Order-1 building blocks: one table per preceding byte (0 before the first)
+void contextFrequencyMap(const char *book, std::size_t size, std::vector<FrequencyTable> &fillThis);
+void compressContextText(const char *text, std::size_t size,
+                         const std::vector<CodeTable> &codes,
+                         char *dest);
+void decompressContextText(const CompressedHeader &header,
+                           char *dest, std::size_t destSize,
+                           std::vector<HuffmanTree> &trees);
+
+// Interleaved building blocks: canonical codes of at most TABLE_BITS bits,
+// input split into 4 equal segments, one bitstream each
+void limitCodeLengths(const FrequencyTable &fmap, unsigned maxLength, CodeLengths &lengths);
+void buildCanonicalCodes(const CodeLengths &lengths, CodeTable &codes);
+void buildCanonicalDecodeTable(const CodeLengths &lengths, DecodeTable &table);
+void decompressInterleaved(const CompressedHeader &header, const DecodeTable &table,
+                           char *dest, std::size_t destSize);
+
+// Run-length building blocks: (byte, varint run length) pairs
+uint64_t runLengthBytes(const char *data, std::size_t size);
+std::size_t compressRuns(const char *data, std::size_t size, char *dest);
+void decompressRuns(const CompressedHeader &header, char *dest, std::size_t destSize);
+// For a header parsed from a whole file: false when a raw, run-length or
+// interleaved image doesn't fill the file exactly (raw bytes of the
+// recorded size; runs that sum to it and end at the end of the file; a
+// valid code length table and streams that add up to the payload). Any
+// file can start with "HUFR", "HUFL" or "HUF4", so such files are treated
+// as input to compress. Other codecs always pass.
+bool isExactImage(const CompressedHeader &header);
+
+// Whole-file entry points used by the CLI and the benchmark. The first
+// form always codes with `codec`; the second picks raw, RLE or Huffman
+// coding (`codec`, or at levels 8-9 possibly the other order) per `level`.
+void planCompression(const char *data, std::size_t size, Codec codec, EncodePlan &plan);
+void planCompression(const char *data, std::size_t size, Codec codec, int level, EncodePlan &plan);
+void compressWithPlan(const char *data, std::size_t size, const EncodePlan &plan, char *dest);
+uint64_t decompressedSize(const CompressedHeader &header);
+uint64_t payloadBytes(const CompressedHeader &header); // packed bits after the header
+void decompress(const CompressedHeader &header, char *dest, std::size_t destSize);
+void decompress(const CompressedHeader &header, char *dest, std::size_t destSize,
+                DecodeScratch &scratch);
@@ -0,0 +1,424 @@
+#include "container.h"
+#include "crc32c.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// Layout:
+//   [4 bytes: "HUFB"][1 byte: codec][4 bytes: block_size][8 bytes: original_size]
+//   [block images: each a standalone .huf image; blocks may be raw or RLE
+//    images whatever the codec byte says]
+//   [index: (raw_offset, compressed_offset, raw_size, compressed_size, crc32c) x num_blocks]
+//   [4 bytes: num_blocks][8 bytes: index_offset][4 bytes: index crc32c][4 bytes: "HUFI"]
+
+namespace
+{
+    const char CONTAINER_MAGIC[] = "HUFB";
+    const char INDEX_MAGIC[] = "HUFI";
+    const std::size_t MAGIC_SIZE = 4;
+    const std::size_t HEADER_SIZE = MAGIC_SIZE + 1 + 4 + 8;
+    const std::size_t ENTRY_SIZE = 8 + 8 + 4 + 4 + 4;
+    const std::size_t TRAILER_SIZE = 4 + 8 + 4 + MAGIC_SIZE;
+    const uint32_t MAX_BLOCK_SIZE = 1u << 30;
+    // Bound on any single-image header (an order-1 header is under 400 KB)
+    const uint64_t MAX_IMAGE_HEADER = 1u << 20;
+
+    template <typename T>
+    char *put(char *out, T value)
+    {
+        std::memcpy(out, &value, sizeof(value));
+        return out + sizeof(value);
+    }
+
+    template <typename T>
+    const char *get(const char *in, T &value)
+    {
+        std::memcpy(&value, in, sizeof(value));
+        return in + sizeof(value);
+    }
+}
+
+ContainerWriter::ContainerWriter(Codec codec, uint32_t blockSize, ContainerSink sink, int level)
+    : codec_(codec), blockSize_(blockSize), sink_(std::move(sink)), level_(level)
+{
+    if (blockSize == 0 || blockSize > MAX_BLOCK_SIZE)
+        throw std::runtime_error("Block size must be between 1 byte and 1 GiB");
+}
+
+void ContainerWriter::begin(uint64_t originalSize)
+{
+    char header[HEADER_SIZE];
+    char *out = header;
+    std::memcpy(out, CONTAINER_MAGIC, MAGIC_SIZE);
+    out = put(out + MAGIC_SIZE, static_cast<uint8_t>(codec_));
+    out = put(out, blockSize_);
+    put(out, originalSize);
+    sink_(header, HEADER_SIZE);
+
+    index_.clear();
+    rawOffset_ = 0;
+    offset_ = HEADER_SIZE;
+}
+
+void ContainerWriter::writeBlock(const char *block, uint32_t rawSize)
+{
+    if (rawSize == 0 || rawSize > blockSize_)
+        throw std::runtime_error("Block of " + std::to_string(rawSize) +
+                                 " bytes doesn't fit the container's block size");
+
+    // Plan and scratch buffer are reused across blocks
+    planCompression(block, rawSize, codec_, level_, plan_);
+    if (scratch_.size() < plan_.compressedSize)
+        scratch_.resize(plan_.compressedSize);
+    compressWithPlan(block, rawSize, plan_, scratch_.data());
+
+    BlockIndexEntry entry;
+    entry.rawOffset = rawOffset_;
+    entry.compressedOffset = offset_;
+    entry.rawSize = rawSize;
+    entry.compressedSize = static_cast<uint32_t>(plan_.compressedSize);
+    entry.crc = crc32c(block, rawSize);
+    index_.push_back(entry);
+
+    sink_(scratch_.data(), plan_.compressedSize);
+    rawOffset_ += rawSize;
+    offset_ += plan_.compressedSize;
+}
+
+uint64_t ContainerWriter::finish()
+{
+    std::size_t indexBytes = index_.size() * ENTRY_SIZE;
+    std::size_t tailSize = indexBytes + TRAILER_SIZE;
+    if (scratch_.size() < tailSize)
+        scratch_.resize(tailSize);
+
+    char *out = scratch_.data();
+    for (const BlockIndexEntry &entry : index_)
+    {
+        out = put(out, entry.rawOffset);
+        out = put(out, entry.compressedOffset);
+        out = put(out, entry.rawSize);
+        out = put(out, entry.compressedSize);
+        out = put(out, entry.crc);
+    }
+    uint32_t indexCrc = crc32c(scratch_.data(), indexBytes);
+    out = put(out, static_cast<uint32_t>(index_.size()));
+    out = put(out, offset_);
+    out = put(out, indexCrc);
+    std::memcpy(out, INDEX_MAGIC, MAGIC_SIZE);
+    sink_(scratch_.data(), tailSize);
+
+    return offset_ + tailSize;
+}
+
+ContainerReader::ContainerReader(ContainerSink sink) : sink_(std::move(sink))
+{
+}
+
+void ContainerReader::write(const char *data, std::size_t size)
+{
+    // Drop what earlier calls consumed; the buffer keeps its capacity
+    if (consumed_ > 0)
+    {
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(consumed_));
+        consumed_ = 0;
+    }
+    pending_.insert(pending_.end(), data, data + size);
+    decodeAvailable();
+}
+
+void ContainerReader::decodeAvailable()
+{
+    for (;;)
+    {
+        const char *in = pending_.data() + consumed_;
+        std::size_t available = pending_.size() - consumed_;
+
+        if (state_ == State::Header)
+        {
+            if (available < HEADER_SIZE)
+                return;
+            if (std::memcmp(in, CONTAINER_MAGIC, MAGIC_SIZE) != 0)
+                throw std::runtime_error("Compressed stream is not a block container");
+            uint8_t codec;
+            const char *field = get(in + MAGIC_SIZE, codec);
+            field = get(field, blockSize_);
+            get(field, originalSize_);
+            if (codec > static_cast<uint8_t>(Codec::Interleaved) || blockSize_ == 0 || blockSize_ > MAX_BLOCK_SIZE)
+                throw std::runtime_error("Compressed stream has an invalid header");
+            consumed_ += HEADER_SIZE;
+            offset_ = HEADER_SIZE;
+            state_ = State::Blocks;
+            continue;
+        }
+        if (state_ == State::Index)
+            return; // checked as a whole by finish()
+
+        // A block image never starts with four zero bytes (an order-0 image
+        // has at least one symbol). The index does, as its first raw_offset
+        // is 0, and so does the trailer of an empty container.
+        uint32_t lead;
+        if (available < sizeof(lead))
+            return;
+        get(in, lead);
+        if (lead == 0)
+        {
+            state_ = State::Index;
+            return;
+        }
+
+        CompressedHeader &header = scratch_.header;
+        const uint64_t maxImage = static_cast<uint64_t>(blockSize_) * MAX_CODE_LENGTH / 8 + MAX_IMAGE_HEADER;
+        if (!FileUtils::parseCompressedHeader(in, available, header))
+        {
+            // Most likely the header hasn't fully arrived yet
+            if (available > maxImage)
+                throw std::runtime_error("Corrupted block " + std::to_string(decoded_.size()));
+            return;
+        }
+        std::size_t headerSize = static_cast<std::size_t>(header.payload - in);
+        uint64_t imageSize = headerSize + payloadBytes(header);
+        uint64_t rawSize = decompressedSize(header);
+        if (rawSize == 0 || rawSize > blockSize_ || imageSize > maxImage)
+            throw std::runtime_error("Corrupted block " + std::to_string(decoded_.size()));
+        if (available < imageSize)
+            return;
+        header.payloadSize = static_cast<std::size_t>(imageSize - headerSize);
+
+        if (output_.size() < rawSize)
+            output_.resize(static_cast<std::size_t>(rawSize));
+        decompress(header, output_.data(), static_cast<std::size_t>(rawSize), scratch_);
+
+        BlockIndexEntry entry;
+        entry.rawOffset = rawOffset_;
+        entry.compressedOffset = offset_;
+        entry.rawSize = static_cast<uint32_t>(rawSize);
+        entry.compressedSize = static_cast<uint32_t>(imageSize);
+        entry.crc = crc32c(output_.data(), entry.rawSize);
+        decoded_.push_back(entry);
+
+        sink_(output_.data(), entry.rawSize);
+        rawOffset_ += rawSize;
+        offset_ += imageSize;
+        consumed_ += static_cast<std::size_t>(imageSize);
+    }
+}
+
+uint64_t ContainerReader::finish()
+{
+    if (state_ != State::Index)
+        throw std::runtime_error("Compressed stream is truncated: block index is missing");
+
+    const char *in = pending_.data() + consumed_;
+    std::size_t available = pending_.size() - consumed_;
+    std::size_t indexBytes = decoded_.size() * ENTRY_SIZE;
+    if (available != indexBytes + TRAILER_SIZE ||
+        std::memcmp(in + available - MAGIC_SIZE, INDEX_MAGIC, MAGIC_SIZE) != 0)
+        throw std::runtime_error("Compressed stream has a damaged block index");
+
+    uint32_t numBlocks;
+    uint64_t indexOffset;
+    uint32_t indexCrc;
+    const char *field = get(in + indexBytes, numBlocks);
+    field = get(field, indexOffset);
+    get(field, indexCrc);
+    if (numBlocks != decoded_.size() || indexOffset != offset_)
+        throw std::runtime_error("Compressed stream has a damaged block index");
+    if (crc32c(in, indexBytes) != indexCrc)
+        throw std::runtime_error("Block index checksum mismatch");
+
+    for (std::size_t i = 0; i < decoded_.size(); ++i)
+    {
+        const BlockIndexEntry &seen = decoded_[i];
+        BlockIndexEntry entry;
+        field = get(in + i * ENTRY_SIZE, entry.rawOffset);
+        field = get(field, entry.compressedOffset);
+        field = get(field, entry.rawSize);
+        field = get(field, entry.compressedSize);
+        get(field, entry.crc);
+
+        if (entry.rawOffset != seen.rawOffset || entry.compressedOffset != seen.compressedOffset ||
+            entry.rawSize != seen.rawSize || entry.compressedSize != seen.compressedSize)
+            throw std::runtime_error("Compressed stream has a damaged block index");
+        if (entry.crc != seen.crc)
+            throw std::runtime_error("Checksum mismatch in block " + std::to_string(i));
+    }
+    if (originalSize_ != UNKNOWN_SIZE && originalSize_ != rawOffset_)
+        throw std::runtime_error("Block index does not cover the original size");
+
+    uint64_t total = rawOffset_;
+    pending_.clear();
+    consumed_ = 0;
+    decoded_.clear();
+    state_ = State::Header;
+    rawOffset_ = 0;
+    offset_ = 0;
+    return total;
+}
+
+uint64_t compressContainer(const char *data, std::size_t size,
+                           Codec codec, uint32_t blockSize,
+                           const ContainerSink &sink, int level)
+{
+    ContainerWriter writer(codec, blockSize, sink, level);
+    writer.begin(size);
+    for (std::size_t rawOffset = 0; rawOffset < size; rawOffset += blockSize)
+        writer.writeBlock(data + rawOffset,
+                          static_cast<uint32_t>(std::min<std::size_t>(blockSize, size - rawOffset)));
+    return writer.finish();
+}
+
+namespace
+{
+    // Why a buffer starting "HUFB" isn't a whole container: a missing
+    // trailer, a bad header, or an index that doesn't sit just before the
+    // trailer or fails its CRC. nullptr if none of these.
+    const char *framingError(const char *data, std::size_t size)
+    {
+        if (size < HEADER_SIZE + TRAILER_SIZE ||
+            std::memcmp(data + size - MAGIC_SIZE, INDEX_MAGIC, MAGIC_SIZE) != 0)
+            return "Compressed file is truncated: block index is missing";
+
+        uint8_t codec;
+        uint32_t blockSize;
+        const char *in = get(data + MAGIC_SIZE, codec);
+        get(in, blockSize);
+        if (codec > static_cast<uint8_t>(Codec::Interleaved) || blockSize == 0)
+            return "Compressed file has an invalid header";
+
+        uint32_t numBlocks;
+        uint64_t indexOffset;
+        uint32_t indexCrc;
+        in = get(data + size - TRAILER_SIZE, numBlocks);
+        in = get(in, indexOffset);
+        get(in, indexCrc);
+
+        // The trailer is untrusted, so nothing here adds its fields together
+        uint64_t indexBytes = static_cast<uint64_t>(numBlocks) * ENTRY_SIZE;
+        if (indexBytes > size - HEADER_SIZE - TRAILER_SIZE || indexOffset != size - TRAILER_SIZE - indexBytes)
+            return "Compressed file has a damaged block index";
+        if (crc32c(data + indexOffset, static_cast<std::size_t>(indexBytes)) != indexCrc)
+            return "Block index checksum mismatch";
+        return nullptr;
+    }
+}
+
+bool looksLikeContainer(const char *data, std::size_t size)
+{
+    return size >= HEADER_SIZE && std::memcmp(data, CONTAINER_MAGIC, MAGIC_SIZE) == 0 &&
+           !framingError(data, size);
+}
+
+bool readContainer(const char *data, std::size_t size, Container &container)
+{
+    if (size < HEADER_SIZE || std::memcmp(data, CONTAINER_MAGIC, MAGIC_SIZE) != 0)
+        return false;
+    if (const char *error = framingError(data, size))
+        throw std::runtime_error(error);
+
+    uint8_t codec;
+    const char *in = get(data + MAGIC_SIZE, codec);
+    in = get(in, container.blockSize);
+    get(in, container.originalSize);
+    container.codec = static_cast<Codec>(codec);
+
+    uint32_t numBlocks;
+    uint64_t indexOffset;
+    in = get(data + size - TRAILER_SIZE, numBlocks);
+    get(in, indexOffset);
+
+    container.blocks.resize(numBlocks);
+    in = data + indexOffset;
+    uint64_t expectedRaw = 0;
+    for (BlockIndexEntry &entry : container.blocks)
+    {
+        in = get(in, entry.rawOffset);
+        in = get(in, entry.compressedOffset);
+        in = get(in, entry.rawSize);
+        in = get(in, entry.compressedSize);
+        in = get(in, entry.crc);
+
+        if (entry.rawOffset != expectedRaw || entry.rawSize == 0 ||
+            entry.rawSize > container.blockSize ||
+            entry.compressedOffset < HEADER_SIZE ||
+            entry.compressedSize > indexOffset ||
+            entry.compressedOffset > indexOffset - entry.compressedSize)
+            throw std::runtime_error("Compressed file has a damaged block index");
+        expectedRaw += entry.rawSize;
+    }
+    // Stream encoders can't know the size when they write the header
+    if (container.originalSize == UNKNOWN_SIZE)
+        container.originalSize = expectedRaw;
+    if (expectedRaw != container.originalSize)
+        throw std::runtime_error("Block index does not cover the original size");
+
+    container.data = data;
+    container.size = size;
+    return true;
+}
+
+void decompressContainer(const Container &container,
+                         uint64_t start, uint64_t length,
+                         char *dest)
+{
+    DecodeScratch scratch;
+    decompressContainer(container, start, length, dest, scratch);
+}
+
+void decompressContainer(const Container &container,
+                         uint64_t start, uint64_t length,
+                         char *dest, DecodeScratch &scratch)
+{
+    if (start > container.originalSize || length > container.originalSize - start)
+        throw std::runtime_error("Range " + std::to_string(start) + ":" + std::to_string(length) +
+                                 " is outside the original size of " +
+                                 std::to_string(container.originalSize) + " bytes");
+    if (length == 0)
+        return;
+    const uint64_t end = start + length;
+
+    // First block whose data extends past `start`
+    auto it = std::upper_bound(container.blocks.begin(), container.blocks.end(), start,
+                               [](uint64_t offset, const BlockIndexEntry &entry)
+                               { return offset < entry.rawOffset + entry.rawSize; });
+
+    CompressedHeader &header = scratch.header;
+    for (; it != container.blocks.end() && it->rawOffset < end; ++it)
+    {
+        const BlockIndexEntry &entry = *it;
+        std::size_t blockNumber = static_cast<std::size_t>(it - container.blocks.begin());
+        if (!FileUtils::parseCompressedHeader(container.data + entry.compressedOffset,
+                                              entry.compressedSize, header) ||
+            decompressedSize(header) != entry.rawSize)
+            throw std::runtime_error("Corrupted block " + std::to_string(blockNumber));
+
+        // Blocks wholly inside the range decode in place; edge blocks go
+        // through scratch and only the overlapping slice is copied out
+        bool whole = entry.rawOffset >= start && entry.rawOffset + entry.rawSize <= end;
+        char *target;
+        if (whole)
+        {
+            target = dest + (entry.rawOffset - start);
+        }
+        else
+        {
+            if (scratch.block.size() < entry.rawSize)
+                scratch.block.resize(entry.rawSize);
+            target = scratch.block.data();
+        }
+
+        decompress(header, target, entry.rawSize, scratch);
+        if (crc32c(target, entry.rawSize) != entry.crc)
+            throw std::runtime_error("Checksum mismatch in block " + std::to_string(blockNumber));
+
+        if (!whole)
+        {
+            uint64_t from = std::max(start, entry.rawOffset);
+            uint64_t to = std::min(end, entry.rawOffset + entry.rawSize);
+            std::memcpy(dest + (from - start), scratch.block.data() + (from - entry.rawOffset),
+                        static_cast<std::size_t>(to - from));
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "codec.h"
+#include "file_utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+constexpr uint32_t DEFAULT_BLOCK_SIZE = 1u << 20;
+
+// original_size written by stream encoders, which learn the size only at
+// the end; readers take the size from the index instead.
+constexpr uint64_t UNKNOWN_SIZE = ~uint64_t(0);
+
+// One entry of the trailing seek index.
+struct BlockIndexEntry
+{
+    uint64_t rawOffset = 0;        // offset of the block in the original data
+    uint64_t compressedOffset = 0; // offset of the block image in the .huf file
+    uint32_t rawSize = 0;
+    uint32_t compressedSize = 0;
+    uint32_t crc = 0;              // CRC-32C of the original block bytes
+};
+
+// A parsed block container; blocks point into the caller's buffer.
+struct Container
+{
+    Codec codec = Codec::Order0;
+    uint32_t blockSize = 0;
+    uint64_t originalSize = 0;
+    std::vector<BlockIndexEntry> blocks;
+    const char *data = nullptr;
+    std::size_t size = 0;
+};
+
+// Receives the container bytes in order as they are produced.
+using ContainerSink = std::function<void(const char *, std::size_t)>;
+
+// Writes a container one block at a time, for callers that don't hold the
+// whole input. The plan, scratch buffer and index keep their capacity from
+// one container to the next.
+class ContainerWriter
+{
+public:
+    // Each block is stored raw, run-length coded or Huffman coded with
+    // `codec`, whichever `level` finds smallest (see planCompression).
+    ContainerWriter(Codec codec, uint32_t blockSize, ContainerSink sink, int level = DEFAULT_LEVEL);
+
+    // Starts a new container; originalSize may be UNKNOWN_SIZE.
+    void begin(uint64_t originalSize);
+    // Codes one block of 1..blockSize bytes and emits it.
+    void writeBlock(const char *data, uint32_t size);
+    // Emits the index and trailer. Returns the total bytes emitted.
+    uint64_t finish();
+
+    uint32_t blockSize() const { return blockSize_; }
+
+private:
+    Codec codec_;
+    uint32_t blockSize_;
+    ContainerSink sink_;
+    int level_;
+    EncodePlan plan_;
+    std::vector<char> scratch_;
+    std::vector<BlockIndexEntry> index_;
+    uint64_t rawOffset_ = 0;
+    uint64_t offset_ = 0;
+};
+
+// Push-style reader for a container that arrives in pieces. Each block is
+// decoded and emitted through `sink` as soon as it is complete. The CRCs
+// live in the trailing index, so they are verified by finish(), after the
+// data has been emitted (as with gzip's trailing CRC).
+class ContainerReader
+{
+public:
+    explicit ContainerReader(ContainerSink sink);
+
+    void write(const char *data, std::size_t size);
+    // Checks the index against the decoded blocks and readies the reader for
+    // another container. Returns the number of original bytes emitted.
+    uint64_t finish();
+
+private:
+    enum class State
+    {
+        Header,
+        Blocks,
+        Index
+    };
+
+    void decodeAvailable();
+
+    ContainerSink sink_;
+    DecodeScratch scratch_;
+    std::vector<char> pending_; // received but not yet consumed
+    std::size_t consumed_ = 0;
+    std::vector<char> output_;
+    std::vector<BlockIndexEntry> decoded_;
+    State state_ = State::Header;
+    uint32_t blockSize_ = 0;
+    uint64_t originalSize_ = 0;
+    uint64_t rawOffset_ = 0;
+    uint64_t offset_ = 0;
+};
+
+// Splits data into blocks, codes each one on its own with `codec` (or
+// stores it, per `level`) and emits header, blocks and index through
+// `sink`. Returns the total bytes emitted.
+uint64_t compressContainer(const char *data, std::size_t size,
+                           Codec codec, uint32_t blockSize,
+                           const ContainerSink &sink, int level = DEFAULT_LEVEL);
+
+// Returns false if the buffer isn't a block container; throws if it is one
+// but the header, index or trailer is damaged.
+bool readContainer(const char *data, std::size_t size, Container &container);
+// Same test without the throwing: true if the buffer starts "HUFB" and its
+// trailer, header and index CRC all check out. Any file can start with
+// "HUFB", so the CLI takes files that fail this as input to compress.
+bool looksLikeContainer(const char *data, std::size_t size);
+
+// Decodes original bytes [start, start + length) into dest, touching only
+// the blocks that overlap the range. Every decoded block is CRC-checked.
+void decompressContainer(const Container &container,
+                         uint64_t start, uint64_t length,
+                         char *dest);
+void decompressContainer(const Container &container,
+                         uint64_t start, uint64_t length,
+                         char *dest, DecodeScratch &scratch);
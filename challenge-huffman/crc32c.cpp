@@ -0,0 +1,87 @@
+#include "crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define HUFF_HAVE_SSE42_CRC 1
+#endif
+
+namespace
+{
+    const uint32_t POLY = 0x82F63B78; // reflected Castagnoli polynomial
+
+    // Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes
+    std::array<std::array<uint32_t, 256>, 8> makeTables()
+    {
+        std::array<std::array<uint32_t, 256>, 8> table{};
+        for (uint32_t b = 0; b < 256; ++b)
+        {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ ((crc & 1) ? POLY : 0);
+            table[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; ++b)
+            for (int k = 1; k < 8; ++k)
+                table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xFF];
+        return table;
+    }
+
+    uint32_t crc32cSoftware(uint32_t crc, const unsigned char *p, std::size_t size)
+    {
+        static const auto table = makeTables();
+        while (size >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            word ^= crc;
+            crc = table[7][word & 0xFF] ^ table[6][(word >> 8) & 0xFF] ^
+                  table[5][(word >> 16) & 0xFF] ^ table[4][(word >> 24) & 0xFF] ^
+                  table[3][(word >> 32) & 0xFF] ^ table[2][(word >> 40) & 0xFF] ^
+                  table[1][(word >> 48) & 0xFF] ^ table[0][word >> 56];
+            p += 8;
+            size -= 8;
+        }
+        while (size--)
+            crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xFF];
+        return crc;
+    }
+
+#ifdef HUFF_HAVE_SSE42_CRC
+    __attribute__((target("sse4.2")))
+    uint32_t crc32cHardware(uint32_t crc, const unsigned char *p, std::size_t size)
+    {
+        uint64_t crc64 = crc;
+        while (size >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            crc64 = _mm_crc32_u64(crc64, word);
+            p += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+        while (size--)
+            crc = _mm_crc32_u8(crc, *p++);
+        return crc;
+    }
+#endif
+
+    using CrcFunction = uint32_t (*)(uint32_t, const unsigned char *, std::size_t);
+
+    CrcFunction selectImplementation()
+    {
+#ifdef HUFF_HAVE_SSE42_CRC
+        if (__builtin_cpu_supports("sse4.2"))
+            return crc32cHardware;
+#endif
+        return crc32cSoftware;
+    }
+}
+
+uint32_t crc32c(const char *data, std::size_t size)
+{
+    static const CrcFunction impl = selectImplementation();
+    return ~impl(~0u, reinterpret_cast<const unsigned char *>(data), size);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), as used by iSCSI, ext4 and friends. Uses the SSE4.2
+// crc32 instruction when the CPU has it, a lookup table otherwise.
+uint32_t crc32c(const char *data, std::size_t size);
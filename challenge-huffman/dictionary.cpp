@@ -0,0 +1,180 @@
+#include "dictionary.h"
+#include "crc32c.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    const char DICTIONARY_FILE_MAGIC[] = "HUFD";
+    const std::size_t MAGIC_SIZE = 4;
+    const std::size_t FILE_SIZE = MAGIC_SIZE + 4 + 256 * 4;
+
+    // Process-wide cache; encoders and decoders only come here on a
+    // dictionary they haven't used before.
+    struct Registry
+    {
+        std::mutex mutex;
+        std::unordered_map<uint32_t, DictionaryPtr> byId;
+        std::unordered_map<std::string, DictionaryPtr> byFile;
+    };
+
+    Registry &registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    DictionaryPtr makeDictionary(const FrequencyTable &frequencies)
+    {
+        auto dictionary = std::make_shared<Dictionary>();
+        dictionary->frequencies = frequencies;
+        dictionary->id = crc32c(reinterpret_cast<const char *>(frequencies.data()),
+                                frequencies.size() * sizeof(frequencies[0]));
+        buildHuffmanTree(dictionary->frequencies, dictionary->tree);
+        buildCodes(dictionary->tree, dictionary->codes);
+        buildDecodeTable(dictionary->tree, dictionary->table);
+        for (const Code &code : dictionary->codes)
+            dictionary->maxCodeLength = std::max(dictionary->maxCodeLength, code.length);
+        return dictionary;
+    }
+
+    std::string hexId(uint32_t id)
+    {
+        std::ostringstream out;
+        out << "0x" << std::hex << id;
+        return out.str();
+    }
+
+    uint64_t codedBits(const Dictionary &dictionary, const char *data, std::size_t size)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+        uint64_t totalBits = 0;
+        for (std::size_t i = 0; i < size; ++i)
+            totalBits += dictionary.codes[p[i]].length;
+        return totalBits;
+    }
+}
+
+void DictionaryTrainer::addSample(const char *data, std::size_t size)
+{
+    FrequencyTable sample{};
+    frequencyMap(data, size, sample);
+    for (std::size_t sym = 0; sym < 256; ++sym)
+        counts_[sym] += sample[sym];
+}
+
+DictionaryPtr DictionaryTrainer::build() const
+{
+    // Scale large corpora into 32-bit counts; +1 keeps unseen bytes codable
+    uint64_t largest = *std::max_element(counts_.begin(), counts_.end());
+    uint64_t divisor = largest / (UINT32_MAX - 1) + 1;
+    FrequencyTable frequencies;
+    for (std::size_t sym = 0; sym < 256; ++sym)
+        frequencies[sym] = static_cast<uint32_t>(counts_[sym] / divisor + 1);
+    return makeDictionary(frequencies);
+}
+
+void saveDictionary(const Dictionary &dictionary, const std::string &filename)
+{
+    char image[FILE_SIZE];
+    std::memcpy(image, DICTIONARY_FILE_MAGIC, MAGIC_SIZE);
+    std::memcpy(image + MAGIC_SIZE, &dictionary.id, sizeof(dictionary.id));
+    std::memcpy(image + MAGIC_SIZE + 4, dictionary.frequencies.data(), 256 * 4);
+
+    FileUtils::OutputFile output(filename);
+    output.write(image, FILE_SIZE);
+}
+
+DictionaryPtr loadDictionary(const std::string &filename)
+{
+    Registry &reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto cached = reg.byFile.find(filename);
+        if (cached != reg.byFile.end())
+            return cached->second;
+    }
+
+    FileUtils::MappedFile input(filename);
+    if (input.size() != FILE_SIZE || std::memcmp(input.data(), DICTIONARY_FILE_MAGIC, MAGIC_SIZE) != 0)
+        throw std::runtime_error("Not a dictionary file: " + filename);
+    uint32_t id;
+    std::memcpy(&id, input.data() + MAGIC_SIZE, sizeof(id));
+    FrequencyTable frequencies;
+    std::memcpy(frequencies.data(), input.data() + MAGIC_SIZE + 4, 256 * 4);
+
+    DictionaryPtr dictionary = makeDictionary(frequencies);
+    if (dictionary->id != id)
+        throw std::runtime_error("Dictionary file is damaged: " + filename);
+
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.byId.emplace(dictionary->id, dictionary);
+    return reg.byFile.emplace(filename, dictionary).first->second;
+}
+
+void registerDictionary(const DictionaryPtr &dictionary)
+{
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.byId[dictionary->id] = dictionary;
+}
+
+DictionaryPtr findDictionary(uint32_t id)
+{
+    Registry &reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto found = reg.byId.find(id);
+    return found == reg.byId.end() ? nullptr : found->second;
+}
+
+DictionaryPtr requireDictionary(uint32_t id)
+{
+    DictionaryPtr dictionary = findDictionary(id);
+    if (!dictionary)
+        throw std::runtime_error("Message needs dictionary " + hexId(id) + ", which isn't loaded");
+    return dictionary;
+}
+
+std::size_t maxDictionaryImageSize(const Dictionary &dictionary, std::size_t size)
+{
+    uint64_t maxBits = static_cast<uint64_t>(size) * dictionary.maxCodeLength;
+    return FileUtils::dictionaryHeaderSize(size, maxBits) + static_cast<std::size_t>((maxBits + 7) / 8);
+}
+
+std::size_t dictionaryImageSize(const Dictionary &dictionary, const char *data, std::size_t size)
+{
+    uint64_t totalBits = codedBits(dictionary, data, size);
+    return FileUtils::dictionaryHeaderSize(size, totalBits) + static_cast<std::size_t>((totalBits + 7) / 8);
+}
+
+std::size_t compressWithDictionary(const char *data, std::size_t size,
+                                   const Dictionary &dictionary, char *dest)
+{
+    std::size_t headerSize =
+        FileUtils::writeDictionaryHeader(dest, dictionary.id, size, codedBits(dictionary, data, size));
+    return headerSize + compressText(data, size, dictionary.codes, dest + headerSize);
+}
+
+bool isExactImage(const DictionaryImage &image)
+{
+    // Every dictionary code is 1 to MAX_CODE_LENGTH bits long. Divided
+    // rather than rounded up, so no recorded count can overflow.
+    uint64_t bits = image.totalBits;
+    return image.payloadSize == bits / 8 + (bits % 8 != 0) && bits >= image.originalSize &&
+           bits / MAX_CODE_LENGTH + (bits % MAX_CODE_LENGTH != 0) <= image.originalSize;
+}
+
+void decompressWithDictionary(const DictionaryImage &image, const Dictionary &dictionary,
+                              char *dest, std::size_t destSize)
+{
+    if (image.dictionaryId != dictionary.id)
+        throw std::runtime_error("Message was compressed with dictionary " + hexId(image.dictionaryId) +
+                                 ", not " + hexId(dictionary.id));
+    if (image.originalSize != destSize)
+        throw std::runtime_error("Output size doesn't match the message's recorded size");
+    decodeSymbols(dictionary.tree, dictionary.table, image.payload, image.payloadSize, dest, destSize);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "codec.h"
+#include "file_utils.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A code table trained offline from sample messages and shared by encoder
+// and decoder, so a message carries only the table's ID instead of its
+// frequencies. Codes and tree are built once, when the dictionary is
+// created or loaded, which leaves per-message setup at a pointer compare.
+struct Dictionary
+{
+    uint32_t id = 0; // CRC-32C of the frequency table
+    FrequencyTable frequencies{};
+    CodeTable codes{};
+    HuffmanTree tree;
+    DecodeTable table;
+    unsigned maxCodeLength = 0;
+};
+
+using DictionaryPtr = std::shared_ptr<const Dictionary>;
+
+// Accumulates byte counts over sample messages.
+class DictionaryTrainer
+{
+public:
+    void addSample(const char *data, std::size_t size);
+
+    // Every byte value gets a code, so messages unlike the samples still
+    // encode (just less tightly).
+    DictionaryPtr build() const;
+
+private:
+    std::array<uint64_t, 256> counts_{};
+};
+
+// Dictionary files are ["HUFD"][id][256 x frequency].
+void saveDictionary(const Dictionary &dictionary, const std::string &filename);
+
+// Loads and verifies a dictionary file. Loaded dictionaries are cached by
+// filename and registered by ID, so repeated loads are free.
+DictionaryPtr loadDictionary(const std::string &filename);
+
+// Makes an in-memory dictionary findable by ID. loadDictionary does this
+// for the dictionaries it loads.
+void registerDictionary(const DictionaryPtr &dictionary);
+
+// The dictionary loaded or registered under `id`, or nullptr.
+DictionaryPtr findDictionary(uint32_t id);
+// Same, but throws naming the missing ID.
+DictionaryPtr requireDictionary(uint32_t id);
+
+// Upper bound on the image compressWithDictionary writes for `size` bytes.
+std::size_t maxDictionaryImageSize(const Dictionary &dictionary, std::size_t size);
+// Exact image size, at the cost of a pass over the data.
+std::size_t dictionaryImageSize(const Dictionary &dictionary, const char *data, std::size_t size);
+
+// Writes a "HUFT" image and returns its size.
+std::size_t compressWithDictionary(const char *data, std::size_t size,
+                                   const Dictionary &dictionary, char *dest);
+void decompressWithDictionary(const DictionaryImage &image, const Dictionary &dictionary,
+                              char *dest, std::size_t destSize);
+// For a header parsed from a whole file: false unless the code bits it
+// records exactly fill the rest of the file and fit its original size.
+// Any file can start with "HUFT", so such files are input to compress.
+bool isExactImage(const DictionaryImage &image);
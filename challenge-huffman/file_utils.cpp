@@ -1,202 +1,562 @@
 #include "file_utils.h"
 #include <iostream>
-#include <fstream>
 #include <stdexcept>
-#include <map>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const char DELIMITER[] = "HUFFDATA";
+    const std::size_t DELIMITER_SIZE = 8;
+
+    // Order-1 files start with this magic. Read as a legacy num_chars field
+    // it is far above 256, so the two layouts can't be confused.
+    const char CONTEXT_MAGIC[] = "HUF1";
+    const std::size_t CONTEXT_MAGIC_SIZE = 4;
+
+    // Interleaved (4-stream) images start with this magic
+    const char INTERLEAVED_MAGIC[] = "HUF4";
+    const std::size_t INTERLEAVED_MAGIC_SIZE = 4;
+    const std::size_t PACKED_LENGTHS_SIZE = 256 / 2;
+
+    // Stored and run-length blocks
+    const char RAW_MAGIC[] = "HUFR";
+    const char RLE_MAGIC[] = "HUFL";
+    const std::size_t MODE_MAGIC_SIZE = 4;
+
+    // Messages coded against a shared dictionary start with this magic
+    const char DICTIONARY_MAGIC[] = "HUFT";
+    const std::size_t DICTIONARY_MAGIC_SIZE = 4;
+
+    std::size_t varintSize(uint64_t value)
+    {
+        std::size_t bytes = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            ++bytes;
+        }
+        return bytes;
+    }
+
+    char *writeVarint(char *out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return out;
+    }
+
+    template <typename T>
+    bool readVarint(const char *&in, const char *end, T &value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < sizeof(T) * 8 && in < end; shift += 7)
+        {
+            unsigned char byte = static_cast<unsigned char>(*in++);
+            value |= static_cast<T>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    std::size_t usedSymbols(const FrequencyTable &frequencies)
+    {
+        std::size_t count = 0;
+        for (uint32_t freq : frequencies)
+            count += freq != 0;
+        return count;
+    }
+
+    bool parseContextHeader(const char *data, std::size_t size, CompressedHeader &header)
+    {
+        const char *in = data + CONTEXT_MAGIC_SIZE;
+        const char *end = data + size;
+
+        uint16_t numContexts;
+        if (end - in < static_cast<std::ptrdiff_t>(sizeof(numContexts)))
+            return false;
+        std::memcpy(&numContexts, in, sizeof(numContexts));
+        in += sizeof(numContexts);
+        if (numContexts > 256)
+            return false;
+
+        header.contextFrequencies.assign(256, FrequencyTable{});
+        for (uint16_t i = 0; i < numContexts; ++i)
+        {
+            if (end - in < 2)
+                return false;
+            FrequencyTable &table = header.contextFrequencies[static_cast<unsigned char>(in[0])];
+            unsigned numSymbols = static_cast<unsigned char>(in[1]) + 1u;
+            in += 2;
+            for (unsigned j = 0; j < numSymbols; ++j)
+            {
+                if (in >= end)
+                    return false;
+                unsigned char sym = static_cast<unsigned char>(*in++);
+                if (!readVarint(in, end, table[sym]))
+                    return false;
+            }
+        }
+
+        if (end - in < static_cast<std::ptrdiff_t>(DELIMITER_SIZE + 8) ||
+            std::memcmp(in, DELIMITER, DELIMITER_SIZE) != 0)
+            return false;
+        in += DELIMITER_SIZE;
+        std::memcpy(&header.totalBits, in, sizeof(header.totalBits));
+        in += sizeof(header.totalBits);
+
+        header.codec = Codec::Order1;
+        header.payload = in;
+        header.payloadSize = static_cast<std::size_t>(end - in);
+        return true;
+    }
+
+    bool parseInterleavedHeader(const char *data, std::size_t size, CompressedHeader &header)
+    {
+        const char *in = data + INTERLEAVED_MAGIC_SIZE;
+        const char *end = data + size;
+        if (!readVarint(in, end, header.originalSize))
+            return false;
+        if (end - in < static_cast<std::ptrdiff_t>(PACKED_LENGTHS_SIZE + INTERLEAVED_STREAMS * 4))
+            return false;
+
+        // Two 4-bit lengths per byte, low nibble first
+        for (std::size_t i = 0; i < PACKED_LENGTHS_SIZE; ++i)
+        {
+            unsigned char pair = static_cast<unsigned char>(in[i]);
+            header.codeLengths[2 * i] = pair & 0x0F;
+            header.codeLengths[2 * i + 1] = pair >> 4;
+        }
+        in += PACKED_LENGTHS_SIZE;
+        std::memcpy(header.streamSizes.data(), in, INTERLEAVED_STREAMS * 4);
+        in += INTERLEAVED_STREAMS * 4;
+
+        header.codec = Codec::Interleaved;
+        header.totalBits = 0;
+        header.payload = in;
+        header.payloadSize = static_cast<std::size_t>(end - in);
+        return true;
+    }
+
+    // Raw and RLE images: [magic][varint original_size]([varint run_bytes])[payload]
+    bool parseModeHeader(const char *data, std::size_t size, Codec codec, CompressedHeader &header)
+    {
+        const char *in = data + MODE_MAGIC_SIZE;
+        const char *end = data + size;
+        if (!readVarint(in, end, header.originalSize))
+            return false;
+        header.storedSize = header.originalSize;
+        if (codec == Codec::Rle && !readVarint(in, end, header.storedSize))
+            return false;
+
+        header.codec = codec;
+        header.totalBits = 0;
+        header.payload = in;
+        header.payloadSize = static_cast<std::size_t>(end - in);
+        return true;
+    }
+
+    std::string systemError(const std::string &what, const std::string &filename)
+    {
+        return what + ": " + filename + " (" + std::strerror(errno) + ")";
+    }
+}
 
 namespace FileUtils
 {
-    std::string readFileForParsing(const std::string &filename)
+    MappedFile::MappedFile(const std::string &filename)
     {
-        std::ifstream rfile(filename, std::ios::binary);
-        if (!rfile.is_open())
-            throw std::runtime_error("Could not open file: " + filename);
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error(systemError("Could not open file", filename));
 
-        rfile.seekg(0, std::ios::end);
-        std::streampos pos = rfile.tellg();
-        if (pos < 0)
-            throw std::runtime_error("Failed to determine file size: " + filename);
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            size_ = static_cast<std::size_t>(st.st_size);
+            if (size_ == 0)
+            {
+                ::close(fd);
+                return;
+            }
+            void *addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                ::madvise(addr, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char *>(addr);
+                mapped_ = true;
+                ::close(fd);
+                return;
+            }
+        }
 
-        std::size_t size = static_cast<std::size_t>(pos);
-        rfile.seekg(0, std::ios::beg);
-        if (size == 0)
-            return {};
+        // Not mappable: read it in large chunks instead
+        char chunk[1 << 16];
+        ssize_t got;
+        while ((got = ::read(fd, chunk, sizeof(chunk))) > 0)
+            fallback_.append(chunk, static_cast<std::size_t>(got));
+        ::close(fd);
+        if (got < 0)
+            throw std::runtime_error(systemError("Failed to read complete file", filename));
 
-        std::string content(size, '\0');
-        rfile.read(&content[0], size);
-        if (rfile.fail() || static_cast<std::size_t>(rfile.gcount()) != size)
-            throw std::runtime_error("Failed to read complete file: " + filename);
+        data_ = fallback_.data();
+        size_ = fallback_.size();
+    }
 
-        return content;
+    MappedFile::~MappedFile()
+    {
+        if (mapped_)
+            ::munmap(const_cast<char *>(data_), size_);
+    }
+
+    MappedOutput::MappedOutput(const std::string &filename, std::size_t size)
+        : size_(size), filename_(filename), tempName_(filename + ".XXXXXX")
+    {
+        int fd = ::mkstemp(&tempName_[0]);
+        if (fd < 0)
+            throw std::runtime_error(systemError("Could not create output file", filename));
+        // mkstemp creates 0600; give the file the mode open() would have
+        mode_t mask = ::umask(0);
+        ::umask(mask);
+        ::fchmod(fd, 0644 & ~mask);
+
+        if (size_ > 0)
+        {
+            if (::ftruncate(fd, static_cast<off_t>(size_)) != 0)
+            {
+                ::close(fd);
+                ::unlink(tempName_.c_str());
+                throw std::runtime_error(systemError("Failed to size output file", filename));
+            }
+            void *addr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                ::close(fd);
+                ::unlink(tempName_.c_str());
+                throw std::runtime_error(systemError("Failed to map output file", filename));
+            }
+            data_ = static_cast<char *>(addr);
+        }
+        ::close(fd);
+    }
+
+    MappedOutput::~MappedOutput()
+    {
+        if (data_)
+            ::munmap(data_, size_);
+        if (!committed_)
+            ::unlink(tempName_.c_str());
+    }
+
+    void MappedOutput::commit()
+    {
+        if (::rename(tempName_.c_str(), filename_.c_str()) != 0)
+            throw std::runtime_error(systemError("Could not write output file", filename_));
+        committed_ = true;
+    }
+
+    OutputFile::OutputFile(const std::string &filename) : filename_(filename)
+    {
+        fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0)
+            throw std::runtime_error(systemError("Could not create output file", filename));
+    }
+
+    OutputFile::~OutputFile()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    void OutputFile::write(const char *data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(systemError("Failed to write output file", filename_));
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
     }
 
     void printUsage()
     {
-        std::cout << "\nUsage: ./huff <input_file> [output_file]\n";
+        std::cout << "\nUsage: ./huff [-1..-9] [--order1 | --interleaved] [--dict dict_file] [--range start:len] <input_file> [output_file]\n";
+        std::cout << "       ./huff --train dict_file <sample_file>...\n";
         std::cout << "Example: ./huff test.txt compressed.huf\n";
         std::cout << "If output_file is not specified, uses input_file.huf\n";
+        std::cout << "  -1 .. -9           effort spent choosing how each block is stored (default -6):\n";
+        std::cout << "                     -1 stores incompressible blocks after a sparse sample,\n";
+        std::cout << "                     -3 and up also run-length code, -9 tries both orders\n";
+        std::cout << "  --order1           compress with one Huffman table per preceding byte\n";
+        std::cout << "                     (better ratio on text, larger header, slower)\n";
+        std::cout << "  --interleaved      order-0 with codes of at most 11 bits, split into 4\n";
+        std::cout << "                     bitstreams per block for faster decompression\n";
+        std::cout << "  --range start:len  decompress only original bytes [start, start+len),\n";
+        std::cout << "                     decoding just the blocks that overlap them\n";
+        std::cout << "  --train dict_file  build a shared code table from sample files\n";
+        std::cout << "  --dict dict_file   code against that table: the output header holds only\n";
+        std::cout << "                     its ID, for small messages (also needed to decompress)\n";
     }
 
-    void writeCompressedFile(const std::string &outputFilename,
-                           const std::map<char, int> &frequencies,
-                           const std::string &compressedData)
+    std::size_t compressedHeaderSize(const FrequencyTable &frequencies)
     {
-        std::ofstream outFile(outputFilename, std::ios::binary);
-        if (!outFile.is_open())
-            throw std::runtime_error("Could not create output file: " + outputFilename);
+        return 4 + usedSymbols(frequencies) * 5 + DELIMITER_SIZE + 8;
+    }
 
-        // Write header: frequency table
+    std::size_t writeCompressedHeader(char *dest,
+                                      const FrequencyTable &frequencies,
+                                      uint64_t totalBits)
+    {
         // Format: [num_chars][char1][freq1][char2][freq2]...[DELIMITER][total_bits][packed_data]
-        
+        char *out = dest;
+
         // Write number of unique characters (4 bytes)
-        uint32_t numChars = static_cast<uint32_t>(frequencies.size());
-        outFile.write(reinterpret_cast<const char*>(&numChars), sizeof(numChars));
-        
-        // Write each character and its frequency
-        for (const auto &[ch, freq] : frequencies)
+        uint32_t numChars = static_cast<uint32_t>(usedSymbols(frequencies));
+        std::memcpy(out, &numChars, sizeof(numChars));
+        out += sizeof(numChars);
+
+        // Write each character and its frequency, in char order so the
+        // header stays byte-identical to files written before the table change
+        for (int c = CHAR_MIN; c <= CHAR_MAX; ++c)
         {
+            char ch = static_cast<char>(c);
+            uint32_t frequency = frequencies[static_cast<unsigned char>(ch)];
+            if (frequency == 0)
+                continue;
             // Write character (1 byte)
-            outFile.write(&ch, 1);
+            *out++ = ch;
             // Write frequency (4 bytes)
-            uint32_t frequency = static_cast<uint32_t>(freq);
-            outFile.write(reinterpret_cast<const char*>(&frequency), sizeof(frequency));
+            std::memcpy(out, &frequency, sizeof(frequency));
+            out += sizeof(frequency);
         }
-        
+
         // Write delimiter to separate header from data
-        const char delimiter[] = "HUFFDATA";
-        outFile.write(delimiter, 8);
-        
-        // Write total number of bits in original compressed data (for unpacking)
-        uint64_t totalBits = static_cast<uint64_t>(compressedData.length());
-        outFile.write(reinterpret_cast<const char*>(&totalBits), sizeof(totalBits));
-        
-        // Pack bits into bytes and write compressed data
-        std::string packedData = packBitsToBytes(compressedData);
-        outFile.write(packedData.c_str(), packedData.length());
-        
-        if (outFile.fail())
-            throw std::runtime_error("Failed to write compressed file: " + outputFilename);
-        
-        std::cout << "Successfully wrote compressed file: " << outputFilename << std::endl;
-        std::cout << "Header size: " << (4 + frequencies.size() * 5 + 8 + 8) << " bytes" << std::endl;
-        std::cout << "Original bits: " << compressedData.length() << std::endl;
-        std::cout << "Packed data size: " << packedData.length() << " bytes" << std::endl;
-    }
-
-    std::map<char, int> readFrequencyHeader(const std::string &filename)
-    {
-        std::ifstream inFile(filename, std::ios::binary);
-        if (!inFile.is_open())
-            throw std::runtime_error("Could not open compressed file: " + filename);
-
-        std::map<char, int> frequencies;
-        
-        // Read number of unique characters
-        uint32_t numChars;
-        inFile.read(reinterpret_cast<char*>(&numChars), sizeof(numChars));
-        if (inFile.fail())
-            throw std::runtime_error("Failed to read header from: " + filename);
-        
-        // Read each character and frequency
-        for (uint32_t i = 0; i < numChars; ++i)
+        std::memcpy(out, DELIMITER, DELIMITER_SIZE);
+        out += DELIMITER_SIZE;
+
+        // Write total number of code bits (for unpacking)
+        std::memcpy(out, &totalBits, sizeof(totalBits));
+        out += sizeof(totalBits);
+
+        return static_cast<std::size_t>(out - dest);
+    }
+
+    std::size_t contextHeaderSize(const std::vector<FrequencyTable> &contexts)
+    {
+        std::size_t size = CONTEXT_MAGIC_SIZE + 2;
+        for (const FrequencyTable &table : contexts)
         {
-            char ch;
-            uint32_t freq;
-            
-            inFile.read(&ch, 1);
-            inFile.read(reinterpret_cast<char*>(&freq), sizeof(freq));
-            
-            if (inFile.fail())
-                throw std::runtime_error("Failed to read frequency data from: " + filename);
-            
-            frequencies[ch] = static_cast<int>(freq);
+            if (usedSymbols(table) == 0)
+                continue;
+            size += 2;
+            for (uint32_t freq : table)
+            {
+                if (freq != 0)
+                    size += 1 + varintSize(freq);
+            }
         }
-        
-        // Verify delimiter
-        char delimiter[9] = {0};
-        inFile.read(delimiter, 8);
-        if (inFile.fail() || std::string(delimiter) != "HUFFDATA")
-            throw std::runtime_error("Invalid or corrupted compressed file: " + filename);
-        
-        return frequencies;
+        return size + DELIMITER_SIZE + 8;
     }
 
-    std::string readCompressedData(const std::string &filename)
+    std::size_t writeContextHeader(char *dest,
+                                   const std::vector<FrequencyTable> &contexts,
+                                   uint64_t totalBits)
     {
-        std::ifstream inFile(filename, std::ios::binary);
-        if (!inFile.is_open())
-            throw std::runtime_error("Could not open compressed file: " + filename);
+        // Format: ["HUF1"][num_contexts]
+        //         {[context][num_symbols - 1]{[symbol][varint freq]}...}...
+        //         [DELIMITER][total_bits][packed_data]
+        char *out = dest;
+        std::memcpy(out, CONTEXT_MAGIC, CONTEXT_MAGIC_SIZE);
+        out += CONTEXT_MAGIC_SIZE;
 
-        // Read number of unique characters
-        uint32_t numChars;
-        inFile.read(reinterpret_cast<char*>(&numChars), sizeof(numChars));
-        if (inFile.fail())
-            throw std::runtime_error("Failed to read header from: " + filename);
-        
-        // Skip frequency data
-        inFile.seekg(numChars * 5, std::ios::cur);  // Each entry is 1 byte (char) + 4 bytes (freq)
-        
-        // Skip delimiter
-        inFile.seekg(8, std::ios::cur);
-        
-        // Read total bits
-        uint64_t totalBits;
-        inFile.read(reinterpret_cast<char*>(&totalBits), sizeof(totalBits));
-        if (inFile.fail())
-            throw std::runtime_error("Failed to read total bits from: " + filename);
-        
-        // Read remaining data (packed bits)
-        inFile.seekg(0, std::ios::end);
-        std::streampos endPos = inFile.tellg();
-        std::streampos currentPos = 4 + numChars * 5 + 8 + 8;  // Header size
-        inFile.seekg(currentPos, std::ios::beg);
-        
-        size_t remainingBytes = static_cast<size_t>(endPos - currentPos);
-        std::string packedData(remainingBytes, '\0');
-        inFile.read(&packedData[0], remainingBytes);
-        
-        if (inFile.fail())
-            throw std::runtime_error("Failed to read compressed data from: " + filename);
-        
-        // Unpack bytes back to bit string
-        return unpackBytesToBits(packedData, static_cast<size_t>(totalBits));
-    }
-
-    std::string packBitsToBytes(const std::string &bitString)
-    {
-        std::string result;
-        result.reserve((bitString.length() + 7) / 8);  // Ceiling division
-        
-        for (size_t i = 0; i < bitString.length(); i += 8)
+        uint16_t numContexts = 0;
+        for (const FrequencyTable &table : contexts)
+            numContexts += usedSymbols(table) != 0;
+        std::memcpy(out, &numContexts, sizeof(numContexts));
+        out += sizeof(numContexts);
+
+        for (std::size_t ctx = 0; ctx < contexts.size(); ++ctx)
         {
-            unsigned char byte = 0;
-            for (int j = 0; j < 8 && (i + j) < bitString.length(); ++j)
+            std::size_t numSymbols = usedSymbols(contexts[ctx]);
+            if (numSymbols == 0)
+                continue;
+            *out++ = static_cast<char>(ctx);
+            *out++ = static_cast<char>(numSymbols - 1);
+            for (std::size_t sym = 0; sym < 256; ++sym)
             {
-                if (bitString[i + j] == '1')
-                {
-                    byte |= (1 << (7 - j));  // Set bit from left to right
-                }
+                if (contexts[ctx][sym] == 0)
+                    continue;
+                *out++ = static_cast<char>(sym);
+                out = writeVarint(out, contexts[ctx][sym]);
             }
-            result.push_back(static_cast<char>(byte));
         }
-        
-        return result;
+
+        std::memcpy(out, DELIMITER, DELIMITER_SIZE);
+        out += DELIMITER_SIZE;
+        std::memcpy(out, &totalBits, sizeof(totalBits));
+        out += sizeof(totalBits);
+
+        return static_cast<std::size_t>(out - dest);
+    }
+
+    std::size_t interleavedHeaderSize(uint64_t originalSize)
+    {
+        return INTERLEAVED_MAGIC_SIZE + varintSize(originalSize) + PACKED_LENGTHS_SIZE + INTERLEAVED_STREAMS * 4;
+    }
+
+    std::size_t writeInterleavedHeader(char *dest, uint64_t originalSize,
+                                       const CodeLengths &lengths,
+                                       const std::array<uint32_t, INTERLEAVED_STREAMS> &streamSizes)
+    {
+        // Format: ["HUF4"][varint original_size][256 x 4-bit code length]
+        //         [4 x stream size (jump table)][stream 0][stream 1][stream 2][stream 3]
+        char *out = dest;
+        std::memcpy(out, INTERLEAVED_MAGIC, INTERLEAVED_MAGIC_SIZE);
+        out += INTERLEAVED_MAGIC_SIZE;
+        out = writeVarint(out, originalSize);
+        for (std::size_t i = 0; i < PACKED_LENGTHS_SIZE; ++i)
+            *out++ = static_cast<char>(lengths[2 * i] | (lengths[2 * i + 1] << 4));
+        std::memcpy(out, streamSizes.data(), INTERLEAVED_STREAMS * 4);
+        out += INTERLEAVED_STREAMS * 4;
+        return static_cast<std::size_t>(out - dest);
+    }
+
+    std::size_t varintSize(uint64_t value)
+    {
+        return ::varintSize(value);
+    }
+
+    char *writeVarint(char *out, uint64_t value)
+    {
+        return ::writeVarint(out, value);
+    }
+
+    bool readVarint(const char *&in, const char *end, uint64_t &value)
+    {
+        return ::readVarint(in, end, value);
+    }
+
+    std::size_t rawHeaderSize(uint64_t originalSize)
+    {
+        return MODE_MAGIC_SIZE + varintSize(originalSize);
+    }
+
+    std::size_t writeRawHeader(char *dest, uint64_t originalSize)
+    {
+        // Format: ["HUFR"][varint original_size][original bytes]
+        std::memcpy(dest, RAW_MAGIC, MODE_MAGIC_SIZE);
+        return static_cast<std::size_t>(writeVarint(dest + MODE_MAGIC_SIZE, originalSize) - dest);
+    }
+
+    std::size_t rleHeaderSize(uint64_t originalSize, uint64_t runBytes)
+    {
+        return MODE_MAGIC_SIZE + varintSize(originalSize) + varintSize(runBytes);
+    }
+
+    std::size_t writeRleHeader(char *dest, uint64_t originalSize, uint64_t runBytes)
+    {
+        // Format: ["HUFL"][varint original_size][varint run_bytes]{[byte][varint run_length]}...
+        std::memcpy(dest, RLE_MAGIC, MODE_MAGIC_SIZE);
+        char *out = writeVarint(dest + MODE_MAGIC_SIZE, originalSize);
+        return static_cast<std::size_t>(writeVarint(out, runBytes) - dest);
     }
 
-    std::string unpackBytesToBits(const std::string &packedData, size_t totalBits)
+    bool parseCompressedHeader(const char *data, std::size_t size, CompressedHeader &header)
     {
-        std::string result;
-        result.reserve(totalBits);
-        
-        for (size_t i = 0; i < packedData.length() && result.length() < totalBits; ++i)
+        if (size >= MODE_MAGIC_SIZE && std::memcmp(data, RAW_MAGIC, MODE_MAGIC_SIZE) == 0)
+            return parseModeHeader(data, size, Codec::Raw, header);
+        if (size >= MODE_MAGIC_SIZE && std::memcmp(data, RLE_MAGIC, MODE_MAGIC_SIZE) == 0)
+            return parseModeHeader(data, size, Codec::Rle, header);
+        if (size >= CONTEXT_MAGIC_SIZE && std::memcmp(data, CONTEXT_MAGIC, CONTEXT_MAGIC_SIZE) == 0)
+            return parseContextHeader(data, size, header);
+        if (size >= INTERLEAVED_MAGIC_SIZE && std::memcmp(data, INTERLEAVED_MAGIC, INTERLEAVED_MAGIC_SIZE) == 0)
+            return parseInterleavedHeader(data, size, header);
+
+        // Read number of unique characters
+        uint32_t numChars;
+        if (size < sizeof(numChars))
+            return false;
+        std::memcpy(&numChars, data, sizeof(numChars));
+        if (numChars > 256)
+            return false;
+
+        std::size_t headerSize = sizeof(numChars) + numChars * 5 + DELIMITER_SIZE + 8;
+        if (size < headerSize)
+            return false;
+
+        // Verify delimiter before trusting the frequency entries
+        const char *delimiter = data + sizeof(numChars) + numChars * 5;
+        if (std::memcmp(delimiter, DELIMITER, DELIMITER_SIZE) != 0)
+            return false;
+
+        // Read each character and frequency
+        header.codec = Codec::Order0;
+        header.frequencies.fill(0);
+        const char *entry = data + sizeof(numChars);
+        for (uint32_t i = 0; i < numChars; ++i, entry += 5)
         {
-            unsigned char byte = static_cast<unsigned char>(packedData[i]);
-            for (int j = 7; j >= 0 && result.length() < totalBits; --j)
-            {
-                result.push_back((byte & (1 << j)) ? '1' : '0');
-            }
+            uint32_t freq;
+            std::memcpy(&freq, entry + 1, sizeof(freq));
+            header.frequencies[static_cast<unsigned char>(entry[0])] = freq;
         }
-        
-        return result;
+
+        std::memcpy(&header.totalBits, delimiter + DELIMITER_SIZE, sizeof(header.totalBits));
+        header.payload = data + headerSize;
+        header.payloadSize = size - headerSize;
+        return true;
+    }
+
+    std::size_t dictionaryHeaderSize(uint64_t originalSize, uint64_t totalBits)
+    {
+        return DICTIONARY_MAGIC_SIZE + 4 + varintSize(originalSize) + varintSize(totalBits);
+    }
+
+    std::size_t writeDictionaryHeader(char *dest, uint32_t dictionaryId, uint64_t originalSize, uint64_t totalBits)
+    {
+        // Format: ["HUFT"][dictionary_id][varint original_size][varint total_bits][packed_data]
+        char *out = dest;
+        std::memcpy(out, DICTIONARY_MAGIC, DICTIONARY_MAGIC_SIZE);
+        out += DICTIONARY_MAGIC_SIZE;
+        std::memcpy(out, &dictionaryId, sizeof(dictionaryId));
+        out += sizeof(dictionaryId);
+        out = writeVarint(out, originalSize);
+        out = writeVarint(out, totalBits);
+        return static_cast<std::size_t>(out - dest);
+    }
+
+    bool parseDictionaryHeader(const char *data, std::size_t size, DictionaryImage &image)
+    {
+        if (size < DICTIONARY_MAGIC_SIZE + 4 ||
+            std::memcmp(data, DICTIONARY_MAGIC, DICTIONARY_MAGIC_SIZE) != 0)
+            return false;
+
+        const char *in = data + DICTIONARY_MAGIC_SIZE;
+        const char *end = data + size;
+        std::memcpy(&image.dictionaryId, in, sizeof(image.dictionaryId));
+        in += sizeof(image.dictionaryId);
+        if (!readVarint(in, end, image.originalSize) || !readVarint(in, end, image.totalBits))
+            return false;
+
+        image.payload = in;
+        image.payloadSize = static_cast<std::size_t>(end - in);
+        return true;
     }
 }
@@ -1,17 +1,145 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <map>
+#include <vector>
+
+// Occurrence count for every byte value, indexed by (unsigned char).
+using FrequencyTable = std::array<uint32_t, 256>;
+
+// Code length in bits for every byte value, 0 for unused bytes.
+using CodeLengths = std::array<uint8_t, 256>;
+
+// Entropy coder recorded in the .huf header.
+enum class Codec : uint8_t
+{
+    Order0,     // one static Huffman table (the original format)
+    Order1,     // one static Huffman table per preceding byte
+    Interleaved, // order-0 with length-limited codes, split into 4 bitstreams
+    Raw,         // stored as is: incompressible blocks
+    Rle          // (byte, run length) pairs: blocks made of long runs
+};
+
+constexpr std::size_t INTERLEAVED_STREAMS = 4;
+
+// Everything the .huf header tells us, parsed once from the mapped input.
+struct CompressedHeader
+{
+    Codec codec = Codec::Order0;
+    FrequencyTable frequencies{};                   // Order0
+    std::vector<FrequencyTable> contextFrequencies; // Order1, indexed by previous byte
+    CodeLengths codeLengths{};                      // Interleaved
+    std::array<uint32_t, INTERLEAVED_STREAMS> streamSizes{}; // Interleaved, in bytes
+    uint64_t originalSize = 0;                      // Interleaved, Raw, Rle
+    uint64_t storedSize = 0;                        // Raw, Rle: payload bytes
+    uint64_t totalBits = 0;                         // Order0, Order1
+    const char *payload = nullptr; // packed code bits, points into the input
+    std::size_t payloadSize = 0;
+};
+
+// Header of a message coded against a shared dictionary: no tables, just
+// the dictionary's ID, the original size and the length of the code bits.
+struct DictionaryImage
+{
+    uint32_t dictionaryId = 0;
+    uint64_t originalSize = 0;
+    uint64_t totalBits = 0;
+    const char *payload = nullptr; // packed code bits, points into the input
+    std::size_t payloadSize = 0;
+};
 
 namespace FileUtils
 {
-    std::string readFileForParsing(const std::string &filename);
+    // Read-only view of a whole file. Regular files are memory-mapped;
+    // anything mmap refuses (pipes, devices) is read into an owned buffer.
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &filename);
+        ~MappedFile();
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const char *data() const { return data_; }
+        std::size_t size() const { return size_; }
+
+    private:
+        const char *data_ = nullptr;
+        std::size_t size_ = 0;
+        bool mapped_ = false;
+        std::string fallback_;
+    };
+
+    // Output file created at its final size and mapped writable, so the
+    // codec can write straight into the page cache. The data goes to a
+    // temporary file next to `filename`, which commit() renames into place;
+    // if the decoder throws first, the temporary is removed and an
+    // existing file of that name is left untouched.
+    class MappedOutput
+    {
+    public:
+        MappedOutput(const std::string &filename, std::size_t size);
+        ~MappedOutput();
+        MappedOutput(const MappedOutput &) = delete;
+        MappedOutput &operator=(const MappedOutput &) = delete;
+
+        char *data() { return data_; }
+        std::size_t size() const { return size_; }
+
+        void commit();
+
+    private:
+        char *data_ = nullptr;
+        std::size_t size_ = 0;
+        std::string filename_;
+        std::string tempName_;
+        bool committed_ = false;
+    };
+
+    // Sequential writer for outputs whose size isn't known up front; callers
+    // hand it large chunks, so it writes straight through without buffering.
+    class OutputFile
+    {
+    public:
+        explicit OutputFile(const std::string &filename);
+        ~OutputFile();
+        OutputFile(const OutputFile &) = delete;
+        OutputFile &operator=(const OutputFile &) = delete;
+
+        void write(const char *data, std::size_t size);
+
+    private:
+        int fd_ = -1;
+        std::string filename_;
+    };
+
     void printUsage();
-    void writeCompressedFile(const std::string &outputFilename,
-                           const std::map<char, int> &frequencies,
-                           const std::string &compressedData);
-    std::map<char, int> readFrequencyHeader(const std::string &filename);
-    std::string readCompressedData(const std::string &filename);
-    std::string packBitsToBytes(const std::string &bitString);
-    std::string unpackBytesToBits(const std::string &packedData, size_t totalBits);
+
+    // LEB128 varints, as used throughout the headers
+    std::size_t varintSize(uint64_t value);
+    char *writeVarint(char *out, uint64_t value);
+    bool readVarint(const char *&in, const char *end, uint64_t &value);
+
+    std::size_t compressedHeaderSize(const FrequencyTable &frequencies);
+    std::size_t writeCompressedHeader(char *dest,
+                                      const FrequencyTable &frequencies,
+                                      uint64_t totalBits);
+    std::size_t contextHeaderSize(const std::vector<FrequencyTable> &contexts);
+    std::size_t writeContextHeader(char *dest,
+                                   const std::vector<FrequencyTable> &contexts,
+                                   uint64_t totalBits);
+    std::size_t interleavedHeaderSize(uint64_t originalSize);
+    std::size_t writeInterleavedHeader(char *dest, uint64_t originalSize,
+                                       const CodeLengths &lengths,
+                                       const std::array<uint32_t, INTERLEAVED_STREAMS> &streamSizes);
+    std::size_t rawHeaderSize(uint64_t originalSize);
+    std::size_t writeRawHeader(char *dest, uint64_t originalSize);
+    std::size_t rleHeaderSize(uint64_t originalSize, uint64_t runBytes);
+    std::size_t writeRleHeader(char *dest, uint64_t originalSize, uint64_t runBytes);
+    bool parseCompressedHeader(const char *data, std::size_t size, CompressedHeader &header);
+    std::size_t dictionaryHeaderSize(uint64_t originalSize, uint64_t totalBits);
+    std::size_t writeDictionaryHeader(char *dest, uint32_t dictionaryId, uint64_t originalSize, uint64_t totalBits);
+    bool parseDictionaryHeader(const char *data, std::size_t size, DictionaryImage &image);
 }
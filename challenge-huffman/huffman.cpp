@@ -1,392 +1,196 @@
-#include "file_utils.h"
-#include <iostream>
-#include <fstream>
+#include "huffman.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
-#include <map>
-#include <cstddef>
-#include <cctype>
-#include <iomanip>
 #include <string>
-#include <unordered_map>
-#include <sstream>
-#include <memory>
-#include <queue>
+#include <utility>
 
-struct Node
+namespace
 {
-    char ch;
-    int freq;
-    std::shared_ptr<Node> left;
-    std::shared_ptr<Node> right;
-
-    Node(char c, int f) : ch(c), freq(f) {}
-    Node(char c, int f, std::shared_ptr<Node> l, std::shared_ptr<Node> r)
-        : ch(c), freq(f), left(std::move(l)), right(std::move(r)) {}
-    bool isLeaf() const { return !left && !right; }
-};
+    void checkCapacity(uint64_t needed, std::size_t capacity)
+    {
+        if (needed > capacity)
+            throw std::runtime_error("Output buffer too small: need " + std::to_string(needed) +
+                                     " bytes, have " + std::to_string(capacity));
+    }
+}
 
-struct Compare
+namespace Huffman
 {
-    bool operator()(const std::shared_ptr<Node> &a, const std::shared_ptr<Node> &b)
-        const
+    Encoder::Encoder(Codec codec, int level) : codec_(codec), level_(level)
     {
-        return a->freq > b->freq; // min-heap
     }
-};
-
-using MinHeap = std::priority_queue<
-    std::shared_ptr<Node>,
-    std::vector<std::shared_ptr<Node>>,
-    Compare>;
 
-void frequencyMap(const std::string &book, std::map<char, int> &fillThis);
-void printFrequency(const std::map<char, int> &freq);
-std::shared_ptr<Node> buildHuffmanTree(const std::map<char, int> &fmap);
-void buildCodes(const std::shared_ptr<Node>& node,
-                const std::string& path,
-                std::unordered_map<char, std::string>& codes);
-std::string compressText(const std::string &text, 
-                        const std::unordered_map<char, std::string> &codes);
-std::string generateOutputFilename(const std::string &inputFilename);
-std::string decompressText(const std::string &compressedBits, 
-                          const std::shared_ptr<Node> &root);
-bool isCompressedFile(const std::string &filename);
-
-int main(int argc, char **argv)
-{
-    if (argc < 2 || argc > 3)
+    Encoder::Encoder(DictionaryPtr dictionary) : codec_(Codec::Order0), dictionary_(std::move(dictionary))
     {
-        FileUtils::printUsage();
-        return 1;
     }
-    
-    try
+
+    std::string_view Encoder::encode(const char *data, std::size_t size)
     {
-        std::string inputFilename = argv[1];
-        std::string outputFilename;
-        
-        if (argc == 3)
+        if (dictionary_)
         {
-            outputFilename = argv[2];
+            // Codes are fixed, so write against the worst case
+            std::size_t bound = maxDictionaryImageSize(*dictionary_, size);
+            if (output_.size() < bound)
+                output_.resize(bound);
+            return std::string_view(output_.data(), compressWithDictionary(data, size, *dictionary_, output_.data()));
         }
-        
-        // Check if input file is a compressed file
-        if (isCompressedFile(inputFilename))
+
+        planCompression(data, size, codec_, level_, plan_);
+        // Grow only: resize() would re-zero the tail on every call
+        if (output_.size() < plan_.compressedSize)
+            output_.resize(plan_.compressedSize);
+        compressWithPlan(data, size, plan_, output_.data());
+        return std::string_view(output_.data(), plan_.compressedSize);
+    }
+
+    std::size_t Encoder::encode(const char *data, std::size_t size, char *dest, std::size_t capacity)
+    {
+        if (dictionary_)
         {
-            // DECOMPRESSION MODE
-            std::cout << "Decompression mode detected.\n";
-            
-            if (argc == 2)
-            {
-                // Generate output filename by removing .huf extension
-                size_t lastDot = inputFilename.find_last_of('.');
-                if (lastDot != std::string::npos && inputFilename.substr(lastDot) == ".huf")
-                {
-                    outputFilename = inputFilename.substr(0, lastDot) + "_decompressed.txt";
-                }
-                else
-                {
-                    outputFilename = inputFilename + "_decompressed.txt";
-                }
-            }
-            
-            // Step 6: Read header and rebuild frequency map
-            std::map<char, int> frequencies = FileUtils::readFrequencyHeader(inputFilename);
-            
-            // Rebuild Huffman tree from frequencies
-            auto root = buildHuffmanTree(frequencies);
-            
-            // Step 7: Read compressed data and decompress
-            std::string compressedBits = FileUtils::readCompressedData(inputFilename);
-            std::string decompressedText = decompressText(compressedBits, root);
-            
-            // Write decompressed text to output file
-            std::ofstream outFile(outputFilename);
-            if (!outFile.is_open())
-                throw std::runtime_error("Could not create output file: " + outputFilename);
-            
-            outFile.write(decompressedText.c_str(), decompressedText.length());
-            if (outFile.fail())
-                throw std::runtime_error("Failed to write decompressed file: " + outputFilename);
-            
-            std::cout << "Successfully decompressed to: " << outputFilename << std::endl;
-            std::cout << "Decompressed size: " << decompressedText.length() << " bytes" << std::endl;
+            // Count exactly only when the worst case doesn't fit
+            if (capacity < maxDictionaryImageSize(*dictionary_, size))
+                checkCapacity(dictionaryImageSize(*dictionary_, data, size), capacity);
+            return compressWithDictionary(data, size, *dictionary_, dest);
         }
-        else
-        {
-            // COMPRESSION MODE
-            std::cout << "Compression mode detected.\n";
-            
-            if (argc == 2)
-            {
-                outputFilename = generateOutputFilename(inputFilename);
-            }
-            
-            // Read input file
-            std::string fileContent = FileUtils::readFileForParsing(inputFilename);
-            
-            if (fileContent.empty())
-            {
-                std::cout << "Input file is empty. Nothing to compress.\n";
-                return 0;
-            }
-            
-            // Build frequency map
-            std::map<char, int> wordFrequency;
-            frequencyMap(fileContent, wordFrequency);
-            
-            // Build Huffman tree and generate codes
-            auto root = buildHuffmanTree(wordFrequency);
-            std::unordered_map<char, std::string> codes;
-            buildCodes(root, "", codes);
 
-            // Display the generated codes
-            std::cout << "\n--- HUFFMAN CODES ---\n";
-            for (const auto &[ch, code] : codes)
-            {
-                if (std::isprint(static_cast<unsigned char>(ch)))
-                    std::cout << "'" << ch << "' -> " << code << "\n";
-                else
-                    std::cout << "0x" << std::hex
-                              << (static_cast<unsigned char>(ch) & 0xFF)
-                              << std::dec << " -> " << code << "\n";
-            }
-            
-            // Compress the text
-            std::string compressedData = compressText(fileContent, codes);
-            
-            // Write compressed file with header
-            FileUtils::writeCompressedFile(outputFilename, wordFrequency, compressedData);
-            
-            // Display compression statistics
-            std::cout << "\n--- COMPRESSION STATISTICS ---\n";
-            std::cout << "Original size: " << fileContent.size() << " bytes (" 
-                      << (fileContent.size() * 8) << " bits)\n";
-            std::cout << "Compressed bits: " << compressedData.length() << " bits\n";
-            std::cout << "Packed size: " << ((compressedData.length() + 7) / 8) << " bytes\n";
-            
-            if (!fileContent.empty())
-            {
-                double compressionRatio = static_cast<double>(compressedData.length()) / 
-                                         (fileContent.size() * 8) * 100.0;
-                std::cout << "Compression ratio: " << std::fixed << std::setprecision(2) 
-                          << compressionRatio << "%\n";
-                std::cout << "Space saved: " << std::fixed << std::setprecision(2)
-                          << (100.0 - compressionRatio) << "%\n";
-            }
-        }
-        
-        return 0;
+        planCompression(data, size, codec_, level_, plan_);
+        checkCapacity(plan_.compressedSize, capacity);
+        compressWithPlan(data, size, plan_, dest);
+        return plan_.compressedSize;
     }
-    catch (const std::exception &e)
+
+    void Encoder::reserve(std::size_t compressedBytes)
     {
-        std::cerr << "Error: " << e.what() << "\n";
-        return 1;
+        if (output_.size() < compressedBytes)
+            output_.resize(compressedBytes);
     }
-}
 
-void frequencyMap(const std::string &book, std::map<char, int> &fillThis)
-{
-    for (std::size_t i = 0; i < book.size(); ++i)
+    uint64_t Decoder::inspect(const char *data, std::size_t size)
     {
-        if (fillThis.find(book[i]) != fillThis.end())
+        if (FileUtils::parseDictionaryHeader(data, size, dictionaryImage_) && isExactImage(dictionaryImage_))
         {
-            fillThis[book[i]] = fillThis[book[i]] + 1;
+            framing_ = Framing::Dictionary;
+            return dictionaryImage_.originalSize;
         }
-        else
+        if (readContainer(data, size, container_))
         {
-            fillThis[book[i]] = 1;
+            framing_ = Framing::Container;
+            return container_.originalSize;
         }
+        if (!FileUtils::parseCompressedHeader(data, size, scratch_.header) || !isExactImage(scratch_.header))
+            throw std::runtime_error("Input is not Huffman-compressed data");
+        framing_ = Framing::Image;
+        return decompressedSize(scratch_.header);
     }
-}
-
-void printFrequency(const std::map<char, int> &freq)
-{
-    std::cout << "\n--- CHARACTER FREQUENCY ANALYSIS ---\n";
 
-    for (const auto &pair : freq)
+    void Decoder::decodeInto(char *dest, uint64_t size)
     {
-        char ch = pair.first;
-        int count = pair.second;
-
-        // Handle printable ASCII characters
-        if (std::isprint(static_cast<unsigned char>(ch)))
-        {
-            std::cout << "'" << ch << "': " << count << std::endl;
-        }
-        // Handle common whitespace characters
-        else if (ch == '\n')
-        {
-            std::cout << "'\\n' (newline): " << count << std::endl;
-        }
-        else if (ch == '\r')
-        {
-            std::cout << "'\\r' (carriage return): " << count << std::endl;
-        }
-        else if (ch == '\t')
-        {
-            std::cout << "'\\t' (tab): " << count << std::endl;
-        }
-        else if (ch == ' ')
-        {
-            std::cout << "' ' (space): " << count << std::endl;
-        }
-        // Handle non-printable characters (including UTF-8 bytes)
-        else
-        {
-            std::cout << "0x" << std::hex << std::setfill('0') << std::setw(2)
-                      << (static_cast<unsigned char>(ch) & 0xFF) << std::dec
-                      << " (non-printable/UTF-8 byte): " << count << std::endl;
+        switch (framing_)
+        {
+        case Framing::Dictionary:
+            // Only a change of dictionary goes to the shared registry
+            if (!dictionary_ || dictionary_->id != dictionaryImage_.dictionaryId)
+                dictionary_ = requireDictionary(dictionaryImage_.dictionaryId);
+            decompressWithDictionary(dictionaryImage_, *dictionary_, dest, static_cast<std::size_t>(size));
+            break;
+        case Framing::Container:
+            decompressContainer(container_, 0, size, dest, scratch_);
+            break;
+        case Framing::Image:
+            decompress(scratch_.header, dest, static_cast<std::size_t>(size), scratch_);
+            break;
         }
     }
-}
-
-std::shared_ptr<Node> buildHuffmanTree(const std::map<char, int> &fmap)
-{
-    MinHeap huffHeap;
 
-    for (const auto &[ch, count] : fmap)
+    uint64_t Decoder::decodedSize(const char *data, std::size_t size)
     {
-        huffHeap.push(std::make_shared<Node>(ch, count));
+        return inspect(data, size);
     }
-    if (huffHeap.empty())
-        return nullptr;
-    if (huffHeap.size() == 1)
+
+    std::string_view Decoder::decode(const char *data, std::size_t size)
     {
-        // Common trick: make a parent so codes still exist
-        auto only = huffHeap.top();
-        huffHeap.pop();
-        return std::make_shared<Node>('\0', only->freq, only, nullptr);
+        uint64_t decoded = inspect(data, size);
+        if (output_.size() < decoded)
+            output_.resize(static_cast<std::size_t>(decoded));
+        decodeInto(output_.data(), decoded);
+        return std::string_view(output_.data(), static_cast<std::size_t>(decoded));
     }
-    while (huffHeap.size() > 1)
-    {
-        auto left = huffHeap.top();
-        huffHeap.pop();
-        auto right = huffHeap.top();
-        huffHeap.pop();
 
-        auto merged = std::make_shared<Node>(
-            '\0', left->freq + right->freq, left, right);
-        huffHeap.push(merged);
+    std::size_t Decoder::decode(const char *data, std::size_t size, char *dest, std::size_t capacity)
+    {
+        uint64_t decoded = inspect(data, size);
+        checkCapacity(decoded, capacity);
+        decodeInto(dest, decoded);
+        return static_cast<std::size_t>(decoded);
     }
-    return huffHeap.top(); // root
-}
 
-void buildCodes(const std::shared_ptr<Node>& node,
-                const std::string& path,
-                std::unordered_map<char, std::string>& codes) {
-    if (!node) return;
-
-    if (node->isLeaf()) {
-        // If only one symbol existed, path could be empty: assign "0"
-        codes[node->ch] = path.empty() ? "0" : path;
-        return;
+    void Decoder::reserve(std::size_t decodedBytes)
+    {
+        if (output_.size() < decodedBytes)
+            output_.resize(decodedBytes);
     }
 
-    buildCodes(node->left,  path + "0", codes);
-    buildCodes(node->right, path + "1", codes);
-}
+    StreamEncoder::StreamEncoder(ContainerSink sink, Codec codec, uint32_t blockSize, int level)
+        : writer_(codec, blockSize, std::move(sink), level), block_(blockSize)
+    {
+    }
 
-std::string compressText(const std::string &text, 
-                        const std::unordered_map<char, std::string> &codes)
-{
-    std::ostringstream compressed;
-    
-    for (char ch : text)
+    void StreamEncoder::write(const char *data, std::size_t size)
     {
-        auto it = codes.find(ch);
-        if (it != codes.end())
+        if (!started_)
         {
-            compressed << it->second;
+            writer_.begin(UNKNOWN_SIZE);
+            started_ = true;
         }
-        else
+
+        const std::size_t blockSize = writer_.blockSize();
+        while (size > 0)
         {
-            throw std::runtime_error("Character not found in Huffman codes: " + std::to_string(static_cast<unsigned char>(ch)));
+            // Whole blocks are coded straight from the caller's buffer
+            if (filled_ == 0 && size >= blockSize)
+            {
+                writer_.writeBlock(data, static_cast<uint32_t>(blockSize));
+                data += blockSize;
+                size -= blockSize;
+                continue;
+            }
+
+            std::size_t take = std::min(size, blockSize - filled_);
+            std::memcpy(block_.data() + filled_, data, take);
+            filled_ += take;
+            data += take;
+            size -= take;
+            if (filled_ == blockSize)
+            {
+                writer_.writeBlock(block_.data(), static_cast<uint32_t>(filled_));
+                filled_ = 0;
+            }
         }
     }
-    
-    return compressed.str();
-}
 
-std::string generateOutputFilename(const std::string &inputFilename)
-{
-    size_t lastDot = inputFilename.find_last_of('.');
-    if (lastDot != std::string::npos)
+    uint64_t StreamEncoder::finish()
     {
-        return inputFilename.substr(0, lastDot) + ".huf";
+        if (!started_)
+            writer_.begin(UNKNOWN_SIZE);
+        if (filled_ > 0)
+            writer_.writeBlock(block_.data(), static_cast<uint32_t>(filled_));
+        filled_ = 0;
+        started_ = false;
+        return writer_.finish();
     }
-    return inputFilename + ".huf";
-}
 
-std::string decompressText(const std::string &compressedBits, 
-                          const std::shared_ptr<Node> &root)
-{
-    if (!root || compressedBits.empty())
-        return "";
-    
-    std::string result;
-    auto current = root;
-    
-    for (char bit : compressedBits)
+    StreamDecoder::StreamDecoder(ContainerSink sink) : reader_(std::move(sink))
     {
-        // Traverse tree based on bit value
-        if (bit == '0')
-        {
-            current = current->left;
-        }
-        else if (bit == '1')
-        {
-            current = current->right;
-        }
-        else
-        {
-            throw std::runtime_error("Invalid bit in compressed data: " + std::to_string(bit));
-        }
-        
-        // If we reach a leaf node, we've found a character
-        if (current && current->isLeaf())
-        {
-            result += current->ch;
-            current = root;  // Reset to root for next character
-        }
-        
-        // Safety check - if current is null, something went wrong
-        if (!current)
-        {
-            throw std::runtime_error("Invalid path in Huffman tree during decompression");
-        }
     }
-    
-    return result;
-}
 
-bool isCompressedFile(const std::string &filename)
-{
-    try
+    void StreamDecoder::write(const char *data, std::size_t size)
     {
-        std::ifstream file(filename, std::ios::binary);
-        if (!file.is_open())
-            return false;
-        
-        // Read first 4 bytes to get number of characters
-        uint32_t numChars;
-        file.read(reinterpret_cast<char*>(&numChars), sizeof(numChars));
-        if (file.fail())
-            return false;
-        
-        // Skip frequency data
-        file.seekg(numChars * 5, std::ios::cur);
-        
-        // Check for delimiter
-        char delimiter[9] = {0};
-        file.read(delimiter, 8);
-        if (file.fail())
-            return false;
-        
-        return std::string(delimiter) == "HUFFDATA";
+        reader_.write(data, size);
     }
-    catch (...)
+
+    uint64_t StreamDecoder::finish()
     {
-        return false;
+        return reader_.finish();
     }
 }
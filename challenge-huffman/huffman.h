@@ -0,0 +1,125 @@
+#pragma once
+
+#include "codec.h"
+#include "container.h"
+#include "dictionary.h"
+#include "file_utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// In-process API over the codec, for callers that compress many payloads
+// without going through files. Every object keeps its tables, scratch
+// buffers and output buffer between calls: once an object has seen its
+// largest input, later calls don't allocate. Objects are not thread-safe;
+// use one per thread.
+namespace Huffman
+{
+    // Buffer-to-buffer compression. Each message becomes one self-contained
+    // single image (no container or index), the smallest framing there is.
+    // With a dictionary the image header is just the dictionary's ID and the
+    // message size, which is what makes sub-4 KB messages worth coding.
+    class Encoder
+    {
+    public:
+        // `level` picks between raw, RLE and `codec` per message, as for
+        // container blocks; see planCompression.
+        explicit Encoder(Codec codec = Codec::Order0, int level = DEFAULT_LEVEL);
+        explicit Encoder(DictionaryPtr dictionary);
+
+        // Compresses into the encoder's output buffer. The view stays valid
+        // until the next call on this encoder.
+        std::string_view encode(const char *data, std::size_t size);
+        // Compresses into caller memory and returns the bytes written.
+        // Throws if capacity is too small; nothing is written in that case.
+        std::size_t encode(const char *data, std::size_t size, char *dest, std::size_t capacity);
+
+        // Grows the output buffer up front so encode() never has to.
+        void reserve(std::size_t compressedBytes);
+
+    private:
+        Codec codec_;
+        int level_ = DEFAULT_LEVEL;
+        DictionaryPtr dictionary_;
+        EncodePlan plan_;
+        std::vector<char> output_;
+    };
+
+    // Buffer-to-buffer decompression of anything the library or the CLI
+    // writes: single images, dictionary images and block containers.
+    // Dictionary images are decoded with the dictionary registered under
+    // their ID (see loadDictionary); the decoder keeps the last one it used.
+    class Decoder
+    {
+    public:
+        // Original size recorded in a compressed buffer.
+        uint64_t decodedSize(const char *data, std::size_t size);
+
+        // Decompresses into the decoder's output buffer. The view stays
+        // valid until the next call on this decoder.
+        std::string_view decode(const char *data, std::size_t size);
+        // Decompresses into caller memory and returns the bytes written.
+        // Throws if capacity is too small.
+        std::size_t decode(const char *data, std::size_t size, char *dest, std::size_t capacity);
+
+        void reserve(std::size_t decodedBytes);
+
+    private:
+        // Recognises the framing and parses its header; returns the original size
+        uint64_t inspect(const char *data, std::size_t size);
+        void decodeInto(char *dest, uint64_t size);
+
+        enum class Framing
+        {
+            Image,
+            Dictionary,
+            Container
+        };
+
+        Framing framing_ = Framing::Image;
+        Container container_;
+        DictionaryImage dictionaryImage_;
+        DictionaryPtr dictionary_;
+        DecodeScratch scratch_;
+        std::vector<char> output_;
+    };
+
+    // Compresses data that arrives in pieces into a block container,
+    // emitting each block through the sink as soon as it fills.
+    class StreamEncoder
+    {
+    public:
+        explicit StreamEncoder(ContainerSink sink,
+                               Codec codec = Codec::Order0,
+                               uint32_t blockSize = DEFAULT_BLOCK_SIZE,
+                               int level = DEFAULT_LEVEL);
+
+        void write(const char *data, std::size_t size);
+        // Codes the partial last block and emits the index. The encoder is
+        // then ready for a new stream. Returns the compressed bytes emitted.
+        uint64_t finish();
+
+    private:
+        ContainerWriter writer_;
+        std::vector<char> block_;
+        std::size_t filled_ = 0;
+        bool started_ = false;
+    };
+
+    // Decompresses a block container that arrives in pieces, emitting the
+    // original bytes block by block. Checksums are verified by finish().
+    class StreamDecoder
+    {
+    public:
+        explicit StreamDecoder(ContainerSink sink);
+
+        void write(const char *data, std::size_t size);
+        // Verifies the index and block checksums, then readies the decoder
+        // for a new stream. Returns the original bytes emitted.
+        uint64_t finish();
+
+    private:
+        ContainerReader reader_;
+    };
+}
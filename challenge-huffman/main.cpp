@@ -0,0 +1,409 @@
+#include "codec.h"
+#include "container.h"
+#include "dictionary.h"
+#include "file_utils.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cctype>
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+void printFrequency(const FrequencyTable &freq);
+std::string generateOutputFilename(const std::string &inputFilename);
+std::string generateDecompressedFilename(const std::string &inputFilename);
+bool parseRange(const std::string &text, uint64_t &start, uint64_t &length);
+
+int main(int argc, char **argv)
+{
+    // Options may appear anywhere; the remaining arguments are the files
+    Codec codec = Codec::Order0;
+    int level = DEFAULT_LEVEL;
+    bool hasRange = false;
+    uint64_t rangeStart = 0;
+    uint64_t rangeLength = 0;
+    std::string trainPath;
+    std::string dictionaryPath;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--order1")
+        {
+            codec = Codec::Order1;
+        }
+        else if (arg == "--interleaved")
+        {
+            codec = Codec::Interleaved;
+        }
+        else if (arg.size() == 2 && arg[0] == '-' && arg[1] >= '0' + MIN_LEVEL && arg[1] <= '0' + MAX_LEVEL)
+        {
+            level = arg[1] - '0';
+        }
+        else if (arg == "--train" || arg == "--dict")
+        {
+            if (i + 1 >= argc)
+            {
+                std::cerr << arg << " expects a dictionary file\n";
+                FileUtils::printUsage();
+                return 1;
+            }
+            (arg == "--train" ? trainPath : dictionaryPath) = argv[++i];
+        }
+        else if (arg == "--range")
+        {
+            if (i + 1 >= argc || !parseRange(argv[i + 1], rangeStart, rangeLength))
+            {
+                std::cerr << "--range expects start:len\n";
+                FileUtils::printUsage();
+                return 1;
+            }
+            hasRange = true;
+            ++i;
+        }
+        else if (arg.compare(0, 2, "--") == 0)
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            FileUtils::printUsage();
+            return 1;
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if (!trainPath.empty())
+    {
+        if (files.empty())
+        {
+            std::cerr << "--train needs at least one sample file\n";
+            FileUtils::printUsage();
+            return 1;
+        }
+        try
+        {
+            // TRAINING MODE: one table from all samples, saved for --dict
+            DictionaryTrainer trainer;
+            uint64_t sampleBytes = 0;
+            for (const std::string &sample : files)
+            {
+                FileUtils::MappedFile input(sample);
+                trainer.addSample(input.data(), input.size());
+                sampleBytes += input.size();
+            }
+            DictionaryPtr dictionary = trainer.build();
+            saveDictionary(*dictionary, trainPath);
+            std::cout << "Trained dictionary on " << files.size() << " file(s), " << sampleBytes << " bytes\n";
+            std::cout << "Dictionary ID: 0x" << std::hex << dictionary->id << std::dec << "\n";
+            std::cout << "Successfully wrote dictionary: " << trainPath << std::endl;
+            return 0;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (files.empty() || files.size() > 2)
+    {
+        FileUtils::printUsage();
+        return 1;
+    }
+    
+    try
+    {
+        DictionaryPtr dictionary;
+        if (!dictionaryPath.empty())
+            dictionary = loadDictionary(dictionaryPath);
+
+        std::string inputFilename = files[0];
+        std::string outputFilename;
+        
+        if (files.size() == 2)
+        {
+            outputFilename = files[1];
+        }
+        
+        // Map the input once; the header is parsed from the mapping and
+        // doubles as the compressed-file check. Block containers are
+        // recognised first; single-image files are the pre-index format.
+        FileUtils::MappedFile input(inputFilename);
+        Container container;
+        CompressedHeader header;
+        DictionaryImage dictionaryImage;
+        bool isDictionaryImage = FileUtils::parseDictionaryHeader(input.data(), input.size(), dictionaryImage) &&
+                                 isExactImage(dictionaryImage);
+        // --range wants a container, so only it reports a damaged one; when
+        // detecting, a "HUFB" file whose trailer doesn't check out is input
+        bool isContainer = !isDictionaryImage && (hasRange || looksLikeContainer(input.data(), input.size())) &&
+                           readContainer(input.data(), input.size(), container);
+
+        if (isDictionaryImage && !hasRange)
+        {
+            // DICTIONARY DECOMPRESSION: the table comes from --dict, not the file
+            std::cout << "Decompression mode detected.\n";
+            if (files.size() == 1)
+                outputFilename = generateDecompressedFilename(inputFilename);
+            DictionaryPtr used = requireDictionary(dictionaryImage.dictionaryId);
+            FileUtils::MappedOutput output(outputFilename, static_cast<std::size_t>(dictionaryImage.originalSize));
+            decompressWithDictionary(dictionaryImage, *used, output.data(), output.size());
+            output.commit();
+            std::cout << "Dictionary ID: 0x" << std::hex << used->id << std::dec << "\n";
+            std::cout << "Successfully decompressed to: " << outputFilename << std::endl;
+            std::cout << "Decompressed size: " << output.size() << " bytes" << std::endl;
+        }
+        else if (isDictionaryImage)
+        {
+            throw std::runtime_error("--range needs a block container, not a dictionary-coded message");
+        }
+        else if (dictionary)
+        {
+            // DICTIONARY COMPRESSION: one image, no tables, no index
+            std::cout << "Compression mode detected.\n";
+            if (hasRange)
+                throw std::runtime_error("--range needs a compressed input file");
+            if (files.size() == 1)
+                outputFilename = generateOutputFilename(inputFilename);
+
+            std::vector<char> image(maxDictionaryImageSize(*dictionary, input.size()));
+            std::size_t compressedSize = compressWithDictionary(input.data(), input.size(), *dictionary, image.data());
+            {
+                FileUtils::OutputFile output(outputFilename);
+                output.write(image.data(), compressedSize);
+            }
+            std::cout << "Dictionary ID: 0x" << std::hex << dictionary->id << std::dec << "\n";
+            std::cout << "Successfully wrote compressed file: " << outputFilename << std::endl;
+            std::cout << "\n--- COMPRESSION STATISTICS ---\n";
+            std::cout << "Original size: " << input.size() << " bytes\n";
+            std::cout << "Compressed size: " << compressedSize << " bytes (including header)\n";
+            if (input.size() > 0)
+                std::cout << "Compression ratio: " << std::fixed << std::setprecision(2)
+                          << static_cast<double>(compressedSize) / input.size() * 100.0 << "%\n";
+        }
+        else if (isContainer || (FileUtils::parseCompressedHeader(input.data(), input.size(), header) &&
+                                 isExactImage(header)))
+        {
+            // DECOMPRESSION MODE
+            std::cout << "Decompression mode detected.\n";
+
+            if (files.size() == 1)
+            {
+                outputFilename = generateDecompressedFilename(inputFilename);
+            }
+
+            Codec fileCodec = isContainer ? container.codec : header.codec;
+            std::cout << "Codec: "
+                      << (fileCodec == Codec::Order1        ? "order-1 context"
+                          : fileCodec == Codec::Interleaved ? "order-0, 4 interleaved streams"
+                                                            : "order-0")
+                      << "\n";
+
+            uint64_t originalSize = isContainer ? container.originalSize : decompressedSize(header);
+            if (!hasRange)
+            {
+                rangeStart = 0;
+                rangeLength = originalSize;
+            }
+            else if (rangeStart > originalSize || rangeLength > originalSize - rangeStart)
+            {
+                throw std::runtime_error("Range " + std::to_string(rangeStart) + ":" +
+                                         std::to_string(rangeLength) + " is outside the original size of " +
+                                         std::to_string(originalSize) + " bytes");
+            }
+
+            // Steps 6-7: Rebuild the tree(s) and decompress straight into the
+            // mapped output file, which is sized up front from the header
+            FileUtils::MappedOutput output(outputFilename, static_cast<std::size_t>(rangeLength));
+            if (isContainer)
+            {
+                // Only blocks overlapping the range are decoded and checked
+                decompressContainer(container, rangeStart, rangeLength, output.data());
+                std::cout << "Index: " << container.blocks.size() << " blocks (decoded blocks CRC-32C verified)\n";
+            }
+            else if (!hasRange)
+            {
+                decompress(header, output.data(), output.size());
+            }
+            else
+            {
+                // No index in the single-image format: decode it all, keep the slice
+                std::vector<char> whole(static_cast<std::size_t>(originalSize));
+                decompress(header, whole.data(), whole.size());
+                std::memcpy(output.data(), whole.data() + rangeStart, output.size());
+            }
+            // Only now does the output replace anything of that name
+            output.commit();
+
+            std::cout << "Successfully decompressed to: " << outputFilename << std::endl;
+            std::cout << "Decompressed size: " << output.size() << " bytes" << std::endl;
+        }
+        else
+        {
+            // COMPRESSION MODE
+            std::cout << "Compression mode detected.\n";
+
+            if (hasRange)
+                throw std::runtime_error("--range needs a compressed input file");
+
+            if (files.size() == 1)
+            {
+                outputFilename = generateOutputFilename(inputFilename);
+            }
+
+            if (input.size() == 0)
+            {
+                std::cout << "Input file is empty. Nothing to compress.\n";
+                return 0;
+            }
+
+            // Every block gets its own tables; show the first block's codes
+            // as a sample (order-1 has one table per context, too many to be
+            // useful on screen)
+            if (codec == Codec::Order1)
+            {
+                std::cout << "\nCodec: order-1 context (one Huffman table per preceding byte)\n";
+            }
+            else
+            {
+                EncodePlan sample;
+                planCompression(input.data(), std::min<std::size_t>(input.size(), DEFAULT_BLOCK_SIZE),
+                                codec, sample);
+                std::cout << "\n--- HUFFMAN CODES (first block) ---\n";
+                for (std::size_t sym = 0; sym < sample.codes.size(); ++sym)
+                {
+                    const Code &code = sample.codes[sym];
+                    if (code.length == 0)
+                        continue;
+                    if (std::isprint(static_cast<unsigned char>(sym)))
+                        std::cout << "'" << static_cast<char>(sym) << "' -> " << codeToString(code) << "\n";
+                    else
+                        std::cout << "0x" << std::hex << sym
+                                  << std::dec << " -> " << codeToString(code) << "\n";
+                }
+            }
+
+            // Blocks are coded one at a time and streamed to the output,
+            // followed by the seek index
+            uint64_t compressedSize = 0;
+            {
+                FileUtils::OutputFile output(outputFilename);
+                compressedSize = compressContainer(input.data(), input.size(), codec, DEFAULT_BLOCK_SIZE,
+                                                   [&output](const char *data, std::size_t size)
+                                                   { output.write(data, size); },
+                                                   level);
+            }
+            std::size_t numBlocks = (input.size() + DEFAULT_BLOCK_SIZE - 1) / DEFAULT_BLOCK_SIZE;
+
+            std::cout << "Successfully wrote compressed file: " << outputFilename << std::endl;
+            std::cout << "Blocks: " << numBlocks << " x " << DEFAULT_BLOCK_SIZE
+                      << " bytes, each with its own tables and CRC-32C (level " << level << ")" << std::endl;
+
+            // Display compression statistics
+            std::cout << "\n--- COMPRESSION STATISTICS ---\n";
+            std::cout << "Original size: " << input.size() << " bytes\n";
+            std::cout << "Compressed size: " << compressedSize << " bytes (including headers and index)\n";
+
+            double compressionRatio = static_cast<double>(compressedSize) / input.size() * 100.0;
+            std::cout << "Compression ratio: " << std::fixed << std::setprecision(2)
+                      << compressionRatio << "%\n";
+            std::cout << "Space saved: " << std::fixed << std::setprecision(2)
+                      << (100.0 - compressionRatio) << "%\n";
+        }
+        
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
+
+void printFrequency(const FrequencyTable &freq)
+{
+    std::cout << "\n--- CHARACTER FREQUENCY ANALYSIS ---\n";
+
+    for (int c = CHAR_MIN; c <= CHAR_MAX; ++c)
+    {
+        char ch = static_cast<char>(c);
+        uint32_t count = freq[static_cast<unsigned char>(ch)];
+        if (count == 0)
+            continue;
+
+        // Handle printable ASCII characters
+        if (std::isprint(static_cast<unsigned char>(ch)))
+        {
+            std::cout << "'" << ch << "': " << count << std::endl;
+        }
+        // Handle common whitespace characters
+        else if (ch == '\n')
+        {
+            std::cout << "'\\n' (newline): " << count << std::endl;
+        }
+        else if (ch == '\r')
+        {
+            std::cout << "'\\r' (carriage return): " << count << std::endl;
+        }
+        else if (ch == '\t')
+        {
+            std::cout << "'\\t' (tab): " << count << std::endl;
+        }
+        else if (ch == ' ')
+        {
+            std::cout << "' ' (space): " << count << std::endl;
+        }
+        // Handle non-printable characters (including UTF-8 bytes)
+        else
+        {
+            std::cout << "0x" << std::hex << std::setfill('0') << std::setw(2)
+                      << (static_cast<unsigned char>(ch) & 0xFF) << std::dec
+                      << " (non-printable/UTF-8 byte): " << count << std::endl;
+        }
+    }
+}
+
+std::string generateOutputFilename(const std::string &inputFilename)
+{
+    size_t lastDot = inputFilename.find_last_of('.');
+    if (lastDot != std::string::npos)
+    {
+        return inputFilename.substr(0, lastDot) + ".huf";
+    }
+    return inputFilename + ".huf";
+}
+
+std::string generateDecompressedFilename(const std::string &inputFilename)
+{
+    // Remove the .huf extension
+    size_t lastDot = inputFilename.find_last_of('.');
+    if (lastDot != std::string::npos && inputFilename.substr(lastDot) == ".huf")
+    {
+        return inputFilename.substr(0, lastDot) + "_decompressed.txt";
+    }
+    return inputFilename + "_decompressed.txt";
+}
+
+bool parseRange(const std::string &text, uint64_t &start, uint64_t &length)
+{
+    size_t colon = text.find(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == text.size())
+        return false;
+    if (text.find_first_not_of("0123456789:") != std::string::npos || text.find(':', colon + 1) != std::string::npos)
+        return false;
+    try
+    {
+        start = std::stoull(text.substr(0, colon));
+        length = std::stoull(text.substr(colon + 1));
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return true;
+}
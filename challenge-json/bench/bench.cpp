@@ -0,0 +1,535 @@
+// Parser benchmark: runs the same generated document through plain
+// validation, indexed validation with each stage-1 kernel the CPU
+// supports, two JSONPath queries, schema validation, the streaming
+// parser fed 64 KiB chunks, NDJSON validation on every core, the --trace
+// parser, DOM construction, typed binding into structs and back, and
+// --minify/--pretty output (against a plain memcpy), and reports
+// throughput. The numbers corpus is also written back out from its DOM.
+// Then each corpus in bench/corpus.h goes through lexing alone,
+// validation and DOM parsing, with the allocations each DOM parse makes,
+// so a regression in Lexer, Parser or Document shows up per workload. The
+// traced run writes to a discarding stream buffer, so its numbers show the
+// cost of formatting trace lines, not of a terminal or disk.
+//
+// How to build and run:
+//   make jp_bench
+//   ./jp_bench [size_mb] [iterations]
+//
+// Returns non-zero if any path rejects the document.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "binding.h"
+#include "corpus.h"
+#include "dom.h"
+#include "lexer.h"
+#include "ndjson.h"
+#include "parser.h"
+#include "query.h"
+#include "schema.h"
+#include "stream_parser.h"
+#include "structural.h"
+#include "writer.h"
+
+// Every operator new in the process, so each path's allocations per
+// document can be reported. Arena blocks come from malloc and are counted
+// from the arena itself.
+static std::atomic<std::size_t> allocationCount(0);
+
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+// The records document as structs, for the typed binding (manager is
+// always null, so it is left out and skipped)
+struct BenchAddress
+{
+    std::string city;
+    std::string zip;
+};
+JSON_BIND(BenchAddress, JSON_FIELD(city), JSON_FIELD(zip))
+
+struct BenchRecord
+{
+    uint64_t id;
+    std::string name;
+    bool active;
+    std::vector<int> scores;
+    BenchAddress address;
+};
+JSON_BIND(BenchRecord, JSON_FIELD(id), JSON_FIELD(name), JSON_FIELD(active), JSON_FIELD(scores), JSON_FIELD(address))
+
+struct BenchRecords
+{
+    std::vector<BenchRecord> records;
+};
+JSON_BIND(BenchRecords, JSON_FIELD(records))
+
+namespace
+{
+    // Counts what it is given and throws it away
+    class NullBuffer : public std::streambuf
+    {
+    public:
+        std::size_t bytes = 0;
+
+    protected:
+        int overflow(int c) override
+        {
+            ++bytes;
+            return traits_type::not_eof(c);
+        }
+        std::streamsize xsputn(const char *, std::streamsize n) override
+        {
+            bytes += static_cast<std::size_t>(n);
+            return n;
+        }
+    };
+
+    template <typename ParserType, typename LexerType>
+    double timeParse(const std::string &doc, int iterations, bool &ok)
+    {
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            LexerType lexer(doc);
+            ParserType parser(std::move(lexer));
+            ok = parser.parse() && ok;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    // Tokens only, no grammar: the lexer's share of validation
+    double timeLex(const std::string &doc, int iterations, bool &ok)
+    {
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            Lexer lexer(doc);
+            TokenType type;
+            do
+                type = lexer.next().type;
+            while (type != TokenType::EOF_TOKEN && type != TokenType::INVALID);
+            ok = type == TokenType::EOF_TOKEN && ok;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    // One line-aware validation pass, on one thread to compare with the
+    // single-document paths
+    double timeLines(const std::string &lines, int iterations, bool &ok)
+    {
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            ok = validateLines(lines.data(), lines.size(), 1).invalidLines.empty() && ok;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    // DOM parsing into one reused Document, as a server would; for NDJSON
+    // every line is a document. `allocations` is per document, counting
+    // operator new and arena blocks.
+    double timeCorpusDom(const std::string &doc, bool lines, int iterations, bool &ok, double &allocations)
+    {
+        std::vector<std::pair<std::size_t, std::size_t>> spans;
+        for (std::size_t begin = 0, end; lines && begin < doc.size(); begin = end + 1)
+        {
+            end = doc.find('\n', begin);
+            if (end == std::string::npos)
+                end = doc.size();
+            spans.push_back({begin, end - begin});
+        }
+        if (!lines)
+            spans.push_back({0, doc.size()});
+
+        Document document;
+        ok = document.parse(doc.data() + spans[0].first, spans[0].second); // warm the scratch stacks
+        std::size_t blocks = 0;
+        std::size_t before = allocationCount;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            for (const auto &span : spans)
+            {
+                ok = document.parse(doc.data() + span.first, span.second) && ok;
+                blocks += document.memory().blockCount();
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        allocations = static_cast<double>(allocationCount - before + blocks) / (iterations * spans.size());
+        return elapsed.count() / iterations;
+    }
+
+    // Stage 1 and stage 2 together, reusing one index like Document does
+    double timeIndexed(const std::string &doc, Stage1Kernel kernel, int iterations, bool &ok)
+    {
+        StructuralIndex index;
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            ok = index.build(doc.data(), doc.size(), kernel) && ok;
+            IndexedParser parser(IndexedLexer(doc.data(), doc.size(), index));
+            ok = parser.parse() && ok;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    double timeStream(const std::string &doc, int iterations, bool &ok)
+    {
+        const std::size_t CHUNK_SIZE = 64 << 10;
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            StreamParser<> parser;
+            bool fed = true;
+            for (std::size_t at = 0; fed && at < doc.size(); at += CHUNK_SIZE)
+                fed = parser.feed(doc.data() + at, std::min(CHUNK_SIZE, doc.size() - at));
+            ok = fed && parser.finish() && ok;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    double timeNdjson(const std::string &lines, int iterations, bool &ok, std::size_t &records)
+    {
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            NdjsonResult result = validateLines(lines.data(), lines.size());
+            ok = result.invalidLines.empty() && ok;
+            records = result.records;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    double timeQuery(const std::string &doc, const std::string &path, int iterations, bool &ok, std::size_t &found)
+    {
+        Query query(path);
+        std::vector<QueryMatch> matches;
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            matches.clear();
+            ok = query.evaluate(doc.data(), doc.size(), matches) && ok;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        found = matches.size();
+        return elapsed.count() / iterations;
+    }
+
+    // Parse into one long-lived Document, the way a server would reuse it
+    double timeDom(const std::string &doc, int iterations, bool &ok, std::size_t &arenaBytes, std::size_t &blocks)
+    {
+        Document document;
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            ok = document.parse(doc) && ok;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        arenaBytes = document.memory().bytesAllocated();
+        blocks = document.memory().blockCount();
+        return elapsed.count() / iterations;
+    }
+
+    // The records' shape, with every kind of check the schema subset has
+    const char *const RECORDS_SCHEMA =
+        "{\"type\":\"object\",\"required\":[\"records\"],\"properties\":{\"records\":{\"type\":\"array\","
+        "\"items\":{\"type\":\"object\",\"required\":[\"id\",\"name\",\"address\"],\"properties\":{"
+        "\"id\":{\"type\":\"integer\",\"minimum\":0},\"name\":{\"type\":\"string\",\"minLength\":1},"
+        "\"active\":{\"type\":\"boolean\"},\"manager\":{\"type\":\"null\"},"
+        "\"scores\":{\"type\":\"array\",\"maxItems\":2,\"items\":{\"type\":\"integer\",\"minimum\":0,"
+        "\"maximum\":99}},\"address\":{\"type\":\"object\",\"required\":[\"city\",\"zip\"],\"properties\":{"
+        "\"city\":{\"enum\":[\"Springfield\",\"Shelbyville\"]},"
+        "\"zip\":{\"type\":\"string\",\"minLength\":5,\"maxLength\":5}}}}}}}}";
+
+    double timeSchema(const std::string &doc, int iterations, bool &ok)
+    {
+        Schema schema(RECORDS_SCHEMA);
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            ok = schema.validate(doc.data(), doc.size()) == SchemaResult::Valid && ok;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    double timeBind(const std::string &doc, int iterations, bool &ok, BenchRecords &records)
+    {
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            ok = fromJson(doc.data(), doc.size(), records) && ok;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    double timeBindWrite(const BenchRecords &records, int iterations, std::size_t &outBytes)
+    {
+        OutputBuffer out;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            out.clear();
+            toJson(records, out);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        outBytes = out.size();
+        return elapsed.count() / iterations;
+    }
+
+    // Parse and re-emit into one reused buffer, as jp --minify/--pretty do
+    double timeRewrite(const std::string &doc, WriteStyle style, int iterations, bool &ok, std::size_t &outBytes)
+    {
+        OutputBuffer out(doc.size());
+        ok = true;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            out.clear();
+            JsonWriter writer(out, style);
+            ok = rewrite(doc.data(), doc.size(), writer) && ok;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        outBytes = out.size();
+        return elapsed.count() / iterations;
+    }
+
+    // Serialize a parsed tree: escaping and number formatting, no parsing
+    double timeWriteDom(const Document &document, int iterations, std::size_t &outBytes)
+    {
+        OutputBuffer out;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            out.clear();
+            JsonWriter writer(out);
+            writer.value(document.root());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        outBytes = out.size();
+        return elapsed.count() / iterations;
+    }
+
+    // The floor for the writers: copying the document once
+    double timeCopy(const std::string &doc, int iterations)
+    {
+        std::string copy(doc.size(), '\0');
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i)
+            std::memcpy(&copy[0], doc.data(), doc.size());
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return copy[0] == doc[0] ? elapsed.count() / iterations : 0.0;
+    }
+
+    double megabytesPerSecond(std::size_t bytes, double seconds)
+    {
+        return seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t sizeMb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 3;
+    if (sizeMb == 0 || iterations <= 0)
+    {
+        std::cout << "\nUsage: ./jp_bench [size_mb] [iterations]\n";
+        return 1;
+    }
+
+    std::string doc = generateRecords(sizeMb << 20);
+
+    bool plainOk;
+    double plain = timeParse<Parser, Lexer>(doc, iterations, plainOk);
+
+    // Each corpus at a quarter of the main document's size
+    struct CorpusResult
+    {
+        std::size_t bytes;
+        double lex, validate, dom, allocations;
+        bool ok;
+    };
+    std::vector<CorpusResult> corpusResults;
+    std::string numbersDoc;
+    for (std::size_t c = 0; c < corpusCount; ++c)
+    {
+        std::string corpus = corpora[c].generate(doc.size() / 4);
+        CorpusResult r;
+        bool lexOk, validateOk, domOk;
+        r.bytes = corpus.size();
+        r.lex = timeLex(corpus, iterations, lexOk);
+        r.validate = corpora[c].lines ? timeLines(corpus, iterations, validateOk)
+                                      : timeParse<Parser, Lexer>(corpus, iterations, validateOk);
+        r.dom = timeCorpusDom(corpus, corpora[c].lines, iterations, domOk, r.allocations);
+        r.ok = lexOk && validateOk && domOk;
+        corpusResults.push_back(r);
+        if (std::string(corpora[c].name) == "numbers")
+            numbersDoc = corpus;
+    }
+
+    const Stage1Kernel kernels[] = {Stage1Kernel::Scalar, Stage1Kernel::Sse2, Stage1Kernel::Avx2};
+    bool indexedOk = true;
+    double indexed[3] = {};
+    for (int k = 0; k < 3; ++k)
+    {
+        bool ok = true;
+        if (StructuralIndex::supported(kernels[k]))
+            indexed[k] = timeIndexed(doc, kernels[k], iterations, ok);
+        indexedOk = indexedOk && ok;
+    }
+
+    const char *const paths[] = {"$.records[*].address.zip", "$.records[5000].name"};
+    double queries[2];
+    std::size_t queryMatches[2];
+    bool queryOk = true;
+    for (int q = 0; q < 2; ++q)
+    {
+        bool ok;
+        queries[q] = timeQuery(doc, paths[q], iterations, ok, queryMatches[q]);
+        queryOk = queryOk && ok;
+    }
+
+    bool schemaOk;
+    double schema = timeSchema(doc, iterations, schemaOk);
+
+    bool streamOk;
+    double stream = timeStream(doc, iterations, streamOk);
+
+    std::string lines = generateNdjson(doc.size());
+    std::size_t records = 0;
+    bool ndjsonOk;
+    double ndjson = timeNdjson(lines, iterations, ndjsonOk, records);
+
+    NullBuffer sink;
+    std::streambuf *saved = std::cout.rdbuf(&sink);
+    bool tracedOk;
+    double traced = timeParse<TracingParser, TracingLexer>(doc, iterations, tracedOk);
+    std::cout.rdbuf(saved);
+
+    std::size_t arenaBytes;
+    std::size_t blocks;
+    bool domOk;
+    double dom = timeDom(doc, iterations, domOk, arenaBytes, blocks);
+
+    bool bindOk;
+    std::size_t bindBytes = 0;
+    double bind, bindWrite;
+    {
+        BenchRecords records;
+        bind = timeBind(doc, iterations, bindOk, records);
+        bindWrite = timeBindWrite(records, iterations, bindBytes);
+    }
+
+    const WriteStyle styles[] = {WriteStyle::Minify, WriteStyle::Pretty};
+    double rewrites[2];
+    std::size_t rewriteBytes[2];
+    bool rewriteOk = true;
+    for (int w = 0; w < 2; ++w)
+    {
+        bool ok;
+        rewrites[w] = timeRewrite(doc, styles[w], iterations, ok, rewriteBytes[w]);
+        rewriteOk = rewriteOk && ok;
+    }
+    double copy = timeCopy(doc, iterations);
+
+    bool writeDomOk;
+    std::size_t writeDomBytes = 0;
+    double writeDom = 0;
+    {
+        Document numbers;
+        writeDomOk = numbers.parse(numbersDoc);
+        if (writeDomOk)
+            writeDom = timeWriteDom(numbers, iterations, writeDomBytes);
+    }
+
+    std::cout << "Document: " << doc.size() << " bytes, " << iterations << " iteration(s)\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  validate:        " << std::setw(10) << megabytesPerSecond(doc.size(), plain) << " MB/s"
+              << (plainOk ? "" : "  (rejected)") << "\n";
+    for (int k = 0; k < 3; ++k)
+    {
+        if (!StructuralIndex::supported(kernels[k]))
+            continue;
+        std::string label = std::string("indexed/") + StructuralIndex::kernelName(kernels[k]) + ":";
+        std::cout << "  " << std::left << std::setw(17) << label << std::right << std::setw(10)
+                  << megabytesPerSecond(doc.size(), indexed[k]) << " MB/s"
+                  << (kernels[k] == StructuralIndex::bestKernel() ? "  (default)" : "") << "\n";
+    }
+    for (int q = 0; q < 2; ++q)
+        std::cout << "  query:           " << std::setw(10) << megabytesPerSecond(doc.size(), queries[q]) << " MB/s, "
+                  << queryMatches[q] << " match(es) for " << paths[q] << (queryOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  schema:          " << std::setw(10) << megabytesPerSecond(doc.size(), schema) << " MB/s"
+              << (schemaOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  stream:          " << std::setw(10) << megabytesPerSecond(doc.size(), stream) << " MB/s"
+              << (streamOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  ndjson:          " << std::setw(10) << megabytesPerSecond(lines.size(), ndjson) << " MB/s, "
+              << std::setprecision(0) << (ndjson > 0 ? records / ndjson : 0.0) << " records/s on "
+              << std::max(1u, std::thread::hardware_concurrency()) << " thread(s)" << std::setprecision(2)
+              << (ndjsonOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  --trace:         " << std::setw(10) << megabytesPerSecond(doc.size(), traced) << " MB/s, "
+              << sink.bytes / iterations << " trace bytes per parse"
+              << (tracedOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  DOM:             " << std::setw(10) << megabytesPerSecond(doc.size(), dom) << " MB/s, "
+              << arenaBytes << " arena bytes in " << blocks << " block(s)"
+              << (domOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  bind:            " << std::setw(10) << megabytesPerSecond(doc.size(), bind)
+              << " MB/s into structs" << (bindOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  bind write:      " << std::setw(10) << megabytesPerSecond(bindBytes, bindWrite)
+              << " MB/s from structs, " << bindBytes << " bytes out\n";
+    for (int w = 0; w < 2; ++w)
+        std::cout << "  " << (w == 0 ? "--minify:        " : "--pretty:        ") << std::setw(10)
+                  << megabytesPerSecond(doc.size(), rewrites[w]) << " MB/s, " << rewriteBytes[w] << " bytes out"
+                  << (rewriteOk ? "" : "  (rejected)") << "\n";
+    std::cout << "  memcpy:          " << std::setw(10) << megabytesPerSecond(doc.size(), copy) << " MB/s\n";
+    std::cout << "  write numbers:   " << std::setw(10) << megabytesPerSecond(writeDomBytes, writeDom)
+              << " MB/s from the DOM" << (writeDomOk ? "" : "  (rejected)") << "\n";
+
+    bool corporaOk = true;
+    std::cout << "Corpora (MB/s; allocations per document, NDJSON per line, in DOM parsing):\n";
+    std::cout << "  " << std::left << std::setw(10) << "corpus" << std::right << std::setw(10) << "bytes"
+              << std::setw(10) << "lex" << std::setw(10) << "validate" << std::setw(10) << "DOM" << std::setw(10)
+              << "allocs" << "\n";
+    for (std::size_t c = 0; c < corpusCount; ++c)
+    {
+        const CorpusResult &r = corpusResults[c];
+        std::cout << "  " << std::left << std::setw(10) << corpora[c].name << std::right << std::setw(10) << r.bytes
+                  << std::setw(10) << megabytesPerSecond(r.bytes, r.lex) << std::setw(10)
+                  << megabytesPerSecond(r.bytes, r.validate) << std::setw(10) << megabytesPerSecond(r.bytes, r.dom)
+                  << std::setw(10) << r.allocations << (r.ok ? "" : "  (rejected)") << "\n";
+        corporaOk = corporaOk && r.ok;
+    }
+    return corporaOk && plainOk && bindOk && queryOk && schemaOk && rewriteOk && writeDomOk && indexedOk && streamOk && ndjsonOk && tracedOk && domOk ? 0 : 1;
+}
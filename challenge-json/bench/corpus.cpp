@@ -0,0 +1,139 @@
+#include "corpus.h"
+#include <cstdio>
+
+namespace
+{
+    void appendRecord(std::string &doc, unsigned long i)
+    {
+        doc += "{\"id\":" + std::to_string(i) + ",\"name\":\"user" + std::to_string(i % 977) +
+               "\",\"active\":" + (i % 3 ? "true" : "false") + ",\"manager\":null," +
+               "\"scores\":[" + std::to_string(i % 100) + "," + std::to_string(i * 7 % 100) +
+               "],\"address\":{\"city\":\"Springfield\",\"zip\":\"" + std::to_string(10000 + i % 90000) + "\"}}";
+    }
+}
+
+std::string generateRecords(std::size_t size)
+{
+    std::string doc = "{\"records\":[";
+    for (unsigned long i = 0; doc.size() < size; ++i)
+    {
+        if (i > 0)
+            doc += ",";
+        appendRecord(doc, i);
+        doc += "\n";
+    }
+    doc += "]}";
+    return doc;
+}
+
+std::string generateTwitter(std::size_t size)
+{
+    static const char *const texts[] = {
+        "RT @jsonfan: Parsing 2 GB/s on one core? Show me the benchmark \\ud83d\\udc40 #json #simd",
+        "\xe4\xbb\x8a\xe6\x97\xa5\xe3\x81\xaf\xe3\x81\x84\xe3\x81\x84\xe5\xa4\xa9\xe6\xb0\x97\xe3\x81\xa7\xe3\x81\x99"
+        "\xe3\x81\xad\xef\xbc\x81 #\xe6\x9d\xb1\xe4\xba\xac",
+        "New post: \\\"Why your parser allocates\\\" https:\\/\\/example.com\\/blog\\/alloc \\u2014 feedback welcome",
+        "@alice @bob lunch at 12:30? \xf0\x9f\x8d\x9c",
+        "Release notes for v4.2.0:\\n- faster number parsing\\n- fewer allocations\\n- bug fixes",
+    };
+    static const char *const names[] = {"Alice Example", "\xe5\xb1\xb1\xe7\x94\xb0\xe5\xa4\xaa\xe9\x83\x8e",
+                                        "Bob \\\"Builder\\\"", "Zo\xc3\xab", "json_fan_99"};
+    static const char *const langs[] = {"en", "ja", "en", "fr", "en"};
+
+    std::string doc = "{\"statuses\":[";
+    char status[2048];
+    for (unsigned long i = 0; doc.size() < size; ++i)
+    {
+        unsigned long long id = 505874924095815681ULL + i * 7919;
+        unsigned long userId = 1186275104UL + (i % 5000) * 131;
+        int k = static_cast<int>(i % 5);
+        std::snprintf(status, sizeof(status),
+                      "%s{\"created_at\":\"Sun Aug 31 00:%02lu:%02lu +0000 2014\",\"id\":%llu,\"id_str\":\"%llu\","
+                      "\"text\":\"%s\",\"source\":\"<a href=\\\"http:\\/\\/twitter.com\\/download\\/iphone\\\" "
+                      "rel=\\\"nofollow\\\">Twitter for iPhone<\\/a>\",\"truncated\":false,"
+                      "\"in_reply_to_status_id\":%s,\"user\":{\"id\":%lu,\"id_str\":\"%lu\",\"name\":\"%s\","
+                      "\"screen_name\":\"user_%lu\",\"location\":\"\",\"description\":\"%s\",\"url\":null,"
+                      "\"protected\":false,\"followers_count\":%lu,\"friends_count\":%lu,\"listed_count\":%lu,"
+                      "\"created_at\":\"Fri Feb 01 07:04:04 +0000 2013\",\"utc_offset\":%s,\"verified\":%s,"
+                      "\"profile_background_color\":\"C0DEED\",\"default_profile\":true},\"geo\":null,"
+                      "\"coordinates\":%s,\"retweet_count\":%lu,\"favorite_count\":%lu,\"entities\":{\"hashtags\":"
+                      "[{\"text\":\"json\",\"indices\":[%lu,%lu]}],\"urls\":[],\"user_mentions\":[{\"screen_name\":"
+                      "\"jsonfan\",\"name\":\"JSON Fan\",\"id\":%lu,\"indices\":[3,11]}]},\"favorited\":false,"
+                      "\"retweeted\":%s,\"lang\":\"%s\"}",
+                      i > 0 ? "," : "", i / 60 % 60, i % 60, id, id, texts[k], i % 4 ? "null" : "505874847260352513",
+                      userId, userId, names[k], i % 5000, texts[(k + 2) % 5], i * 37 % 100000, i * 13 % 2000,
+                      i % 40, i % 2 ? "32400" : "null", i % 11 ? "false" : "true",
+                      i % 7 ? "null" : "{\"type\":\"Point\",\"coordinates\":[35.6895,139.6917]}", i % 1000, i % 57,
+                      i % 20, i % 20 + 5, 2278053589UL + i % 97, i % 3 ? "false" : "true", langs[k]);
+        doc += status;
+    }
+    doc += "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,"
+           "\"query\":\"%23json\",\"count\":100,\"since_id\":0}}";
+    return doc;
+}
+
+std::string generateNumbers(std::size_t size)
+{
+    std::string doc = "{\"samples\":[";
+    char sample[128];
+    for (unsigned long i = 0; doc.size() < size; ++i)
+    {
+        std::snprintf(sample, sizeof(sample), "%s[%lu,%.3f,%.6f,%.2e,%ld]\n", i > 0 ? "," : "",
+                      1700000000000UL + i * 250, (i % 4000) * 0.037 - 40.0, (i % 977) * 1.0e-4, (i % 131) * 1234.5,
+                      static_cast<long>(i % 200) - 100);
+        doc += sample;
+    }
+    doc += "]}";
+    return doc;
+}
+
+std::string generateNested(std::size_t size)
+{
+    std::string doc = "{\"nested\":[";
+    for (unsigned long i = 0; doc.size() < size; ++i)
+    {
+        if (i > 0)
+            doc += ",";
+        doc += std::string(500, '[') + "1" + std::string(500, ']');
+    }
+    doc += "]}";
+    return doc;
+}
+
+std::string generateStrings(std::size_t size)
+{
+    static const char *const messages[] = {
+        "GET /api/v2/users/profile completed in 12ms with status 200 OK",
+        "cache miss for key \\\"session:7f3a\\\", falling back to the primary store\\n",
+        "Benutzer m\xc3\xb6" "chte die Datei \xc3\xb6" "ffnen \xe2\x80\x94 Zugriff verweigert",
+        "retrying upstream call (attempt 3 of 5) after a connection reset by peer",
+        "caf\\u00e9 order #1042 ready \\ud83d\\ude00 \\t table 7",
+    };
+    std::string doc = "{\"messages\":[";
+    for (unsigned long i = 0; doc.size() < size; ++i)
+    {
+        if (i > 0)
+            doc += ",";
+        doc += "{\"level\":\"info\",\"text\":\"" + std::string(messages[i % 5]) + "\"}\n";
+    }
+    doc += "]}";
+    return doc;
+}
+
+std::string generateNdjson(std::size_t size)
+{
+    std::string lines;
+    for (unsigned long i = 0; lines.size() < size; ++i)
+    {
+        appendRecord(lines, i);
+        lines += "\n";
+    }
+    return lines;
+}
+
+const CorpusSpec corpora[] = {
+    {"twitter", "twitter.json", generateTwitter, false}, {"numbers", "numbers.json", generateNumbers, false},
+    {"nested", "nested.json", generateNested, false},    {"strings", "strings.json", generateStrings, false},
+    {"ndjson", "records.ndjson", generateNdjson, true},
+};
+const std::size_t corpusCount = sizeof(corpora) / sizeof(corpora[0]);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Generated benchmark workloads. Each generator is deterministic and
+// returns a valid document of at least `size` bytes, give or take one
+// record, whose top level is an object as Parser requires.
+
+// {"records":[{...}, ...]} with every value kind the parser accepts, one
+// record per line
+std::string generateRecords(std::size_t size);
+
+// A search-API response: statuses with nested user objects, entity
+// arrays, 64-bit ids, URLs with escaped slashes and non-ASCII text
+std::string generateTwitter(std::size_t size);
+
+// Telemetry: arrays of timestamps and signed decimal readings
+std::string generateNumbers(std::size_t size);
+
+// Many deep, narrow arrays: all punctuation, the parser's worst case
+std::string generateNested(std::size_t size);
+
+// Log messages: long strings, mostly plain ASCII, some escapes and some
+// non-ASCII text
+std::string generateStrings(std::size_t size);
+
+// The records of generateRecords as JSON Lines, one object per line
+std::string generateNdjson(std::size_t size);
+
+struct CorpusSpec
+{
+    const char *name;
+    const char *fileName; // what jp_corpus writes it as
+    std::string (*generate)(std::size_t size);
+    bool lines; // NDJSON: every line is its own document
+};
+
+// The canonical set, in the order benchmarks report it
+extern const CorpusSpec corpora[];
+extern const std::size_t corpusCount;
@@ -0,0 +1,40 @@
+// Corpus generator: writes the benchmark workloads (bench/corpus.h) to
+// files, so jp itself, or another parser, can be timed on the same inputs.
+//
+// How to build and run:
+//   make jp_corpus
+//   ./jp_corpus <directory> [size_mb]
+//
+// The directory must exist. Each file is about size_mb MiB (default 16).
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "corpus.h"
+
+int main(int argc, char **argv)
+{
+    std::size_t sizeMb = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    if (argc < 2 || argc > 3 || sizeMb == 0)
+    {
+        std::cout << "\nUsage: ./jp_corpus <directory> [size_mb]\n";
+        return 1;
+    }
+
+    for (std::size_t c = 0; c < corpusCount; ++c)
+    {
+        std::string path = std::string(argv[1]) + "/" + corpora[c].fileName;
+        std::string doc = corpora[c].generate(sizeMb << 20);
+        std::ofstream out(path, std::ios::binary);
+        out.write(doc.data(), static_cast<std::streamsize>(doc.size()));
+        if (!out)
+        {
+            std::cerr << "Error: could not write " << path << "\n";
+            return 1;
+        }
+        std::cout << path << ": " << doc.size() << " bytes\n";
+    }
+    return 0;
+}
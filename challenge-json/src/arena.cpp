@@ -0,0 +1,49 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+Arena::Arena(std::size_t firstBlockSize) : nextSize(firstBlockSize) {}
+
+Arena::~Arena()
+{
+    release();
+}
+
+void Arena::reset(std::size_t nextBlockSize)
+{
+    release();
+    nextSize = nextBlockSize;
+}
+
+void Arena::release()
+{
+    while (head)
+    {
+        Block *previous = head->previous;
+        std::free(head);
+        head = previous;
+    }
+    used = 0;
+    capacity = 0;
+    allocated = 0;
+    blocks = 0;
+}
+
+void *Arena::allocateSlow(std::size_t size, std::size_t align)
+{
+    // Blocks at least double, so a bad hint costs O(log n) blocks
+    std::size_t header = (sizeof(Block) + align - 1) & ~(align - 1);
+    std::size_t blockSize = std::max(nextSize, header + size);
+    Block *block = static_cast<Block *>(std::malloc(blockSize));
+    if (!block)
+        throw std::bad_alloc();
+    block->previous = head;
+    head = block;
+    capacity = blockSize;
+    used = header + size;
+    nextSize = blockSize * 2;
+    allocated += blockSize;
+    ++blocks;
+    return reinterpret_cast<char *>(block) + header;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+// Bump allocator: allocations are carved from large blocks and freed all
+// at once. Blocks form a chain through their headers, so a document whose
+// size hint is right costs one malloc and one free, however many values
+// it holds.
+class Arena
+{
+public:
+    explicit Arena(std::size_t firstBlockSize = 64 * 1024);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+    {
+        std::size_t at = (used + align - 1) & ~(align - 1);
+        if (!head || at + size > capacity)
+            return allocateSlow(size, align);
+        used = at + size;
+        return reinterpret_cast<char *>(head) + at;
+    }
+
+    template <typename T>
+    T *allocateArray(std::size_t count)
+    {
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Frees every block. The next allocation starts a block of at least
+    // `nextBlockSize` bytes, so a caller that knows its input size can
+    // get it all in one.
+    void reset(std::size_t nextBlockSize);
+
+    std::size_t bytesAllocated() const { return allocated; } // requested from the system
+    std::size_t blockCount() const { return blocks; }
+
+private:
+    struct Block
+    {
+        Block *previous;
+    };
+
+    void *allocateSlow(std::size_t size, std::size_t align);
+    void release();
+
+    Block *head = nullptr;
+    std::size_t used = 0;     // bytes of head in use, header included
+    std::size_t capacity = 0; // size of head
+    std::size_t nextSize;
+    std::size_t allocated = 0;
+    std::size_t blocks = 0;
+};
@@ -0,0 +1,117 @@
+#include "binding.h"
+#include <stdexcept>
+
+KeyTable::KeyTable(const char *const *names, const std::size_t *lengths, std::size_t count)
+    : names(names, names + count), lengths(lengths, lengths + count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+        for (std::size_t j = 0; j < i; ++j)
+            if (lengths[i] == lengths[j] && std::memcmp(names[i], names[j], lengths[i]) == 0)
+                throw std::logic_error("two bound fields share the key \"" + std::string(names[i], lengths[i]) + "\"");
+
+    // Start at about two slots per key, where a few seeds usually suffice,
+    // and double the table when none of them does
+    std::size_t size = 1;
+    while (size < 2 * count)
+        size *= 2;
+    for (;; size *= 2)
+    {
+        mask = static_cast<uint32_t>(size - 1);
+        for (uint32_t attempt = 0; attempt < 64; ++attempt)
+        {
+            seed = 2166136261u + attempt * 0x9e3779b9u;
+            slots.assign(size, -1);
+            std::size_t i = 0;
+            for (; i < count; ++i)
+            {
+                int &slot = slots[hash(seed, names[i], lengths[i]) & mask];
+                if (slot >= 0)
+                    break;
+                slot = static_cast<int>(i);
+            }
+            if (i == count)
+                return;
+        }
+    }
+}
+
+JsonReader::JsonReader(const char *data, std::size_t size, std::size_t maxDepth)
+    : lexer(data, size), input(data), current(lexer.next()), maxDepth(maxDepth), open(maxDepth)
+{
+}
+
+bool JsonReader::readString(std::string &value)
+{
+    if (current.type != TokenType::STRING)
+        return false;
+    value.resize(current.length);
+    value.resize(decodeStringInto(input, current, &value[0]));
+    advance();
+    return true;
+}
+
+bool JsonReader::readNumber(Number &value)
+{
+    if (current.type != TokenType::NUMBER)
+        return false;
+    value = convertNumber(input + current.pos, current.length);
+    advance();
+    return true;
+}
+
+// Iterative, with the open containers on a bit stack, so a deeply nested
+// value the binding doesn't want costs no recursion. Its levels count
+// against the same limit as the bound ones.
+bool JsonReader::skipValue()
+{
+    while (!open.empty()) // left over from a failed skip
+        open.pop();
+    for (;;)
+    {
+        // A value
+        switch (current.type)
+        {
+        case TokenType::LBRACE:
+        case TokenType::LBRACKET:
+        {
+            bool object = current.type == TokenType::LBRACE;
+            if (depth + open.depth() >= maxDepth || !open.push(object))
+                return false;
+            advance();
+            if (accept(object ? TokenType::RBRACE : TokenType::RBRACKET))
+            {
+                open.pop();
+                break;
+            }
+            if (object && !(accept(TokenType::STRING) && accept(TokenType::COLON)))
+                return false;
+            continue;
+        }
+        case TokenType::STRING:
+        case TokenType::NUMBER:
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+        case TokenType::NULL_TOKEN:
+            advance();
+            break;
+        default:
+            return false;
+        }
+
+        // What follows a value: a comma and the next one, or closing brackets
+        for (;;)
+        {
+            if (open.empty())
+                return true;
+            if (accept(TokenType::COMMA))
+            {
+                if (open.topIsObject() && !(accept(TokenType::STRING) && accept(TokenType::COLON)))
+                    return false;
+                break;
+            }
+            if (!accept(open.topIsObject() ? TokenType::RBRACE : TokenType::RBRACKET))
+                return false;
+            open.pop();
+        }
+    }
+}
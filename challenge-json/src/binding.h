@@ -0,0 +1,382 @@
+#pragma once
+
+#include "depth_stack.h"
+#include "lexer.h"
+#include "number.h"
+#include "writer.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Typed binding: reads JSON straight into C++ structs, and writes them
+// back, without a DOM. A struct is bound once, at namespace scope, by
+// listing the members that map to JSON keys of the same name:
+//
+//   struct Address { std::string city; std::string zip; };
+//   JSON_BIND(Address, JSON_FIELD(city), JSON_FIELD(zip))
+//
+//   Address a;
+//   bool ok = fromJson(text.data(), text.size(), a);
+//   toJson(a, out); // out is an OutputBuffer
+//
+// Member types may be bool, any integer type, float, double, std::string,
+// std::vector of a supported type (but not std::vector<bool>), or another
+// bound struct. Everything about a binding is resolved at compile time
+// except its key table: each member gets its own read and write function,
+// instantiated for its type, and a key selects its member's reader from a
+// table with no collisions.
+// Keys the struct doesn't list are skipped (and still checked); members
+// the document lacks keep the value they had.
+
+// The key table a bound struct's reader looks keys up in: a perfect hash,
+// one slot per key at most, found once per struct on first use
+class KeyTable
+{
+public:
+    // names[i] is the key of field i. Throws std::logic_error if two
+    // fields share a key.
+    KeyTable(const char *const *names, const std::size_t *lengths, std::size_t count);
+
+    // The field whose key is [key, key + length), or -1 if there is none
+    int find(const char *key, std::size_t length) const
+    {
+        int field = slots[hash(seed, key, length) & mask];
+        if (field < 0 || lengths[field] != length || std::memcmp(names[field], key, length) != 0)
+            return -1;
+        return field;
+    }
+
+private:
+    // FNV-1a; keys are short, and the seed is what the search varies
+    static uint32_t hash(uint32_t seed, const char *key, std::size_t length)
+    {
+        uint32_t h = seed;
+        for (std::size_t i = 0; i < length; ++i)
+            h = (h ^ static_cast<unsigned char>(key[i])) * 16777619u;
+        return h;
+    }
+
+    std::vector<const char *> names;
+    std::vector<std::size_t> lengths;
+    std::vector<int> slots; // field index per slot, -1 if empty
+    uint32_t seed = 0;
+    uint32_t mask = 0;
+};
+
+// The token stream a binding reads from: a Lexer one token ahead, plus the
+// nesting depth of the values being bound
+class JsonReader
+{
+public:
+    JsonReader(const char *data, std::size_t size, std::size_t maxDepth = DEFAULT_MAX_DEPTH);
+
+    const Token &peek() const { return current; }
+    void advance() { current = lexer.next(); }
+    // Consumes the next token if it has type t
+    bool accept(TokenType t)
+    {
+        if (current.type != t)
+            return false;
+        advance();
+        return true;
+    }
+
+    const char *data() const { return input; }
+
+    // Bound containers call enter() before their contents and leave()
+    // after, so self-referencing types can't recurse without limit
+    bool enter() { return ++depth <= maxDepth; }
+    void leave() { --depth; }
+
+    // Consumes one value of any kind, checking its syntax
+    bool skipValue();
+    // Consume the next value if it has the right kind
+    bool readString(std::string &value);
+    bool readNumber(Number &value);
+
+private:
+    Lexer lexer;
+    const char *input;
+    Token current;
+    std::size_t depth = 0;
+    std::size_t maxDepth;
+    DepthStack open; // skipValue's, sized once so skipping never allocates
+};
+
+// The members of a bound struct, specialized by JSON_BIND
+template <typename T>
+struct JsonBinding;
+
+// One bound member: its key as written, quotes included, and its pointer
+template <typename T, typename M>
+struct JsonField
+{
+    typedef M Type;
+    const char *quotedKey;
+    std::size_t quotedLength;
+    M T::*member;
+};
+
+template <typename T, typename M, std::size_t N>
+JsonField<T, M> jsonField(const char (&quotedKey)[N], M T::*member)
+{
+    return JsonField<T, M>{quotedKey, N - 1, member};
+}
+
+#define JSON_FIELD(name) jsonField("\"" #name "\"", &BoundType::name)
+
+#define JSON_BIND(Type, ...)                                                                                           \
+    template <>                                                                                                        \
+    struct JsonBinding<Type>                                                                                           \
+    {                                                                                                                  \
+        typedef Type BoundType;                                                                                        \
+        static auto fields() -> decltype(std::make_tuple(__VA_ARGS__)) { return std::make_tuple(__VA_ARGS__); }        \
+    };
+
+// How values of type T are read and written. The primary template handles
+// bound structs; the specializations below handle everything else.
+template <typename T, typename Enable = void>
+struct JsonCodec;
+
+template <>
+struct JsonCodec<bool>
+{
+    static bool read(JsonReader &reader, bool &value)
+    {
+        value = reader.peek().type == TokenType::TRUE;
+        return reader.accept(TokenType::TRUE) || reader.accept(TokenType::FALSE);
+    }
+    static void write(JsonWriter &writer, bool value) { writer.boolean(value); }
+};
+
+// Integers must be written without a fraction or exponent and fit T
+template <typename T>
+struct JsonCodec<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+{
+    static bool read(JsonReader &reader, T &value)
+    {
+        Number number;
+        if (!reader.readNumber(number))
+            return false;
+        if (number.kind == NumberKind::Int64)
+        {
+            if (std::is_signed<T>::value ? number.integer < static_cast<int64_t>(std::numeric_limits<T>::min())
+                                         : number.integer < 0)
+                return false;
+            if (number.integer > 0 &&
+                static_cast<uint64_t>(number.integer) > static_cast<uint64_t>(std::numeric_limits<T>::max()))
+                return false;
+            value = static_cast<T>(number.integer);
+            return true;
+        }
+        if (number.kind == NumberKind::Uint64 &&
+            number.unsignedInteger <= static_cast<uint64_t>(std::numeric_limits<T>::max()))
+        {
+            value = static_cast<T>(number.unsignedInteger);
+            return true;
+        }
+        return false;
+    }
+    static void write(JsonWriter &writer, T value)
+    {
+        if (std::is_signed<T>::value)
+            writer.integer(static_cast<int64_t>(value));
+        else
+            writer.unsignedInteger(static_cast<uint64_t>(value));
+    }
+};
+
+template <typename T>
+struct JsonCodec<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static bool read(JsonReader &reader, T &value)
+    {
+        Number number;
+        if (!reader.readNumber(number))
+            return false;
+        value = static_cast<T>(number.toDouble());
+        return true;
+    }
+    static void write(JsonWriter &writer, T value) { writer.number(static_cast<double>(value)); }
+};
+
+template <>
+struct JsonCodec<std::string>
+{
+    static bool read(JsonReader &reader, std::string &value) { return reader.readString(value); }
+    static void write(JsonWriter &writer, const std::string &value) { writer.string(value.data(), value.size()); }
+};
+
+template <typename T>
+struct JsonCodec<std::vector<T>>
+{
+    static bool read(JsonReader &reader, std::vector<T> &value)
+    {
+        value.clear();
+        if (!reader.accept(TokenType::LBRACKET) || !reader.enter())
+            return false;
+        if (!reader.accept(TokenType::RBRACKET))
+        {
+            do
+            {
+                value.emplace_back();
+                if (!JsonCodec<T>::read(reader, value.back()))
+                    return false;
+            } while (reader.accept(TokenType::COMMA));
+            if (!reader.accept(TokenType::RBRACKET))
+                return false;
+        }
+        reader.leave();
+        return true;
+    }
+    static void write(JsonWriter &writer, const std::vector<T> &value)
+    {
+        writer.startArray();
+        for (const T &element : value)
+            JsonCodec<T>::write(writer, element);
+        writer.endArray();
+    }
+};
+
+template <std::size_t... I>
+struct IndexList
+{
+};
+
+template <std::size_t N, std::size_t... I>
+struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...>
+{
+};
+
+template <std::size_t... I>
+struct MakeIndexList<0, I...>
+{
+    typedef IndexList<I...> type;
+};
+
+// Bound structs. fields() is a tuple of constants, so after inlining each
+// member's reader and writer refer to the member directly.
+template <typename T, typename Enable>
+struct JsonCodec
+{
+    typedef decltype(JsonBinding<T>::fields()) Fields;
+    static const std::size_t fieldCount = std::tuple_size<Fields>::value;
+    typedef typename MakeIndexList<fieldCount>::type Indices;
+    typedef bool (*FieldReader)(JsonReader &, T &);
+
+    template <std::size_t I>
+    using FieldType = typename std::tuple_element<I, Fields>::type::Type;
+
+    template <std::size_t I>
+    static bool readField(JsonReader &reader, T &value)
+    {
+        return JsonCodec<FieldType<I>>::read(reader, value.*std::get<I>(JsonBinding<T>::fields()).member);
+    }
+
+    template <std::size_t I>
+    static void writeField(JsonWriter &writer, const T &value)
+    {
+        const JsonField<T, FieldType<I>> field = std::get<I>(JsonBinding<T>::fields());
+        writer.rawKey(field.quotedKey, field.quotedLength);
+        JsonCodec<FieldType<I>>::write(writer, value.*field.member);
+    }
+
+    template <std::size_t... I>
+    static const KeyTable &keys(IndexList<I...>)
+    {
+        static const Fields fields = JsonBinding<T>::fields();
+        static const char *const names[] = {std::get<I>(fields).quotedKey + 1 ...};
+        static const std::size_t lengths[] = {std::get<I>(fields).quotedLength - 2 ...};
+        static const KeyTable table(names, lengths, fieldCount);
+        return table;
+    }
+
+    template <std::size_t... I>
+    static const FieldReader *readers(IndexList<I...>)
+    {
+        static const FieldReader table[] = {&readField<I>...};
+        return table;
+    }
+
+    static bool read(JsonReader &reader, T &value)
+    {
+        static const KeyTable &table = keys(Indices());
+        static const FieldReader *fieldReaders = readers(Indices());
+
+        if (!reader.accept(TokenType::LBRACE) || !reader.enter())
+            return false;
+        if (!reader.accept(TokenType::RBRACE))
+        {
+            std::string escapedKey;
+            do
+            {
+                Token key = reader.peek();
+                if (key.type != TokenType::STRING)
+                    return false;
+                reader.advance();
+                if (!reader.accept(TokenType::COLON))
+                    return false;
+
+                // Keys are compared as written; only escaped ones are decoded
+                const char *body = reader.data() + key.pos + 1;
+                std::size_t length = key.length - 2;
+                if (std::memchr(body, '\\', length))
+                {
+                    escapedKey.resize(key.length);
+                    escapedKey.resize(decodeStringInto(reader.data(), key, &escapedKey[0]));
+                    body = escapedKey.data();
+                    length = escapedKey.size();
+                }
+                int field = table.find(body, length);
+                if (!(field < 0 ? reader.skipValue() : fieldReaders[field](reader, value)))
+                    return false;
+            } while (reader.accept(TokenType::COMMA));
+            if (!reader.accept(TokenType::RBRACE))
+                return false;
+        }
+        reader.leave();
+        return true;
+    }
+
+    template <std::size_t... I>
+    static void writeFields(JsonWriter &writer, const T &value, IndexList<I...>)
+    {
+        int expand[] = {0, (writeField<I>(writer, value), 0)...};
+        (void)expand;
+    }
+
+    static void write(JsonWriter &writer, const T &value)
+    {
+        writer.startObject();
+        writeFields(writer, value, Indices());
+        writer.endObject();
+    }
+};
+
+// Reads the document data[0, size) into value. Returns false if the
+// document is invalid or doesn't fit T (a wrong type, an integer out of
+// range); value may then be partly assigned.
+template <typename T>
+bool fromJson(const char *data, std::size_t size, T &value, std::size_t maxDepth = DEFAULT_MAX_DEPTH)
+{
+    JsonReader reader(data, size, maxDepth);
+    return JsonCodec<T>::read(reader, value) && reader.peek().type == TokenType::EOF_TOKEN;
+}
+
+template <typename T>
+void toJson(const T &value, JsonWriter &writer)
+{
+    JsonCodec<T>::write(writer, value);
+}
+
+template <typename T>
+void toJson(const T &value, OutputBuffer &out, WriteStyle style = WriteStyle::Minify)
+{
+    JsonWriter writer(out, style);
+    JsonCodec<T>::write(writer, value);
+}
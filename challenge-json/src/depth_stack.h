@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Deepest nesting the parsers accept unless told otherwise. Past it a
+// document is rejected like any other invalid input.
+const std::size_t DEFAULT_MAX_DEPTH = 1024;
+
+// The parsers' stack of open containers, one bit per level (set for an
+// object, clear for an array), sized for the maximum depth up front so a
+// parse never allocates for it. Limits up to 256 levels fit in the object
+// itself.
+class DepthStack
+{
+public:
+    explicit DepthStack(std::size_t maxDepth)
+        : limit(maxDepth), heapBits(maxDepth > 64 * INLINE_WORDS ? new uint64_t[(maxDepth + 63) / 64] : nullptr)
+    {
+    }
+
+    // False, leaving the stack as it was, when already at the limit
+    bool push(bool object)
+    {
+        if (size == limit)
+            return false;
+        uint64_t &word = words()[size / 64];
+        uint64_t bit = uint64_t(1) << (size % 64);
+        word = object ? word | bit : word & ~bit;
+        ++size;
+        return true;
+    }
+
+    void pop() { --size; }
+    bool topIsObject() const { return (words()[(size - 1) / 64] >> ((size - 1) % 64)) & 1; }
+    bool empty() const { return size == 0; }
+    std::size_t depth() const { return size; }
+    std::size_t maxDepth() const { return limit; }
+
+private:
+    static const std::size_t INLINE_WORDS = 4;
+
+    std::size_t limit;
+    std::size_t size = 0;
+    uint64_t inlineBits[INLINE_WORDS];
+    std::unique_ptr<uint64_t[]> heapBits;
+
+    // Looked up on each access rather than stored, so moving is safe
+    uint64_t *words() { return heapBits ? heapBits.get() : inlineBits; }
+    const uint64_t *words() const { return heapBits ? heapBits.get() : inlineBits; }
+};
@@ -0,0 +1,150 @@
+#include "dom.h"
+#include "lexer.h"
+#include "parser_impl.h"
+#include <algorithm>
+
+// Parser handler that builds a Document. Children collect on the
+// document's scratch stacks while their container is open and are copied
+// into the arena, in one exact-size array, when it closes.
+class DomBuilder
+{
+public:
+    DomBuilder(Document &document, const char *input) : doc(&document), input(input) {}
+
+    bool startObject()
+    {
+        doc->frames.push_back({true, doc->members.size()});
+        return true;
+    }
+
+    bool key(const Token &token)
+    {
+        Member member;
+        member.key = copyString(token, member.keyLength);
+        doc->members.push_back(member);
+        return true;
+    }
+
+    bool endObject()
+    {
+        std::size_t start = doc->frames.back().start;
+        doc->frames.pop_back();
+        Value object;
+        object.type = ValueType::Object;
+        object.length = static_cast<uint32_t>(doc->members.size() - start);
+        Member *members = doc->arena.allocateArray<Member>(object.length);
+        std::copy(doc->members.begin() + start, doc->members.end(), members);
+        object.members = members;
+        doc->members.resize(start);
+        return attach(object);
+    }
+
+    bool startArray()
+    {
+        doc->frames.push_back({false, doc->values.size()});
+        return true;
+    }
+
+    bool endArray()
+    {
+        std::size_t start = doc->frames.back().start;
+        doc->frames.pop_back();
+        Value array;
+        array.type = ValueType::Array;
+        array.length = static_cast<uint32_t>(doc->values.size() - start);
+        Value *elements = doc->arena.allocateArray<Value>(array.length);
+        std::copy(doc->values.begin() + start, doc->values.end(), elements);
+        array.elements = elements;
+        doc->values.resize(start);
+        return attach(array);
+    }
+
+    bool value(const Token &token)
+    {
+        Value scalar;
+        switch (token.type)
+        {
+        case TokenType::STRING:
+            scalar.type = ValueType::String;
+            scalar.string = copyString(token, scalar.length);
+            break;
+        case TokenType::NUMBER:
+        {
+            Number number = convertNumber(input + token.pos, token.length);
+            scalar.type = ValueType::Number;
+            scalar.numberKind = number.kind;
+            scalar.unsignedInteger = number.unsignedInteger;
+            break;
+        }
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+            scalar.type = ValueType::Bool;
+            scalar.boolean = token.type == TokenType::TRUE;
+            break;
+        default:
+            break;
+        }
+        return attach(scalar);
+    }
+
+private:
+    // A finished value goes to its parent: the pending member of an open
+    // object, the element list of an open array, or the root
+    bool attach(const Value &value)
+    {
+        if (doc->frames.empty())
+            doc->rootValue = value;
+        else if (doc->frames.back().object)
+            doc->members.back().value = value;
+        else
+            doc->values.push_back(value);
+        return true;
+    }
+
+    const char *copyString(const Token &token, uint32_t &length)
+    {
+        char *dest = doc->arena.allocateArray<char>(token.length);
+        length = static_cast<uint32_t>(decodeStringInto(input, token, dest));
+        return dest;
+    }
+
+    Document *doc;
+    const char *input;
+};
+
+template class BasicParser<Lexer, DomBuilder>;
+template class BasicParser<IndexedLexer, DomBuilder>;
+
+const Value *Value::find(const char *key, std::size_t keyLength) const
+{
+    for (const Member *m = members; m != members + length; ++m)
+    {
+        if (m->keyLength == keyLength && std::memcmp(m->key, key, keyLength) == 0)
+            return &m->value;
+    }
+    return nullptr;
+}
+
+bool Document::parse(const char *data, std::size_t size)
+{
+    // Twice the input holds most documents (decoded strings never exceed
+    // their source; a value node is 16 bytes), so one block is usual
+    arena.reset(2 * size + 4096);
+    rootValue = Value();
+    values.clear();
+    members.clear();
+    frames.clear();
+
+    bool ok;
+    if (index.build(data, size))
+        ok = BasicParser<IndexedLexer, DomBuilder>(IndexedLexer(data, size, index), DomBuilder(*this, data), maxDepth)
+                 .parse();
+    else
+        ok = BasicParser<Lexer, DomBuilder>(Lexer(data, size), DomBuilder(*this, data), maxDepth).parse();
+    if (!ok)
+    {
+        rootValue = Value();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "arena.h"
+#include "depth_stack.h"
+#include "number.h"
+#include "structural.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum class ValueType : uint8_t
+{
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object
+};
+
+struct Member;
+
+// One parsed JSON value: a tag, a count and one payload word, 16 bytes in
+// all. Strings, array elements and object members live in the arena of the
+// Document that built them and are valid as long as it is.
+struct Value
+{
+    ValueType type = ValueType::Null;
+    NumberKind numberKind = NumberKind::Double; // which of the number fields is set
+    uint32_t length = 0; // String: bytes, Array: elements, Object: members
+    union
+    {
+        bool boolean;
+        int64_t integer;
+        uint64_t unsignedInteger;
+        double number;
+        const char *string; // decoded, not NUL-terminated
+        const Value *elements;
+        const Member *members;
+    };
+
+    Value() : number(0) {}
+
+    bool isNull() const { return type == ValueType::Null; }
+    bool isBool() const { return type == ValueType::Bool; }
+    bool isNumber() const { return type == ValueType::Number; }
+    bool isString() const { return type == ValueType::String; }
+    bool isArray() const { return type == ValueType::Array; }
+    bool isObject() const { return type == ValueType::Object; }
+
+    bool asBool() const { return boolean; }
+    // Any number as a double; integers that need more than 53 bits round
+    double asNumber() const { return toNumber().toDouble(); }
+    // Integers exactly, when the document's number was one that fits
+    bool isInt64() const { return isNumber() && numberKind == NumberKind::Int64; }
+    bool isUint64() const
+    {
+        return isNumber() && (numberKind == NumberKind::Uint64 || (numberKind == NumberKind::Int64 && integer >= 0));
+    }
+    int64_t asInt64() const { return integer; }
+    uint64_t asUint64() const { return unsignedInteger; }
+    Number toNumber() const
+    {
+        Number n;
+        n.kind = numberKind;
+        n.unsignedInteger = unsignedInteger;
+        return n;
+    }
+    std::string str() const { return std::string(string, length); }
+    std::size_t size() const { return length; }
+
+    // Arrays
+    const Value &operator[](std::size_t index) const { return elements[index]; }
+    const Value *begin() const { return elements; }
+    const Value *end() const { return elements + length; }
+
+    // Objects, in document order. find() is a linear scan and returns the
+    // first member with that key, or nullptr.
+    const Member &member(std::size_t index) const;
+    const Value *find(const char *key, std::size_t keyLength) const;
+    const Value *find(const char *key) const { return find(key, std::strlen(key)); }
+};
+
+struct Member
+{
+    const char *key; // decoded, not NUL-terminated
+    uint32_t keyLength;
+    Value value;
+
+    std::string name() const { return std::string(key, keyLength); }
+};
+
+inline const Member &Value::member(std::size_t index) const
+{
+    return members[index];
+}
+
+// Owns a parsed value tree. Parsing copies what the tree needs into the
+// arena, so the input can go away afterwards. Re-parsing frees the old
+// tree in one go; the builder's scratch stacks and the structural index
+// keep their capacity.
+class Document
+{
+public:
+    // Documents nested deeper than maxDepth fail to parse
+    explicit Document(std::size_t maxDepth = DEFAULT_MAX_DEPTH) : maxDepth(maxDepth) {}
+
+    // Same grammar as Parser::parse. On failure root() is null.
+    bool parse(const char *data, std::size_t size);
+    bool parse(const std::string &input) { return parse(input.data(), input.size()); }
+
+    const Value &root() const { return rootValue; }
+    const Arena &memory() const { return arena; }
+
+private:
+    friend class DomBuilder;
+
+    struct Frame
+    {
+        bool object;
+        std::size_t start; // first child in values or members
+    };
+
+    std::size_t maxDepth;
+    Arena arena;
+    StructuralIndex index;
+    Value rootValue;
+    std::vector<Value> values;   // elements of the open arrays
+    std::vector<Member> members; // members of the open objects
+    std::vector<Frame> frames;
+};
@@ -1,10 +1,104 @@
 #include "file_utils.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace FileUtils
 {
+    InputFile::InputFile(const std::string &filename)
+    {
+        if (filename == "-")
+        {
+            readAll(STDIN_FILENO, "standard input");
+            return;
+        }
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Could not open file: " + filename);
+        struct stat info;
+        bool isFile = ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+        // Files that report size 0 may still have content (/proc), so
+        // only nonempty regular files are mapped
+        try
+        {
+            if (!isFile || info.st_size == 0 || !map(fd, static_cast<std::size_t>(info.st_size)))
+                readAll(fd, filename);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    InputFile::~InputFile()
+    {
+        if (mapping)
+            ::munmap(mapping, mappingSize);
+    }
+
+    bool InputFile::map(int fd, std::size_t fileSize)
+    {
+        // Reserve the file plus the padding as zero pages, then map the
+        // file over the front. The kernel zero-fills the file's last page
+        // past its end, and the pages after it stay anonymous, so reading
+        // the padding can't fault even when the file fills its last page.
+        std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        std::size_t total = (fileSize + INPUT_PADDING + page - 1) / page * page;
+        void *reserved = ::mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED)
+            return false;
+        void *file = ::mmap(reserved, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (file == MAP_FAILED)
+        {
+            ::munmap(reserved, total);
+            return false;
+        }
+        // Parsers read front to back: ask for aggressive readahead
+        ::madvise(file, fileSize, MADV_SEQUENTIAL);
+        mapping = reserved;
+        mappingSize = total;
+        bytes = static_cast<const char *>(file);
+        length = fileSize;
+        return true;
+    }
+
+    void InputFile::readAll(int fd, const std::string &filename)
+    {
+        std::size_t capacity = 1 << 20;
+        buffer.reset(new char[capacity + INPUT_PADDING]);
+        for (;;)
+        {
+            if (length == capacity)
+            {
+                std::unique_ptr<char[]> bigger(new char[2 * capacity + INPUT_PADDING]);
+                std::memcpy(bigger.get(), buffer.get(), length);
+                buffer = std::move(bigger);
+                capacity *= 2;
+            }
+            ssize_t got = ::read(fd, buffer.get() + length, capacity - length);
+            if (got == 0)
+                break;
+            if (got < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error("Failed to read: " + filename);
+            }
+            length += static_cast<std::size_t>(got);
+        }
+        std::memset(buffer.get() + length, 0, INPUT_PADDING);
+        bytes = buffer.get();
+    }
+
     std::string readFileForParsing(const std::string &filename)
     {
         std::ifstream rfile(filename, std::ios::binary);
@@ -31,6 +125,17 @@ namespace FileUtils
 
     void printUsage()
     {
-        std::cout << "\nUsage: ./jp <file_name>\nExample: ./jp test.json\n";
+        std::cout << "\nUsage: ./jp [--trace | --stream | --ndjson [--threads N] | -q <path> | --minify | --pretty | --schema <file>] [--max-depth N] <file_name>\n"
+                  << "Example: ./jp test.json\n"
+                  << "A file name of - reads standard input.\n";
+        std::cout << "  --trace   print every token the lexer produces\n";
+        std::cout << "  --stream  read the file in chunks instead of loading it whole\n";
+        std::cout << "  --ndjson  validate each line as a document, in parallel; invalid\n"
+                  << "            lines are listed in order (--threads: workers, default one per core)\n";
+        std::cout << "  -q        print the values a JSONPath selects, e.g. '$.items[*].id'\n";
+        std::cout << "  --minify  print the document without whitespace\n";
+        std::cout << "  --pretty  print the document indented, one member or element per line\n";
+        std::cout << "  --schema  check the document against a JSON Schema subset in the same pass\n";
+        std::cout << "  --max-depth reject documents nested deeper than this (default 1024)\n";
     }
 }
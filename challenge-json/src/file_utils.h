@@ -1,9 +1,44 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string>
 
 namespace FileUtils
 {
+    // Zero bytes readable past the end of every InputFile, so loops that
+    // work a block at a time may load a whole block at the end
+    const std::size_t INPUT_PADDING = 64;
+
+    // A whole input, read-only, followed by INPUT_PADDING zero bytes.
+    // Regular files are memory-mapped: nothing is copied up front, parsing
+    // starts as soon as the first page is in, and concurrent readers share
+    // the page cache. Pipes, special files and "-" (stdin) are read in
+    // chunks into a heap buffer instead. Throws std::runtime_error if the
+    // input can't be opened or read.
+    class InputFile
+    {
+    public:
+        explicit InputFile(const std::string &filename);
+        ~InputFile();
+        InputFile(const InputFile &) = delete;
+        InputFile &operator=(const InputFile &) = delete;
+
+        const char *data() const { return bytes; }
+        std::size_t size() const { return length; }
+        bool mapped() const { return mapping != nullptr; }
+
+    private:
+        bool map(int fd, std::size_t fileSize);
+        void readAll(int fd, const std::string &filename);
+
+        const char *bytes = nullptr;
+        std::size_t length = 0;
+        void *mapping = nullptr;
+        std::size_t mappingSize = 0;
+        std::unique_ptr<char[]> buffer; // when not mapped
+    };
+
     std::string readFileForParsing(const std::string &filename);
     void printUsage();
 }
@@ -0,0 +1,248 @@
+#include "json_string.h"
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // The first byte at or after p that plain copying must stop at: a
+    // quote, a backslash, a control byte or a non-ASCII byte
+    const char *findSpecial(const char *p, const char *end)
+    {
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        // Signed compare: below 0x20, and 0x80 and up, are all "less"
+        const __m128i space = _mm_set1_epi8(0x20);
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                           _mm_cmplt_epi8(v, space));
+            int mask = _mm_movemask_epi8(special);
+            if (mask != 0)
+                return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+#endif
+        for (; p != end; ++p)
+        {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80)
+                return p;
+        }
+        return end;
+    }
+
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // The four hex digits at p, or -1
+    long readHex4(const char *p, const char *end)
+    {
+        if (end - p < 4)
+            return -1;
+        long value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            int digit = hexValue(p[i]);
+            if (digit < 0)
+                return -1;
+            value = value * 16 + digit;
+        }
+        return value;
+    }
+
+    bool isHighSurrogate(long unit) { return unit >= 0xD800 && unit <= 0xDBFF; }
+    bool isLowSurrogate(long unit) { return unit >= 0xDC00 && unit <= 0xDFFF; }
+
+    // The code point of the \u escape at p (just past the 'u'), joining a
+    // surrogate pair; sets `next` past it. Returns -1 if invalid.
+    long readUnicodeEscape(const char *p, const char *end, const char *&next)
+    {
+        long unit = readHex4(p, end);
+        if (unit < 0 || isLowSurrogate(unit))
+            return -1;
+        next = p + 4;
+        if (!isHighSurrogate(unit))
+            return unit;
+        if (end - next < 6 || next[0] != '\\' || next[1] != 'u')
+            return -1;
+        long low = readHex4(next + 2, end);
+        if (!isLowSurrogate(low))
+            return -1;
+        next += 6;
+        return 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+    }
+
+    // Length of the well-formed UTF-8 sequence at p (first byte >= 0x80),
+    // or 0 (Unicode table 3-7)
+    std::size_t utf8SequenceLength(const unsigned char *p, const unsigned char *end)
+    {
+        unsigned char lead = p[0];
+        std::size_t length;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF)
+            length = 2;
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            length = 3;
+            if (lead == 0xE0)
+                low = 0xA0; // overlong
+            else if (lead == 0xED)
+                high = 0x9F; // surrogates
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            length = 4;
+            if (lead == 0xF0)
+                low = 0x90; // overlong
+            else if (lead == 0xF4)
+                high = 0x8F; // past U+10FFFF
+        }
+        else
+            return 0;
+
+        if (static_cast<std::size_t>(end - p) < length || p[1] < low || p[1] > high)
+            return 0;
+        for (std::size_t i = 2; i < length; ++i)
+        {
+            if (p[i] < 0x80 || p[i] > 0xBF)
+                return 0;
+        }
+        return length;
+    }
+
+    char *writeUtf8(long codePoint, char *out)
+    {
+        if (codePoint < 0x80)
+        {
+            *out++ = static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            *out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            *out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            *out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return out;
+    }
+}
+
+const char *scanStringBody(const char *p, const char *end)
+{
+    for (;;)
+    {
+        p = findSpecial(p, end);
+        if (p == end)
+            return nullptr;
+
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"')
+            return p;
+        if (c < 0x20)
+            return nullptr;
+
+        if (c == '\\')
+        {
+            if (end - p < 2)
+                return nullptr;
+            switch (p[1])
+            {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                p += 2;
+                break;
+            case 'u':
+                if (readUnicodeEscape(p + 2, end, p) < 0)
+                    return nullptr;
+                break;
+            default:
+                return nullptr;
+            }
+            continue;
+        }
+
+        // Non-ASCII text tends to come in runs; stay here while it does
+        do
+        {
+            std::size_t length = utf8SequenceLength(reinterpret_cast<const unsigned char *>(p),
+                                                    reinterpret_cast<const unsigned char *>(end));
+            if (length == 0)
+                return nullptr;
+            p += length;
+        } while (p != end && static_cast<unsigned char>(*p) >= 0x80);
+    }
+}
+
+std::size_t unescapeString(const char *p, const char *end, char *dest)
+{
+    char *out = dest;
+    for (;;)
+    {
+        // memchr finds the next escape a vector at a time
+        const char *escape = static_cast<const char *>(std::memchr(p, '\\', end - p));
+        const char *runEnd = escape ? escape : end;
+        std::memcpy(out, p, runEnd - p);
+        out += runEnd - p;
+        if (!escape)
+            break;
+
+        char c = escape[1];
+        p = escape + 2;
+        switch (c)
+        {
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u':
+            out = writeUtf8(readUnicodeEscape(p, end, p), out);
+            break;
+        default: // " \ /
+            *out++ = c;
+            break;
+        }
+    }
+    return static_cast<std::size_t>(out - dest);
+}
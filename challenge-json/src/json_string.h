@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// JSON string bodies: the bytes between the quotes.
+//
+// A body is valid when every escape is one of \" \\ \/ \b \f \n \r \t or
+// \uXXXX (with UTF-16 surrogates only in high-low pairs), no byte is below
+// 0x20, and the rest is well-formed UTF-8 (no overlong forms, surrogates
+// or code points past U+10FFFF). ASCII runs are skipped 16 bytes at a
+// time.
+
+// Scans a body starting at p and returns its closing quote, or nullptr if
+// the body is invalid or end comes first.
+const char *scanStringBody(const char *p, const char *end);
+
+// Writes the valid body [p, end) to dest with escapes resolved (\u as
+// UTF-8) and returns the number of bytes written, at most end - p.
+// Unescaped runs are copied in bulk.
+std::size_t unescapeString(const char *p, const char *end, char *dest);
@@ -1,138 +1,206 @@
 #include "lexer.h"
+#include "json_string.h"
 #include <iostream>
 #include <cctype>
+#include <cstring>
 
-Lexer::Lexer(const std::string &input) : s(input) {}
+void StdoutTrace::token(TokenType type, std::size_t pos)
+{
+    std::cout << "[LEX] " << tokenName(type) << " at pos " << pos << "\n";
+}
+
+Token scanKeyword(const char *s, std::size_t n, std::size_t &i)
+{
+    std::size_t start = i;
+    char start_char = s[i];
+
+    while (i < n && ((s[i]>='a' && s[i]<='z') || (s[i]>='A' && s[i]<='Z')))
+    {
+        i++;
+    }
+
+    std::size_t length = i - start;
+    TokenType result = TokenType::INVALID;
+    if (length == 4 && std::memcmp(s + start, "true", 4) == 0)
+        result = TokenType::TRUE;
+    else if (length == 5 && std::memcmp(s + start, "false", 5) == 0)
+        result = TokenType::FALSE;
+    else if (length == 4 && std::memcmp(s + start, "null", 4) == 0)
+        result = TokenType::NULL_TOKEN;
+
+    if (result == TokenType::INVALID)
+        return {TokenType::INVALID, start, 0, start_char};
+    return {result, start, length};
+}
+
+namespace
+{
+    bool isDigitAt(const char *s, std::size_t n, std::size_t i)
+    {
+        return i < n && s[i] >= '0' && s[i] <= '9';
+    }
+}
+
+Token scanNumber(const char *s, std::size_t n, std::size_t &i)
+{
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?, stopping at the first
+    // byte that can't continue it; a part left unfinished is INVALID,
+    // reported at that byte
+    std::size_t start = i;
+    if (s[i] == '-')
+        i++;
+
+    if (i < n && s[i] == '0')
+        i++;
+    else if (isDigitAt(s, n, i))
+        while (isDigitAt(s, n, i))
+            i++;
+    else
+        return {TokenType::INVALID, start, 0, i < n ? s[i] : '\0'};
+
+    if (i < n && s[i] == '.')
+    {
+        i++;
+        if (!isDigitAt(s, n, i))
+            return {TokenType::INVALID, start, 0, i < n ? s[i] : '\0'};
+        while (isDigitAt(s, n, i))
+            i++;
+    }
+
+    if (i < n && (s[i] == 'e' || s[i] == 'E'))
+    {
+        i++;
+        if (i < n && (s[i] == '+' || s[i] == '-'))
+            i++;
+        if (!isDigitAt(s, n, i))
+            return {TokenType::INVALID, start, 0, i < n ? s[i] : '\0'};
+        while (isDigitAt(s, n, i))
+            i++;
+    }
+
+    return {TokenType::NUMBER, start, i - start};
+}
+
+Token scanString(const char *s, std::size_t n, std::size_t &i)
+{
+    std::size_t start = i;
+    const char *close = scanStringBody(s + i + 1, s + n);
+    if (!close)
+        return {TokenType::INVALID, start, 0, '"'};
+    i = static_cast<std::size_t>(close - s) + 1;
+    return {TokenType::STRING, start, i - start};
+}
+
+template <typename Trace>
+BasicLexer<Trace>::BasicLexer(const std::string &input) : s(input.data()), n(input.size()) {}
 
-void Lexer::skipWs()
+template <typename Trace>
+BasicLexer<Trace>::BasicLexer(const char *data, std::size_t size) : s(data), n(size) {}
+
+template <typename Trace>
+void BasicLexer<Trace>::skipWs()
 {
-    while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i])))
+    while (i < n && isJsonSpace(s[i]))
         i++;
 }
 
-Token Lexer::next()
+template <typename Trace>
+Token BasicLexer<Trace>::next()
 {
     skipWs();
-    if (i >= s.size())
+    if (i >= n)
         return {TokenType::EOF_TOKEN, i};
 
     char c = s[i];
     if (c == '{')
     {
         i++;
-        std::cout << "[LEX] " << tokenName(TokenType::LBRACE) << " at pos " << (i - 1) << "\n";
-        return {TokenType::LBRACE, i - 1, "{"};
+        Trace::token(TokenType::LBRACE, i - 1);
+        return {TokenType::LBRACE, i - 1, 1};
     }
     if (c == '[')
     {
         i++;
-        std::cout << "[LEX] " << tokenName(TokenType::LBRACKET) << " at pos " << (i - 1) << "\n";
-        return {TokenType::LBRACKET, i - 1, "["};
+        Trace::token(TokenType::LBRACKET, i - 1);
+        return {TokenType::LBRACKET, i - 1, 1};
     }
     if (c == ']')
     {
         i++;
-        std::cout << "[LEX] " << tokenName(TokenType::RBRACKET) << " at pos " << (i - 1) << "\n";
-        return {TokenType::RBRACKET, i - 1, "]"};
+        Trace::token(TokenType::RBRACKET, i - 1);
+        return {TokenType::RBRACKET, i - 1, 1};
     }
     if (c == '}')
     {
         i++;
-        std::cout << "[LEX] " << tokenName(TokenType::RBRACE) << " at pos " << (i - 1) << "\n";
-        return {TokenType::RBRACE, i - 1, "}"};
+        Trace::token(TokenType::RBRACE, i - 1);
+        return {TokenType::RBRACE, i - 1, 1};
     }
     if (c == ':')
     {
         i++;
-        std::cout << "[LEX] " << tokenName(TokenType::COLON) << " at pos " << (i - 1) << "\n";
-        return {TokenType::COLON, i - 1, ":"};
+        Trace::token(TokenType::COLON, i - 1);
+        return {TokenType::COLON, i - 1, 1};
     }
     if (c == ',')
     {
         i++;
-        std::cout << "[LEX] " << tokenName(TokenType::COMMA) << " at pos " << (i - 1) << "\n";
-        return {TokenType::COMMA, i - 1, ","};
+        Trace::token(TokenType::COMMA, i - 1);
+        return {TokenType::COMMA, i - 1, 1};
     }
     if (c == '"')
         return parseString();
 
-    if (std::isalpha(c))
+    if (std::isalpha(static_cast<unsigned char>(c)))
         return parseKeyword();
-    if (std::isdigit(c))
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '-')
         return parseNumber();
 
     i++;
-    return {TokenType::INVALID, i - 1, "", c};
+    return {TokenType::INVALID, i - 1, 0, c};
 }
 
-Token Lexer::parseString()
+template <typename Trace>
+Token BasicLexer<Trace>::parseString()
 {
-    std::size_t start = i;
-    i++; // skip opening quote
-    std::string value;
-
-    while (i < s.size() && s[i] != '"')
-    {
-        if (s[i] == '\\')
-        {
-            i++; // skip escape character
-            if (i >= s.size())
-                return {TokenType::INVALID, start, "", '"'};
-            value += s[i]; // add escaped character
-            i++;
-        }
-        else
-        {
-            value += s[i];
-            i++;
-        }
-    }
-
-    if (i >= s.size())
-        return {TokenType::INVALID, start, "", '"'};
-
-    i++; // skip closing quote
-    std::cout << "[LEX] " << tokenName(TokenType::STRING) << " at pos " << start << "\n";
-    return {TokenType::STRING, start, value};
+    // Only check the string here; decodeString resolves escapes on demand
+    Token token = scanString(s, n, i);
+    if (token.type != TokenType::INVALID)
+        Trace::token(TokenType::STRING, token.pos);
+    return token;
 }
 
-Token Lexer::parseKeyword()
+template <typename Trace>
+Token BasicLexer<Trace>::parseKeyword()
 {
-    std::size_t start = i;
-    char start_char = s[i];
-    std::string keyword;
-
-    while (i < s.size() && ((s[i]>='a' && s[i]<='z') || (s[i]>='A' && s[i]<='Z')))
-    {
-        i++;
-    }
-
-    keyword = s.substr(start,i-start);
-    TokenType result = TokenType::INVALID;
-    if (keyword == "true")
-        result = TokenType::TRUE;
-    else if (keyword == "false")
-        result = TokenType::FALSE;
-    else if (keyword == "null")
-        result = TokenType::NULL_TOKEN;
-
-    if (result == TokenType::INVALID)
-        return {TokenType::INVALID, start, "", start_char};
-
-    std::cout << "[LEX] " << tokenName(result) << " at pos " << start << "\n";
-    return {result, start, keyword};
+    Token token = scanKeyword(s, n, i);
+    if (token.type != TokenType::INVALID)
+        Trace::token(token.type, token.pos);
+    return token;
 }
 
-Token Lexer::parseNumber()
+template <typename Trace>
+Token BasicLexer<Trace>::parseNumber()
 {
-    std::size_t start = i;
+    Token token = scanNumber(s, n, i);
+    if (token.type != TokenType::INVALID)
+        Trace::token(TokenType::NUMBER, token.pos);
+    return token;
+}
 
-    while (i < s.size() && std::isdigit(s[i]))
-    {
-        i++;
-    }
+template <typename Trace>
+std::string BasicLexer<Trace>::text(const Token &token) const
+{
+    return std::string(s + token.pos, token.length);
+}
 
-    std::string value = s.substr(start, i - start);
-    std::cout << "[LEX] " << tokenName(TokenType::NUMBER) << " at pos " << start << "\n";
-    return {TokenType::NUMBER, start, value};
+template <typename Trace>
+std::string BasicLexer<Trace>::decodeString(const Token &token) const
+{
+    std::string value(token.length, '\0');
+    value.resize(decodeStringInto(s, token, &value[0]));
+    return value;
 }
+
+template class BasicLexer<NoTrace>;
+template class BasicLexer<StdoutTrace>;
@@ -1,13 +1,31 @@
 #pragma once
 
 #include "token.h"
+#include "trace.h"
 #include <string>
 #include <cstddef>
 
-class Lexer
+// JSON's four whitespace characters (std::isspace also takes \v and \f)
+inline bool isJsonSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Scalar scanners shared by the lexers: scan the keyword, number or string
+// that starts at s[i] (i < n) and advance i past it. Numbers follow the
+// full RFC 8259 grammar; convertNumber (number.h) turns one into a value.
+// Strings are checked as json_string.h describes; an invalid one is an
+// INVALID token at its opening quote.
+Token scanKeyword(const char *s, std::size_t n, std::size_t &i);
+Token scanNumber(const char *s, std::size_t n, std::size_t &i);
+Token scanString(const char *s, std::size_t n, std::size_t &i);
+
+template <typename Trace>
+class BasicLexer
 {
 private:
-    const std::string &s;
+    const char *s;
+    std::size_t n;
     std::size_t i = 0;
 
     void skipWs();
@@ -16,6 +34,20 @@ private:
     Token parseNumber();
 
 public:
-    explicit Lexer(const std::string &input);
+    // The input must outlive the lexer and every token it returns
+    explicit BasicLexer(const std::string &input);
+    BasicLexer(const char *data, std::size_t size);
     Token next();
+
+    const char *data() const { return s; }
+    // Raw input bytes of a token (a STRING keeps its quotes and escapes)
+    std::string text(const Token &token) const;
+    // Contents of a STRING token with its escapes resolved. This is the
+    // only place string values are copied, so only consumers that need a
+    // string's value pay for it.
+    std::string decodeString(const Token &token) const;
 };
+
+// Both instantiations are compiled in lexer.cpp
+using Lexer = BasicLexer<NoTrace>;
+using TracingLexer = BasicLexer<StdoutTrace>;
@@ -1,12 +1,93 @@
 #include "file_utils.h"
 #include "lexer.h"
+#include "ndjson.h"
 #include "parser.h"
+#include "query.h"
+#include "schema.h"
+#include "stream_parser.h"
+#include "structural.h"
+#include "writer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+// Validates the file a chunk at a time, so its size isn't bounded by memory
+static bool streamFile(const std::string &filename, std::size_t maxDepth)
+{
+    std::ifstream file;
+    if (filename != "-")
+    {
+        file.open(filename, std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Could not open file: " + filename);
+    }
+    std::istream &input = filename == "-" ? std::cin : file;
+
+    const std::size_t CHUNK_SIZE = 1 << 20;
+    std::unique_ptr<char[]> chunk(new char[CHUNK_SIZE]);
+    StreamParser<> parser(NullStreamHandler(), maxDepth);
+    while (input)
+    {
+        input.read(chunk.get(), CHUNK_SIZE);
+        if (!parser.feed(chunk.get(), static_cast<std::size_t>(input.gcount())))
+            return false;
+    }
+    if (input.bad())
+        throw std::runtime_error("Failed to read file: " + filename);
+    return parser.finish();
+}
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    bool trace = false;
+    bool stream = false;
+    bool ndjson = false;
+    unsigned threads = 0;
+    std::size_t maxDepth = DEFAULT_MAX_DEPTH;
+    bool minify = false;
+    bool pretty = false;
+    bool query = false;
+    std::string schemaFile;
+    std::string queryPath;
+    std::string filename;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--trace")
+            trace = true;
+        else if (arg == "--stream")
+            stream = true;
+        else if (arg == "--ndjson")
+            ndjson = true;
+        else if (arg == "--minify")
+            minify = true;
+        else if (arg == "--pretty")
+            pretty = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "-q" && i + 1 < argc)
+        {
+            query = true;
+            queryPath = argv[++i];
+        }
+        else if (arg == "--schema" && i + 1 < argc)
+            schemaFile = argv[++i];
+        else if (arg == "--max-depth" && i + 1 < argc)
+            maxDepth = std::strtoul(argv[++i], nullptr, 10);
+        else if (filename.empty() && arg.compare(0, 2, "--") != 0)
+            filename = arg;
+        else
+        {
+            FileUtils::printUsage();
+            return 1;
+        }
+    }
+    if (filename.empty() || trace + stream + ndjson + query + minify + pretty + !schemaFile.empty() > 1)
     {
         FileUtils::printUsage();
         return 1;
@@ -14,12 +95,90 @@ int main(int argc, char **argv)
 
     try
     {
-        std::string fileContent = FileUtils::readFileForParsing(argv[1]);
+        if (stream)
+        {
+            bool ok = streamFile(filename, maxDepth);
+            std::cout << (ok ? "Valid JSON\n" : "Invalid JSON\n");
+            return ok ? 0 : 1;
+        }
+
+        // Mapped, not copied, when it's a regular file
+        FileUtils::InputFile input(filename);
+
+        if (query)
+        {
+            // Each selected value's text on its own line
+            Query q(queryPath);
+            std::vector<QueryMatch> matches;
+            bool ok = q.evaluate(input.data(), input.size(), matches);
+            for (const QueryMatch &match : matches)
+                std::cout.write(input.data() + match.pos, match.length) << "\n";
+            if (!ok)
+                std::cerr << "Invalid JSON\n";
+            return ok ? 0 : 1;
+        }
+
+        if (!schemaFile.empty())
+        {
+            // Compiled once; syntax and schema are checked in one pass
+            FileUtils::InputFile schemaInput(schemaFile);
+            Schema schema(std::string(schemaInput.data(), schemaInput.size()));
+            SchemaViolation violation;
+            SchemaResult result = schema.validate(input.data(), input.size(), &violation, maxDepth);
+            if (result == SchemaResult::Violation)
+                std::cout << "Schema violation at " << violation.path << ": " << violation.message << "\n";
+            else
+                std::cout << (result == SchemaResult::Valid ? "Valid JSON\n" : "Invalid JSON\n");
+            return result == SchemaResult::Valid ? 0 : 1;
+        }
+
+        if (minify || pretty)
+        {
+            // Nothing is printed unless the whole document is valid
+            OutputBuffer out(input.size() + 1);
+            JsonWriter writer(out, pretty ? WriteStyle::Pretty : WriteStyle::Minify);
+            if (!rewrite(input.data(), input.size(), writer, maxDepth))
+            {
+                std::cerr << "Invalid JSON\n";
+                return 1;
+            }
+            out.append('\n');
+            if (std::fwrite(out.data(), 1, out.size(), stdout) != out.size() || std::fflush(stdout) != 0)
+                throw std::runtime_error("Failed to write output");
+            return 0;
+        }
 
-        Lexer lexer(fileContent);
-        Parser parser(std::move(lexer));
+        if (ndjson)
+        {
+            NdjsonResult result = validateLines(input.data(), input.size(), threads, maxDepth);
+            for (std::size_t line : result.invalidLines)
+                std::cout << "Line " << line << ": Invalid JSON\n";
+            std::cout << result.records << " records, " << result.invalidLines.size() << " invalid\n";
+            return result.invalidLines.empty() ? 0 : 1;
+        }
 
-        bool ok = parser.parse();
+        // The traced parser is a separate instantiation; the default one
+        // carries no trace code and lexes from the structural index
+        bool ok;
+        StructuralIndex index;
+        if (trace)
+        {
+            TracingLexer lexer(input.data(), input.size());
+            TracingParser parser(std::move(lexer), NullHandler(), maxDepth);
+            ok = parser.parse();
+        }
+        else if (index.build(input.data(), input.size(), Stage1Kernel::Auto, FileUtils::INPUT_PADDING))
+        {
+            IndexedLexer lexer(input.data(), input.size(), index);
+            IndexedParser parser(std::move(lexer), NullHandler(), maxDepth);
+            ok = parser.parse();
+        }
+        else
+        {
+            Lexer lexer(input.data(), input.size());
+            Parser parser(std::move(lexer), NullHandler(), maxDepth);
+            ok = parser.parse();
+        }
         std::cout << (ok ? "Valid JSON\n" : "Invalid JSON\n");
         return ok ? 0 : 1;
     }
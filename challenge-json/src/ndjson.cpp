@@ -0,0 +1,122 @@
+#include "ndjson.h"
+#include "lexer.h"
+#include "parser.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    // Small enough that every core gets several, large enough that taking
+    // one costs nothing next to validating it
+    const std::size_t BATCH_SIZE = 256 * 1024;
+
+    struct Batch
+    {
+        const char *begin;
+        const char *end;
+        std::size_t lines = 0;
+        std::size_t records = 0;
+        std::vector<std::size_t> invalidLines; // relative to the batch
+    };
+
+    // Cuts the input into batches of about BATCH_SIZE bytes that end just
+    // after a newline, so no line is split
+    std::vector<Batch> makeBatches(const char *data, std::size_t size)
+    {
+        std::vector<Batch> batches;
+        const char *end = data + size;
+        for (const char *begin = data; begin < end;)
+        {
+            const char *cut = end;
+            if (static_cast<std::size_t>(end - begin) > BATCH_SIZE)
+            {
+                const void *newline = std::memchr(begin + BATCH_SIZE, '\n', end - begin - BATCH_SIZE);
+                if (newline)
+                    cut = static_cast<const char *>(newline) + 1;
+            }
+            Batch batch;
+            batch.begin = begin;
+            batch.end = cut;
+            batches.push_back(batch);
+            begin = cut;
+        }
+        return batches;
+    }
+
+    bool blank(const char *line, std::size_t length)
+    {
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            if (!isJsonSpace(line[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // Records are short, so the byte lexer beats building a structural
+    // index per line
+    bool validateLine(const char *line, std::size_t length, std::size_t maxDepth)
+    {
+        return Parser(Lexer(line, length), NullHandler(), maxDepth).parse();
+    }
+
+    void validateBatch(Batch &batch, std::size_t maxDepth)
+    {
+        for (const char *line = batch.begin; line < batch.end;)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(line, '\n', batch.end - line));
+            if (!eol)
+                eol = batch.end;
+            std::size_t length = static_cast<std::size_t>(eol - line);
+            ++batch.lines;
+            if (!blank(line, length))
+            {
+                ++batch.records;
+                if (!validateLine(line, length, maxDepth))
+                    batch.invalidLines.push_back(batch.lines);
+            }
+            line = eol + 1;
+        }
+    }
+}
+
+NdjsonResult validateLines(const char *data, std::size_t size, unsigned threads, std::size_t maxDepth)
+{
+    std::vector<Batch> batches = makeBatches(data, size);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t workers = std::min<std::size_t>(threads, batches.size());
+
+    // Workers take the next unclaimed batch until none are left
+    std::atomic<std::size_t> nextBatch(0);
+    auto work = [&batches, &nextBatch, maxDepth]() {
+        for (std::size_t b; (b = nextBatch.fetch_add(1)) < batches.size();)
+            validateBatch(batches[b], maxDepth);
+    };
+    if (workers <= 1)
+    {
+        work();
+    }
+    else
+    {
+        std::vector<std::thread> pool;
+        for (std::size_t i = 0; i < workers; ++i)
+            pool.emplace_back(work);
+        for (std::thread &thread : pool)
+            thread.join();
+    }
+
+    NdjsonResult result;
+    std::size_t firstLine = 0;
+    for (const Batch &batch : batches)
+    {
+        result.records += batch.records;
+        for (std::size_t line : batch.invalidLines)
+            result.invalidLines.push_back(firstLine + line);
+        firstLine += batch.lines;
+    }
+    return result;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "depth_stack.h"
+#include <cstddef>
+#include <vector>
+
+// Newline-delimited JSON (JSON Lines): one document per line, each held
+// to the same grammar as a whole file. Blank lines are skipped.
+struct NdjsonResult
+{
+    std::size_t records = 0;              // non-blank lines
+    std::vector<std::size_t> invalidLines; // 1-based, in input order
+};
+
+// Validates every line of data[0, size). The input is cut at newlines into
+// batches that `threads` workers validate concurrently (0 means one per
+// core); results are merged back into input order, so the outcome doesn't
+// depend on the thread count. Records nested deeper than maxDepth are
+// invalid.
+NdjsonResult validateLines(const char *data, std::size_t size, unsigned threads = 0,
+                           std::size_t maxDepth = DEFAULT_MAX_DEPTH);
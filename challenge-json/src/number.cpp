@@ -0,0 +1,136 @@
+#include "number.h"
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace
+{
+    // Powers of ten a double holds exactly
+    const double EXACT_POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                          1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                          1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const int MAX_EXACT_POWER = 22;
+    const uint64_t MAX_EXACT_MANTISSA = uint64_t(1) << 53;
+
+    bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    // mantissa = mantissa * 10 + digit, unless that overflows
+    bool appendDigit(uint64_t &mantissa, char digit)
+    {
+        uint64_t next;
+        if (__builtin_mul_overflow(mantissa, 10, &next) ||
+            __builtin_add_overflow(next, static_cast<uint64_t>(digit - '0'), &next))
+            return false;
+        mantissa = next;
+        return true;
+    }
+
+    // The input isn't NUL-terminated, so convert from a copy
+    double slowConvert(const char *text, std::size_t length)
+    {
+        char digits[64];
+        if (length < sizeof(digits))
+        {
+            std::memcpy(digits, text, length);
+            digits[length] = '\0';
+            return std::strtod(digits, nullptr);
+        }
+        return std::strtod(std::string(text, length).c_str(), nullptr);
+    }
+}
+
+Number convertNumber(const char *text, std::size_t length)
+{
+    const char *p = text;
+    const char *end = text + length;
+    bool negative = *p == '-';
+    if (negative)
+        ++p;
+
+    // Significant digits collect in mantissa until it would overflow; the
+    // integer digits left out bump exp10, so mantissa * 10^exp10 stays the
+    // value but for the `truncated` nonzero digits
+    uint64_t mantissa = 0;
+    int exp10 = 0;
+    bool full = false;
+    bool truncated = false;
+    bool integer = true;
+
+    for (; p != end && isDigit(*p); ++p)
+    {
+        if (!full && appendDigit(mantissa, *p))
+            continue;
+        full = true;
+        truncated = truncated || *p != '0';
+        ++exp10;
+    }
+    if (p != end && *p == '.')
+    {
+        integer = false;
+        for (++p; p != end && isDigit(*p); ++p)
+        {
+            if (!full && appendDigit(mantissa, *p))
+            {
+                --exp10;
+                continue;
+            }
+            full = true;
+            truncated = truncated || *p != '0';
+        }
+    }
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+        integer = false;
+        ++p;
+        bool negativeExponent = *p == '-';
+        if (*p == '-' || *p == '+')
+            ++p;
+        int exponent = 0;
+        for (; p != end && isDigit(*p); ++p)
+        {
+            if (exponent < 100000) // far past any double; keeps the sum in range
+                exponent = exponent * 10 + (*p - '0');
+        }
+        exp10 += negativeExponent ? -exponent : exponent;
+    }
+
+    Number number;
+    if (integer && !truncated && exp10 == 0)
+    {
+        if (!negative && mantissa <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        {
+            number.kind = NumberKind::Int64;
+            number.integer = static_cast<int64_t>(mantissa);
+            return number;
+        }
+        if (!negative)
+        {
+            number.kind = NumberKind::Uint64;
+            number.unsignedInteger = mantissa;
+            return number;
+        }
+        if (mantissa <= uint64_t(1) << 63)
+        {
+            number.kind = NumberKind::Int64;
+            number.integer = mantissa == 0 ? 0 : -static_cast<int64_t>(mantissa - 1) - 1;
+            return number;
+        }
+    }
+
+    number.kind = NumberKind::Double;
+    if (!truncated && mantissa <= MAX_EXACT_MANTISSA && exp10 >= -MAX_EXACT_POWER && exp10 <= MAX_EXACT_POWER)
+    {
+        // Both operands are exact, so IEEE rounding of the one operation
+        // gives the correctly rounded result
+        double value = static_cast<double>(mantissa);
+        value = exp10 < 0 ? value / EXACT_POWERS_OF_TEN[-exp10] : value * EXACT_POWERS_OF_TEN[exp10];
+        number.real = negative ? -value : value;
+        return number;
+    }
+    number.real = slowConvert(text, length);
+    return number;
+}
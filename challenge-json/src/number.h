@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// What a JSON number converts to: integers that fit 64 bits stay exact,
+// everything else (fractions, exponents, huge integers) becomes a double.
+enum class NumberKind : uint8_t
+{
+    Int64,
+    Uint64, // positive integers above INT64_MAX
+    Double
+};
+
+struct Number
+{
+    NumberKind kind;
+    union
+    {
+        int64_t integer;
+        uint64_t unsignedInteger;
+        double real;
+    };
+
+    double toDouble() const
+    {
+        return kind == NumberKind::Int64    ? static_cast<double>(integer)
+               : kind == NumberKind::Uint64 ? static_cast<double>(unsignedInteger)
+                                            : real;
+    }
+};
+
+// Converts the text of a NUMBER token, which the lexer has already checked
+// against the grammar. Validation never calls this, so it costs nothing
+// until a consumer wants the value. Doubles are correctly rounded: exact
+// integer arithmetic and one multiply or divide when the digits fit 53
+// bits and the power of ten is small, strtod otherwise.
+Number convertNumber(const char *text, std::size_t length);
@@ -1,21 +1,58 @@
 #pragma once
 
+#include "depth_stack.h"
 #include "lexer.h"
 #include "token.h"
 
-class Parser
+// Receives the document's structure as the parser validates it. Scalar
+// values (STRING, NUMBER, TRUE, FALSE, NULL_TOKEN) and keys arrive as
+// tokens, i.e. spans of the input. Returning false stops the parse, which
+// then reports the document as rejected. The parser keeps its own copy of
+// the handler, so handlers are small objects pointing at their results.
+// NullHandler is plain validation; its calls compile away.
+struct NullHandler
+{
+    bool startObject() { return true; }
+    bool key(const Token &) { return true; }
+    bool endObject() { return true; }
+    bool startArray() { return true; }
+    bool endArray() { return true; }
+    bool value(const Token &) { return true; }
+};
+
+// LexerType is anything with Lexer's next(): the byte-at-a-time lexers or
+// IndexedLexer (structural.h). The grammar runs as a loop over an explicit
+// state, with open containers on a DepthStack rather than the C++ stack,
+// so hostile nesting is rejected at maxDepth instead of overflowing.
+template <typename LexerType, typename Handler = NullHandler>
+class BasicParser
 {
 private:
-    Lexer lex;
+    // What the loop does with the current token
+    enum class State
+    {
+        Value,      // start a value
+        Key,        // a key and its colon, then a value
+        AfterValue, // a comma, or the end of the container
+        Close       // the end of the container
+    };
+
+    LexerType lex;
     Token cur;
+    Handler handler;
+    DepthStack stack;
 
     void advance();
-    bool parseKeyValue();
-    bool parseValue();
-    bool parseObject();
-    bool parseArray();
 
 public:
-    explicit Parser(Lexer l);
+    explicit BasicParser(LexerType l, Handler h = Handler(), std::size_t maxDepth = DEFAULT_MAX_DEPTH);
     bool parse();
 };
+
+// Parser and TracingParser are compiled in parser.cpp, IndexedParser in
+// structural.cpp; parsers with other handlers instantiate parser_impl.h
+// where the handler is defined
+class IndexedLexer;
+using Parser = BasicParser<Lexer>;
+using TracingParser = BasicParser<TracingLexer>;
+using IndexedParser = BasicParser<IndexedLexer>;
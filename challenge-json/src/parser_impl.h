@@ -0,0 +1,116 @@
+#pragma once
+
+// Member definitions of BasicParser. Included by the translation units
+// that instantiate a parser: parser.cpp for plain validation, and the
+// file defining each handler for the others.
+
+#include "parser.h"
+
+template <typename LexerType, typename Handler>
+BasicParser<LexerType, Handler>::BasicParser(LexerType l, Handler h, std::size_t maxDepth)
+    : lex(std::move(l)), cur(TokenType::INVALID, 0), handler(h), stack(maxDepth)
+{
+    advance();
+}
+
+template <typename LexerType, typename Handler>
+void BasicParser<LexerType, Handler>::advance()
+{
+    cur = lex.next();
+}
+
+template <typename LexerType, typename Handler>
+bool BasicParser<LexerType, Handler>::parse()
+{
+    // The top level must be an object
+    if (cur.type != TokenType::LBRACE)
+        return false;
+
+    State state = State::Value;
+    for (;;)
+    {
+        switch (state)
+        {
+        case State::Value:
+            switch (cur.type)
+            {
+            case TokenType::LBRACE:
+                if (!stack.push(true) || !handler.startObject())
+                    return false;
+                advance();
+                state = cur.type == TokenType::RBRACE ? State::Close : State::Key;
+                break;
+
+            case TokenType::LBRACKET:
+                if (!stack.push(false) || !handler.startArray())
+                    return false;
+                advance();
+                state = cur.type == TokenType::RBRACKET ? State::Close : State::Value;
+                break;
+
+            case TokenType::STRING:
+            case TokenType::NUMBER:
+            case TokenType::TRUE:
+            case TokenType::FALSE:
+            case TokenType::NULL_TOKEN:
+                if (!handler.value(cur))
+                    return false;
+                advance();
+                state = State::AfterValue;
+                break;
+
+            default:
+                return false;
+            }
+            break;
+
+        case State::Key:
+            // Keys must be strings
+            if (cur.type != TokenType::STRING || !handler.key(cur))
+                return false;
+            advance();
+            if (cur.type != TokenType::COLON)
+                return false;
+            advance();
+            state = State::Value;
+            break;
+
+        case State::AfterValue:
+            // After the top-level object, only the end of the input
+            if (stack.empty())
+                return cur.type == TokenType::EOF_TOKEN;
+            if (cur.type == TokenType::COMMA)
+            {
+                // A trailing comma fails in Key or Value on the closer
+                advance();
+                state = stack.topIsObject() ? State::Key : State::Value;
+            }
+            else
+            {
+                state = State::Close;
+            }
+            break;
+
+        case State::Close:
+            if (stack.topIsObject())
+            {
+                if (cur.type != TokenType::RBRACE)
+                    return false;
+                advance();
+                if (!handler.endObject())
+                    return false;
+            }
+            else
+            {
+                if (cur.type != TokenType::RBRACKET)
+                    return false;
+                advance();
+                if (!handler.endArray())
+                    return false;
+            }
+            stack.pop();
+            state = State::AfterValue;
+            break;
+        }
+    }
+}
@@ -0,0 +1,366 @@
+#include "query.h"
+#include "json_string.h"
+#include "lexer.h"
+#include "parser_impl.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    std::invalid_argument badPath(const std::string &path, const char *why)
+    {
+        return std::invalid_argument("Invalid query '" + path + "': " + why);
+    }
+
+    // Lexes one value as the member of an object, {"":value}, so Parser,
+    // whose grammar wants an object at the top, can check any value
+    class MemberLexer
+    {
+    public:
+        MemberLexer(const char *data, std::size_t size) : lexer(data, size) {}
+
+        Token next()
+        {
+            switch (stage)
+            {
+            case 0:
+                ++stage;
+                return Token(TokenType::LBRACE, 0, 1);
+            case 1:
+                ++stage;
+                return Token(TokenType::STRING, 0, 2);
+            case 2:
+                ++stage;
+                return Token(TokenType::COLON, 0, 1);
+            }
+            Token token = lexer.next();
+            if (token.type == TokenType::EOF_TOKEN && stage == 3)
+            {
+                ++stage;
+                return Token(TokenType::RBRACE, token.pos, 1);
+            }
+            return token;
+        }
+
+    private:
+        Lexer lexer;
+        int stage = 0;
+    };
+
+    // Walks the structural index of one document for one query. Every
+    // function takes `k`, the entry a value starts at, and leaves it at the
+    // entry after the value.
+    class Walker
+    {
+    public:
+        using Step = Query::Step;
+
+        Walker(const char *data, std::size_t size, const StructuralIndex &index, const std::vector<Step> &steps,
+               bool single, std::vector<QueryMatch> &matches)
+            : s(data), n(size), pos(index.positions()), count(index.size()), steps(steps), single(single),
+              matches(matches)
+        {
+        }
+
+        // The document must be one object, as Parser requires; only the
+        // parts the walk visits are checked beyond that
+        bool run()
+        {
+            std::size_t k = 0;
+            if (at(0) != '{' || !visit(k, 0))
+                return false;
+            // Nothing may follow the object; anything but whitespace after
+            // it would be in the index. A walk that stopped at its single
+            // match has to find the object's end first.
+            std::size_t rootEnd;
+            if (done)
+                k = 0;
+            return (!done || skip(k, rootEnd)) && k == count;
+        }
+
+    private:
+        const char *s;
+        std::size_t n;
+        const uint32_t *pos;
+        std::size_t count;
+        const std::vector<Step> &steps;
+        bool single;
+        std::vector<QueryMatch> &matches;
+        bool done = false; // a single-match query has its match
+        std::string scratch;
+
+        // The structural character at entry k; NUL past the end, which no
+        // check accepts
+        char at(std::size_t k) const { return k < count ? s[pos[k]] : '\0'; }
+
+        bool visit(std::size_t &k, std::size_t step)
+        {
+            if (step == steps.size())
+            {
+                if (at(k) == '\0')
+                    return false;
+                std::size_t begin = pos[k];
+                std::size_t end;
+                if (!skip(k, end) || !isValid(begin, end, step))
+                    return false;
+                matches.push_back({begin, end - begin});
+                done = single;
+                return true;
+            }
+
+            const Step &current = steps[step];
+            char c = at(k);
+            if (c == '{' && current.kind != Step::Index)
+                return visitObject(k, step);
+            if (c == '[' && current.kind != Step::Name)
+                return visitArray(k, step);
+            // This value can't have what the step asks for
+            std::size_t end;
+            return skip(k, end);
+        }
+
+        bool visitObject(std::size_t &k, std::size_t step)
+        {
+            const Step &current = steps[step];
+            bool found = false;
+            ++k;
+            if (at(k) == '}')
+            {
+                ++k;
+                return true;
+            }
+            for (;;)
+            {
+                if (at(k) != '"' || at(k + 1) != '"' || at(k + 2) != ':')
+                    return false;
+                std::size_t keyBegin = pos[k] + 1;
+                std::size_t keyEnd = pos[k + 1];
+                k += 3;
+
+                bool ok = true;
+                if (current.kind == Step::Wildcard || (!found && keyMatches(keyBegin, keyEnd, current.name, ok)))
+                {
+                    found = true;
+                    ok = visit(k, step + 1);
+                }
+                else
+                {
+                    std::size_t end;
+                    ok = ok && skip(k, end);
+                }
+                if (!ok)
+                    return false;
+                if (done)
+                    return true;
+
+                char c = at(k++);
+                if (c == '}')
+                    return true;
+                if (c != ',')
+                    return false;
+            }
+        }
+
+        bool visitArray(std::size_t &k, std::size_t step)
+        {
+            const Step &current = steps[step];
+            ++k;
+            if (at(k) == ']')
+            {
+                ++k;
+                return true;
+            }
+            for (std::size_t i = 0;; ++i)
+            {
+                bool ok;
+                if (current.kind == Step::Wildcard || i == current.index)
+                {
+                    ok = visit(k, step + 1);
+                }
+                else
+                {
+                    std::size_t end;
+                    ok = skip(k, end);
+                }
+                if (!ok)
+                    return false;
+                if (done)
+                    return true;
+
+                char c = at(k++);
+                if (c == ']')
+                    return true;
+                if (c != ',')
+                    return false;
+            }
+        }
+
+        // Compares a key's body with a name; `ok` is false for a body that
+        // isn't a valid string
+        bool keyMatches(std::size_t begin, std::size_t end, const std::string &name, bool &ok)
+        {
+            ok = true;
+            const char *body = s + begin;
+            std::size_t length = end - begin;
+            if (!std::memchr(body, '\\', length))
+                return length == name.size() && std::memcmp(body, name.data(), length) == 0;
+
+            if (scanStringBody(body, s + end + 1) != s + end)
+            {
+                ok = false;
+                return false;
+            }
+            scratch.resize(length);
+            scratch.resize(unescapeString(body, s + end, &scratch[0]));
+            return scratch == name;
+        }
+
+        // Skipping trusts the index, so a match is checked in full before
+        // it is reported: nothing the validator rejects is ever printed.
+        // Scalars must scan to exactly their span; containers are parsed,
+        // `depth` levels down, which count against the usual limit.
+        bool isValid(std::size_t begin, std::size_t end, std::size_t depth) const
+        {
+            char c = s[begin];
+            if (c == '"')
+                return scanStringBody(s + begin + 1, s + end) == s + end - 1;
+            if (c != '{' && c != '[')
+            {
+                std::size_t i = begin;
+                Token token = c == '-' || (c >= '0' && c <= '9') ? scanNumber(s, n, i) : scanKeyword(s, n, i);
+                return token.type != TokenType::INVALID && i == end;
+            }
+            if (depth > DEFAULT_MAX_DEPTH)
+                return false;
+            // One more level for the object MemberLexer wraps it in
+            return BasicParser<MemberLexer>(MemberLexer(s + begin, end - begin), NullHandler(),
+                                            DEFAULT_MAX_DEPTH - depth + 1)
+                .parse();
+        }
+
+        // Moves past the value at k without looking inside it, and sets
+        // `end` to the input offset just past it
+        bool skip(std::size_t &k, std::size_t &end)
+        {
+            char c = at(k);
+            if (c == '{' || c == '[')
+            {
+                // Quotes and scalar starts don't change the depth, and
+                // nothing inside strings is in the index
+                std::size_t depth = 0;
+                do
+                {
+                    c = at(k++);
+                    if (c == '{' || c == '[')
+                        ++depth;
+                    else if (c == '}' || c == ']')
+                        --depth;
+                    else if (c == '\0')
+                        return false;
+                } while (depth > 0);
+                end = pos[k - 1] + 1;
+                return true;
+            }
+            if (c == '"')
+            {
+                if (at(k + 1) != '"')
+                    return false;
+                end = pos[k + 1] + 1;
+                k += 2;
+                return true;
+            }
+            if (c == '\0' || c == '}' || c == ']' || c == ':' || c == ',')
+                return false;
+
+            // A number or keyword runs to the next delimiter
+            end = pos[k];
+            while (end < n && !isJsonSpace(s[end]) && !std::strchr("{}[]:,\"", s[end]))
+                ++end;
+            ++k;
+            return true;
+        }
+    };
+}
+
+Query::Query(const std::string &path)
+{
+    if (path.empty() || path[0] != '$')
+        throw badPath(path, "must start with $");
+
+    std::size_t i = 1;
+    while (i < path.size())
+    {
+        Step step{Step::Name, std::string(), 0};
+        if (path[i] == '.')
+        {
+            ++i;
+            if (i < path.size() && path[i] == '*')
+            {
+                step.kind = Step::Wildcard;
+                ++i;
+            }
+            else
+            {
+                std::size_t end = path.find_first_of(".[", i);
+                if (end == std::string::npos)
+                    end = path.size();
+                if (end == i)
+                    throw badPath(path, "empty member name");
+                step.name = path.substr(i, end - i);
+                i = end;
+            }
+        }
+        else if (path[i] == '[')
+        {
+            ++i;
+            if (i < path.size() && path[i] == '*')
+            {
+                step.kind = Step::Wildcard;
+                ++i;
+            }
+            else if (i < path.size() && (path[i] == '\'' || path[i] == '"'))
+            {
+                // A quoted name; a backslash takes the next character as is
+                char quote = path[i++];
+                while (i < path.size() && path[i] != quote)
+                {
+                    if (path[i] == '\\' && i + 1 < path.size())
+                        ++i;
+                    step.name += path[i++];
+                }
+                if (i == path.size())
+                    throw badPath(path, "unterminated name");
+                ++i;
+            }
+            else
+            {
+                step.kind = Step::Index;
+                std::size_t digits = i;
+                while (i < path.size() && path[i] >= '0' && path[i] <= '9')
+                    step.index = step.index * 10 + static_cast<std::size_t>(path[i++] - '0');
+                if (i == digits)
+                    throw badPath(path, "expected an index, a quoted name or *");
+            }
+            if (i == path.size() || path[i] != ']')
+                throw badPath(path, "missing ]");
+            ++i;
+        }
+        else
+        {
+            throw badPath(path, "expected . or [");
+        }
+        single = single && step.kind != Step::Wildcard;
+        steps.push_back(step);
+    }
+}
+
+bool Query::evaluate(const char *data, std::size_t size, std::vector<QueryMatch> &matches)
+{
+    if (!index.build(data, size))
+        throw std::runtime_error("Queries don't support inputs of 4 GiB or more");
+    std::size_t before = matches.size();
+    if (Walker(data, size, index, steps, single, matches).run())
+        return true;
+    matches.resize(before);
+    return false;
+}
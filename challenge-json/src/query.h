@@ -0,0 +1,56 @@
+#pragma once
+
+#include "structural.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A value a query selected: its raw text, [pos, pos + length) of the input
+struct QueryMatch
+{
+    std::size_t pos;
+    std::size_t length;
+};
+
+// JSONPath-style queries evaluated on demand. Supported paths start at $
+// and continue with any of
+//   .name  ['name']  ["name"]   the first member with that key
+//   [N]                         the Nth array element, from 0
+//   .*  [*]                     every member or element
+// Evaluation walks the structural index: subtrees the path can't reach
+// are skipped by bracket counting over the index, without lexing or
+// building anything, and a path without wildcards stops at its first
+// match. As for Parser, the document must be one object with nothing but
+// whitespace after it, and each match is parsed in full before it is
+// returned; skipped subtrees are only bracket-counted, so a document
+// invalid inside one can still produce matches.
+class Query
+{
+public:
+    // Throws std::invalid_argument if the path isn't one of the above
+    explicit Query(const std::string &path);
+
+    // Appends the matches in document order. Returns false, appending
+    // nothing, if the document isn't one object followed only by
+    // whitespace, or if the visited structure or a match is malformed.
+    // The index is kept for the next document.
+    bool evaluate(const char *data, std::size_t size, std::vector<QueryMatch> &matches);
+
+    // One parsed path segment
+    struct Step
+    {
+        enum Kind
+        {
+            Name,
+            Index,
+            Wildcard
+        } kind;
+        std::string name;
+        std::size_t index;
+    };
+
+private:
+    std::vector<Step> steps;
+    bool single = true; // no wildcards: at most one match
+    StructuralIndex index;
+};
@@ -0,0 +1,484 @@
+#include "schema.h"
+#include "dom.h"
+#include "lexer.h"
+#include "number.h"
+#include "parser_impl.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    std::invalid_argument badSchema(const std::string &where, const std::string &why)
+    {
+        return std::invalid_argument("Invalid schema at " + (where.empty() ? std::string("/") : where) + ": " + why);
+    }
+
+    uint32_t countOf(const Value &v, const char *keyword, const std::string &where)
+    {
+        if (!v.isUint64() || v.asUint64() > UINT32_MAX)
+            throw badSchema(where, std::string(keyword) + " must be a non-negative integer");
+        return static_cast<uint32_t>(v.asUint64());
+    }
+
+    double boundOf(const Value &v, const char *keyword, const std::string &where)
+    {
+        if (!v.isNumber())
+            throw badSchema(where, std::string(keyword) + " must be a number");
+        return v.asNumber();
+    }
+
+    // JSON Pointer escaping of one path segment
+    void appendSegment(std::string &path, const char *text, std::size_t length)
+    {
+        path += '/';
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            if (text[i] == '~')
+                path += "~0";
+            else if (text[i] == '/')
+                path += "~1";
+            else
+                path += text[i];
+        }
+    }
+
+    std::size_t codePoints(const char *text, std::size_t length)
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < length; ++i)
+            count += (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80;
+        return count;
+    }
+}
+
+// Parser handler that runs the compiled program over the token walk. The
+// node the next value must match is the root's, a property's (set by the
+// key) or the enclosing array's `items`; containers push a Frame.
+class SchemaChecker
+{
+public:
+    SchemaChecker(Schema &schema, const char *input, SchemaViolation *violation, bool &violated)
+        : schema(&schema), input(input), violation(violation), violated(&violated), next(schema.root)
+    {
+    }
+
+    bool startObject() { return open(Schema::ObjectType); }
+
+    bool key(const Token &token)
+    {
+        Schema::Frame &frame = schema->frames.back();
+        ++frame.count;
+        frame.key = token.pos + 1;
+        frame.keyLength = token.length - 2;
+        next = 0;
+        const Schema::Node &node = schema->nodes[frame.node];
+        if (node.propertyCount == 0)
+            return true;
+
+        const char *text = input + frame.key;
+        std::size_t length = frame.keyLength;
+        if (std::memchr(text, '\\', length))
+        {
+            scratch.resize(token.length);
+            scratch.resize(decodeStringInto(input, token, &scratch[0]));
+            text = scratch.data();
+            length = scratch.size();
+        }
+        const Schema::Property *p = &schema->properties[node.firstProperty];
+        for (const Schema::Property *end = p + node.propertyCount; p != end; ++p)
+        {
+            if (p->name.size() == length && std::memcmp(p->name.data(), text, length) == 0)
+            {
+                next = p->node;
+                frame.seen |= p->bit;
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool endObject()
+    {
+        const Schema::Frame &frame = schema->frames.back();
+        const Schema::Node &node = schema->nodes[frame.node];
+        if ((frame.seen & node.required) != node.required)
+        {
+            // Name the first missing property
+            const Schema::Property *p = &schema->properties[node.firstProperty];
+            while (!(p->bit & node.required & ~frame.seen))
+                ++p;
+            return fail("missing required property \"" + p->name + "\"", true);
+        }
+        schema->frames.pop_back();
+        return true;
+    }
+
+    bool startArray() { return open(Schema::ArrayType); }
+
+    bool endArray()
+    {
+        const Schema::Frame &frame = schema->frames.back();
+        const Schema::Node &node = schema->nodes[frame.node];
+        if (frame.count < node.minItems)
+            return fail("expected at least " + std::to_string(node.minItems) + " items", true);
+        schema->frames.pop_back();
+        return true;
+    }
+
+    bool value(const Token &token)
+    {
+        uint32_t index;
+        if (!nodeForValue(index))
+            return false;
+        if (index == 0)
+            return true;
+        const Schema::Node &node = schema->nodes[index];
+
+        switch (token.type)
+        {
+        case TokenType::STRING:
+            return (node.types & Schema::StringType) ? !node.checkString || checkString(node, token)
+                                                     : fail("expected " + typeNames(node.types));
+        case TokenType::NUMBER:
+            if (!(node.types & (Schema::NumberType | Schema::IntegerType)))
+                return fail("expected " + typeNames(node.types));
+            return !node.checkNumber || checkNumber(node, token);
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+            if (!(node.types & Schema::BooleanType))
+                return fail("expected " + typeNames(node.types));
+            return !node.hasEnum || checkEnum(node, Schema::BooleanType, token.type == TokenType::TRUE);
+        default: // NULL_TOKEN
+            if (!(node.types & Schema::NullType))
+                return fail("expected " + typeNames(node.types));
+            return !node.hasEnum || checkEnum(node, Schema::NullType);
+        }
+    }
+
+private:
+    Schema *schema;
+    const char *input;
+    SchemaViolation *violation;
+    bool *violated;
+    uint32_t next; // the node for the value after a key, or for the root
+    std::string scratch;
+
+    // Sets `index` to the node the value starting now must match. Counts
+    // array elements, which can break maxItems.
+    bool nodeForValue(uint32_t &index)
+    {
+        if (schema->frames.empty() || !schema->frames.back().array)
+        {
+            index = next;
+            return true;
+        }
+        Schema::Frame &frame = schema->frames.back();
+        const Schema::Node &node = schema->nodes[frame.node];
+        if (++frame.count > node.maxItems)
+            return fail("expected at most " + std::to_string(node.maxItems) + " items", true);
+        index = node.items;
+        return true;
+    }
+
+    bool open(uint8_t type)
+    {
+        uint32_t index;
+        if (!nodeForValue(index))
+            return false;
+        const Schema::Node &node = schema->nodes[index];
+        if (!(node.types & type))
+            return fail("expected " + typeNames(node.types));
+        if (node.hasEnum)
+            return fail("expected one of the enum values");
+        schema->frames.push_back({index, type == Schema::ArrayType, 0, 0, 0, 0});
+        return true;
+    }
+
+    bool checkString(const Schema::Node &node, const Token &token)
+    {
+        const char *text = input + token.pos + 1;
+        std::size_t length = token.length - 2;
+        if (std::memchr(text, '\\', length))
+        {
+            scratch.resize(token.length);
+            scratch.resize(decodeStringInto(input, token, &scratch[0]));
+            text = scratch.data();
+            length = scratch.size();
+        }
+        if (node.minLength != 0 || node.maxLength != UINT32_MAX)
+        {
+            std::size_t count = codePoints(text, length);
+            if (count < node.minLength)
+                return fail("expected at least " + std::to_string(node.minLength) + " characters");
+            if (count > node.maxLength)
+                return fail("expected at most " + std::to_string(node.maxLength) + " characters");
+        }
+        return !node.hasEnum || checkEnum(node, Schema::StringType, false, 0, text, length);
+    }
+
+    bool checkNumber(const Schema::Node &node, const Token &token)
+    {
+        Number number = convertNumber(input + token.pos, token.length);
+        double value = number.toDouble();
+        if (!(node.types & Schema::NumberType) && number.kind == NumberKind::Double && value != std::floor(value))
+            return fail("expected " + typeNames(node.types));
+        if (value < node.minimum || (node.exclusiveMinimum && value == node.minimum))
+            return fail("below the minimum");
+        if (value > node.maximum || (node.exclusiveMaximum && value == node.maximum))
+            return fail("above the maximum");
+        return !node.hasEnum || checkEnum(node, Schema::NumberType, false, value);
+    }
+
+    bool checkEnum(const Schema::Node &node, uint8_t type, bool boolean = false, double number = 0,
+                   const char *text = nullptr, std::size_t length = 0)
+    {
+        const Schema::EnumValue *e = schema->enums.data() + node.firstEnum;
+        for (const Schema::EnumValue *end = e + node.enumCount; e != end; ++e)
+        {
+            if (e->type == type && e->boolean == boolean && e->number == number && e->string.size() == length &&
+                (length == 0 || std::memcmp(e->string.data(), text, length) == 0))
+                return true;
+        }
+        return fail("expected one of the enum values");
+    }
+
+    // Records the violation at the current value, or at the innermost
+    // container itself when `container` is set, and stops the parse
+    bool fail(const std::string &message, bool container = false)
+    {
+        *violated = true;
+        if (!violation)
+            return false;
+        violation->message = message;
+        violation->path.clear();
+        const std::vector<Schema::Frame> &frames = schema->frames;
+        std::size_t depth = container ? frames.size() - 1 : frames.size();
+        for (std::size_t i = 0; i < depth; ++i)
+        {
+            const Schema::Frame &frame = frames[i];
+            if (frame.array)
+            {
+                std::string index = std::to_string(frame.count - 1);
+                appendSegment(violation->path, index.data(), index.size());
+            }
+            else
+            {
+                appendSegment(violation->path, input + frame.key, frame.keyLength);
+            }
+        }
+        if (violation->path.empty())
+            violation->path = "/";
+        return false;
+    }
+
+    static std::string typeNames(uint8_t types)
+    {
+        static const char *const names[] = {"null", "boolean", "integer", "number", "string", "array", "object"};
+        std::string out;
+        for (int i = 0; i < 7; ++i)
+        {
+            if ((types >> i) & 1)
+                out += (out.empty() ? "" : " or ") + std::string(names[i]);
+        }
+        return out.empty() ? "nothing (false schema)" : out;
+    }
+};
+
+Schema::Schema(const std::string &schemaJson)
+{
+    Document document;
+    if (!document.parse(schemaJson))
+        throw std::invalid_argument("Invalid schema: not a JSON object");
+    nodes.push_back(Node()); // node 0: anything
+    root = compile(document.root(), "");
+}
+
+uint32_t Schema::compile(const Value &schema, const std::string &where)
+{
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node());
+    if (schema.isBool())
+    {
+        nodes[index].types = schema.asBool() ? AnyType : 0;
+        return index;
+    }
+    if (!schema.isObject())
+        throw badSchema(where, "a schema must be an object or a boolean");
+
+    // Subschemas are compiled after this node's own keywords, so the
+    // node's properties stay one contiguous run
+    Node node;
+    const Value *propertyMap = nullptr;
+    const Value *itemsSchema = nullptr;
+    const Value *requiredList = nullptr;
+    for (std::size_t i = 0; i < schema.size(); ++i)
+    {
+        const Member &m = schema.member(i);
+        std::string keyword = m.name();
+        const Value &v = m.value;
+        if (keyword == "type")
+        {
+            node.types = 0;
+            const Value *names = v.isArray() ? v.begin() : &v;
+            std::size_t count = v.isArray() ? v.size() : 1;
+            for (std::size_t t = 0; t < count; ++t)
+            {
+                std::string name = names[t].isString() ? names[t].str() : "";
+                uint8_t bit = name == "null"      ? NullType
+                              : name == "boolean" ? BooleanType
+                              : name == "integer" ? IntegerType
+                              : name == "number"  ? NumberType
+                              : name == "string"  ? StringType
+                              : name == "array"   ? ArrayType
+                              : name == "object"  ? ObjectType
+                                                  : 0;
+                if (bit == 0)
+                    throw badSchema(where, "unknown type");
+                node.types |= bit;
+            }
+        }
+        else if (keyword == "enum")
+        {
+            if (!v.isArray())
+                throw badSchema(where, "enum must be an array");
+            node.hasEnum = true;
+            node.firstEnum = static_cast<uint32_t>(enums.size());
+            node.enumCount = static_cast<uint32_t>(v.size());
+            for (const Value &e : v)
+            {
+                EnumValue value{0, false, 0, std::string()};
+                if (e.isNull())
+                    value.type = NullType;
+                else if (e.isBool())
+                    value.type = BooleanType, value.boolean = e.asBool();
+                else if (e.isNumber())
+                    value.type = NumberType, value.number = e.asNumber();
+                else if (e.isString())
+                    value.type = StringType, value.string = e.str();
+                else
+                    throw badSchema(where, "enum values must be scalars");
+                enums.push_back(value);
+            }
+        }
+        else if (keyword == "properties")
+        {
+            if (!v.isObject())
+                throw badSchema(where, "properties must be an object");
+            propertyMap = &v;
+        }
+        else if (keyword == "required")
+        {
+            if (!v.isArray())
+                throw badSchema(where, "required must be an array");
+            requiredList = &v;
+        }
+        else if (keyword == "items")
+            itemsSchema = &v;
+        // The tighter bound wins whatever the keyword order; at a tie the
+        // exclusive one is tighter
+        else if (keyword == "minimum")
+        {
+            double bound = boundOf(v, "minimum", where);
+            if (bound > node.minimum)
+                node.minimum = bound, node.exclusiveMinimum = false;
+        }
+        else if (keyword == "maximum")
+        {
+            double bound = boundOf(v, "maximum", where);
+            if (bound < node.maximum)
+                node.maximum = bound, node.exclusiveMaximum = false;
+        }
+        else if (keyword == "exclusiveMinimum")
+        {
+            double bound = boundOf(v, "exclusiveMinimum", where);
+            if (bound >= node.minimum)
+                node.minimum = bound, node.exclusiveMinimum = true;
+        }
+        else if (keyword == "exclusiveMaximum")
+        {
+            double bound = boundOf(v, "exclusiveMaximum", where);
+            if (bound <= node.maximum)
+                node.maximum = bound, node.exclusiveMaximum = true;
+        }
+        else if (keyword == "minLength")
+            node.minLength = countOf(v, "minLength", where);
+        else if (keyword == "maxLength")
+            node.maxLength = countOf(v, "maxLength", where);
+        else if (keyword == "minItems")
+            node.minItems = countOf(v, "minItems", where);
+        else if (keyword == "maxItems")
+            node.maxItems = countOf(v, "maxItems", where);
+        else if (keyword != "$schema" && keyword != "$id" && keyword != "$comment" && keyword != "title" &&
+                 keyword != "description" && keyword != "default" && keyword != "examples")
+            throw badSchema(where, "unsupported keyword \"" + keyword + "\"");
+    }
+
+    // Listed properties first, then required ones the schema doesn't
+    // describe, which match anything
+    node.firstProperty = static_cast<uint32_t>(properties.size());
+    std::vector<uint32_t> pending; // members of propertyMap, by property
+    if (propertyMap)
+    {
+        for (std::size_t i = 0; i < propertyMap->size(); ++i)
+        {
+            properties.push_back({propertyMap->member(i).name(), 0, 0});
+            pending.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    if (requiredList)
+    {
+        for (const Value &name : *requiredList)
+        {
+            if (!name.isString())
+                throw badSchema(where, "required must list strings");
+            std::size_t p = node.firstProperty;
+            while (p < properties.size() && properties[p].name != name.str())
+                ++p;
+            if (p == properties.size())
+                properties.push_back({name.str(), 0, 0});
+            if (p - node.firstProperty >= 64)
+                throw badSchema(where, "at most 64 properties can be required");
+            properties[p].bit = uint64_t(1) << (p - node.firstProperty);
+            node.required |= properties[p].bit;
+        }
+    }
+    node.propertyCount = static_cast<uint32_t>(properties.size() - node.firstProperty);
+    node.checkNumber = node.minimum > -HUGE_VAL || node.maximum < HUGE_VAL || node.hasEnum ||
+                       ((node.types & IntegerType) && !(node.types & NumberType));
+    node.checkString = node.minLength != 0 || node.maxLength != UINT32_MAX || node.hasEnum;
+    if (node.types == AnyType && !node.checkNumber && !node.checkString && node.propertyCount == 0 &&
+        node.minItems == 0 && node.maxItems == UINT32_MAX && !itemsSchema)
+    {
+        // Checks nothing: drop it and use node 0, which the checker skips
+        nodes.pop_back();
+        return 0;
+    }
+    nodes[index] = node;
+
+    for (std::size_t i = 0; i < pending.size(); ++i)
+    {
+        const Member &m = propertyMap->member(pending[i]);
+        uint32_t child = compile(m.value, where + "/properties/" + m.name());
+        properties[node.firstProperty + i].node = child;
+    }
+    if (itemsSchema)
+    {
+        uint32_t child = compile(*itemsSchema, where + "/items");
+        nodes[index].items = child;
+    }
+    return index;
+}
+
+SchemaResult Schema::validate(const char *data, std::size_t size, SchemaViolation *violation, std::size_t maxDepth)
+{
+    frames.clear();
+    bool violated = false;
+    SchemaChecker checker(*this, data, violation, violated);
+    bool ok;
+    if (index.build(data, size))
+        ok = BasicParser<IndexedLexer, SchemaChecker>(IndexedLexer(data, size, index), checker, maxDepth).parse();
+    else
+        ok = BasicParser<Lexer, SchemaChecker>(Lexer(data, size), checker, maxDepth).parse();
+    return ok ? SchemaResult::Valid : violated ? SchemaResult::Violation : SchemaResult::InvalidJson;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "depth_stack.h"
+#include "structural.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+struct Value;
+
+enum class SchemaResult
+{
+    Valid,
+    InvalidJson, // a syntax error, reported as Parser would
+    Violation    // well-formed so far, but the first violation stopped the parse
+};
+
+// Where and why a document broke its schema
+struct SchemaViolation
+{
+    std::string path;    // JSON Pointer to the value, e.g. /items/3/id
+    std::string message; // e.g. "expected integer"
+};
+
+// A JSON Schema subset compiled once into a flat program and checked in
+// the same pass as the parser's token walk, without building a tree.
+// Supported keywords:
+//   type (a name or an array of names), enum (scalar values),
+//   properties, required (at most 64 names per object), items (one schema
+//   for every element), minimum, maximum, exclusiveMinimum,
+//   exclusiveMaximum, minLength, maxLength (in code points), minItems,
+//   maxItems
+// plus true/false schemas and the annotations $schema, $id, $comment,
+// title, description, default and examples. Properties a schema doesn't
+// list are allowed and unchecked.
+class Schema
+{
+public:
+    // Throws std::invalid_argument for malformed schemas and for keywords
+    // outside the subset, so nothing is silently unchecked
+    explicit Schema(const std::string &schemaJson);
+
+    // Checks syntax and schema in one pass and stops at the first problem.
+    // The compiled program, index and scratch stack are reused across
+    // documents.
+    SchemaResult validate(const char *data, std::size_t size, SchemaViolation *violation = nullptr,
+                          std::size_t maxDepth = DEFAULT_MAX_DEPTH);
+
+private:
+    friend class SchemaChecker;
+
+    // Type bits; a "number" type also admits integers
+    enum : uint8_t
+    {
+        NullType = 1,
+        BooleanType = 2,
+        IntegerType = 4,
+        NumberType = 8,
+        StringType = 16,
+        ArrayType = 32,
+        ObjectType = 64,
+        AnyType = 127
+    };
+
+    // One compiled schema. Nodes refer to each other by index; node 0
+    // accepts anything and stands in for absent subschemas.
+    struct Node
+    {
+        uint8_t types = AnyType;
+        bool checkNumber = false; // bounds, enum or integer-only
+        bool checkString = false; // length or enum
+        bool exclusiveMinimum = false;
+        bool exclusiveMaximum = false;
+        double minimum = -std::numeric_limits<double>::infinity();
+        double maximum = std::numeric_limits<double>::infinity();
+        uint32_t minLength = 0;
+        uint32_t maxLength = UINT32_MAX;
+        uint32_t minItems = 0;
+        uint32_t maxItems = UINT32_MAX;
+        uint32_t items = 0;
+        uint32_t firstProperty = 0;
+        uint32_t propertyCount = 0;
+        uint64_t required = 0; // bits of the properties that must appear
+        bool hasEnum = false; // also set by an empty enum, which matches nothing
+        uint32_t firstEnum = 0;
+        uint32_t enumCount = 0;
+    };
+
+    struct Property
+    {
+        std::string name;
+        uint32_t node;
+        uint64_t bit; // set in Node::required if required, else 0
+    };
+
+    struct EnumValue
+    {
+        uint8_t type; // one of the type bits; IntegerType is not used
+        bool boolean;
+        double number;
+        std::string string; // decoded
+    };
+
+    // An open container during validation
+    struct Frame
+    {
+        uint32_t node;
+        bool array;
+        uint32_t count;  // members or elements so far
+        uint64_t seen;   // required properties met so far
+        std::size_t key; // the current member's key body, for paths
+        std::size_t keyLength;
+    };
+
+    uint32_t compile(const Value &schema, const std::string &where);
+
+    uint32_t root;
+    std::vector<Node> nodes;
+    std::vector<Property> properties;
+    std::vector<EnumValue> enums;
+    StructuralIndex index;
+    std::vector<Frame> frames;
+};
@@ -0,0 +1,3 @@
+#include "stream_parser_impl.h"
+
+template class StreamParser<NullStreamHandler>;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "depth_stack.h"
+#include "token.h"
+#include <cstddef>
+#include <string>
+
+// Receives a streamed document's structure, like the handlers of
+// BasicParser. There is no whole input to point into, so keys and scalar
+// values arrive as their raw text: a STRING keeps its quotes and escapes
+// (decodeStringInto(text, Token(TokenType::STRING, 0, length), dest)
+// resolves them). The text is only valid during the call. Returning false
+// rejects the document.
+struct NullStreamHandler
+{
+    bool startObject() { return true; }
+    bool key(const char *, std::size_t) { return true; }
+    bool endObject() { return true; }
+    bool startArray() { return true; }
+    bool endArray() { return true; }
+    bool value(TokenType, const char *, std::size_t) { return true; }
+};
+
+// Push parser: validates the same grammar as Parser over input that
+// arrives in chunks of any size, so a document never has to fit in
+// memory. A token cut by a chunk boundary (mid-string, mid-number) is
+// carried over in a buffer; otherwise the handler sees spans of the
+// chunk itself. Memory is the container stack, one bit per level up to
+// maxDepth, plus the longest token that straddles a boundary.
+template <typename Handler = NullStreamHandler>
+class StreamParser
+{
+public:
+    explicit StreamParser(Handler h = Handler(), std::size_t maxDepth = DEFAULT_MAX_DEPTH);
+
+    // Consumes the next chunk. Returns false once the document is known to
+    // be invalid; later calls keep returning false.
+    bool feed(const char *data, std::size_t size);
+    bool feed(const std::string &chunk) { return feed(chunk.data(), chunk.size()); }
+
+    // Ends the input. True if exactly one complete document was fed.
+    bool finish();
+
+    // Bytes consumed so far, and the open containers
+    unsigned long long offset() const { return consumed; }
+    std::size_t depth() const { return stack.depth(); }
+
+private:
+    // The next token the grammar allows
+    enum class Expect
+    {
+        Start,      // the top-level '{'
+        KeyOrEnd,   // after '{'
+        Key,        // after ',' in an object
+        Colon,
+        ValueOrEnd, // after '['
+        Value,      // after ':' or ',' in an array
+        CommaOrEnd,
+        Done,
+        Failed
+    };
+
+    // The token being scanned, if it isn't finished yet
+    enum class Scan
+    {
+        None,
+        String,
+        Number,
+        Keyword
+    };
+
+    Handler handler;
+    Expect expect = Expect::Start;
+    Scan scan = Scan::None;
+    bool escaped = false;       // the string scanned so far ends in a backslash
+    std::string pending;        // start of a token cut by the chunk boundary
+    DepthStack stack;
+    unsigned long long consumed = 0;
+
+    bool token(TokenType type, const char *text, std::size_t length);
+    bool value(TokenType type, const char *text, std::size_t length);
+    bool close(bool object);
+    bool scalar(const char *text, std::size_t length);
+    bool fail();
+};
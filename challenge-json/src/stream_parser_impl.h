@@ -0,0 +1,290 @@
+#pragma once
+
+// Member definitions of StreamParser. Included by the translation units
+// that instantiate one: stream_parser.cpp for plain validation, and the
+// file defining each handler for the others.
+
+#include "json_string.h"
+#include "lexer.h"
+#include "stream_parser.h"
+#include <cctype>
+#include <cstring>
+
+template <typename Handler>
+StreamParser<Handler>::StreamParser(Handler h, std::size_t maxDepth) : handler(h), stack(maxDepth)
+{
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::feed(const char *data, std::size_t size)
+{
+    if (expect == Expect::Failed)
+        return false;
+    consumed += size;
+
+    std::size_t i = 0;
+    while (i < size)
+    {
+        std::size_t start = i;
+        if (scan == Scan::None)
+        {
+            char c = data[i];
+            if (isJsonSpace(c))
+            {
+                ++i;
+                continue;
+            }
+            // Nothing but whitespace may follow the document
+            if (expect == Expect::Done)
+                return fail();
+
+            TokenType punctuation = TokenType::INVALID;
+            switch (c)
+            {
+            case '{':
+                punctuation = TokenType::LBRACE;
+                break;
+            case '}':
+                punctuation = TokenType::RBRACE;
+                break;
+            case '[':
+                punctuation = TokenType::LBRACKET;
+                break;
+            case ']':
+                punctuation = TokenType::RBRACKET;
+                break;
+            case ':':
+                punctuation = TokenType::COLON;
+                break;
+            case ',':
+                punctuation = TokenType::COMMA;
+                break;
+            case '"':
+                scan = Scan::String;
+                escaped = false;
+                ++i; // the opening quote
+                break;
+            default:
+                if (std::isalpha(static_cast<unsigned char>(c)))
+                    scan = Scan::Keyword;
+                else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-')
+                    scan = Scan::Number;
+                else
+                    return fail();
+            }
+            if (punctuation != TokenType::INVALID)
+            {
+                if (!token(punctuation, data + i, 1))
+                    return false;
+                ++i;
+                continue;
+            }
+        }
+
+        // Scan to the end of the current token, which may have started in
+        // an earlier chunk
+        bool complete = false;
+        if (scan == Scan::String)
+        {
+            for (; i < size; ++i)
+            {
+                if (escaped)
+                    escaped = false;
+                else if (data[i] == '\\')
+                    escaped = true;
+                else if (data[i] == '"')
+                {
+                    ++i;
+                    complete = true;
+                    break;
+                }
+            }
+        }
+        else if (scan == Scan::Number)
+        {
+            // Everything a number may contain; scalar() checks the order
+            while (i < size && (std::isdigit(static_cast<unsigned char>(data[i])) || data[i] == '-' ||
+                                data[i] == '+' || data[i] == '.' || data[i] == 'e' || data[i] == 'E'))
+                ++i;
+            complete = i < size;
+        }
+        else
+        {
+            while (i < size && std::isalpha(static_cast<unsigned char>(data[i])))
+                ++i;
+            complete = i < size;
+        }
+
+        if (!complete)
+        {
+            pending.append(data + start, size - start);
+            return true;
+        }
+        bool ok;
+        if (pending.empty())
+        {
+            ok = scalar(data + start, i - start);
+        }
+        else
+        {
+            pending.append(data + start, i - start);
+            ok = scalar(pending.data(), pending.size());
+            pending.clear();
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::finish()
+{
+    if (expect == Expect::Failed)
+        return false;
+    // A number or keyword can end with the input; a string can't
+    if (scan == Scan::String)
+        return fail();
+    if (scan != Scan::None)
+    {
+        bool ok = scalar(pending.data(), pending.size());
+        pending.clear();
+        if (!ok)
+            return false;
+    }
+    return expect == Expect::Done;
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::scalar(const char *text, std::size_t length)
+{
+    Scan scanned = scan;
+    scan = Scan::None;
+    if (scanned == Scan::String)
+    {
+        if (scanStringBody(text + 1, text + length) != text + length - 1)
+            return fail();
+        return token(TokenType::STRING, text, length);
+    }
+    if (scanned == Scan::Number)
+    {
+        // Whatever Lexer would make of the run, the document is invalid
+        // unless the run is exactly one number
+        std::size_t end = 0;
+        if (scanNumber(text, length, end).type == TokenType::INVALID || end != length)
+            return fail();
+        return token(TokenType::NUMBER, text, length);
+    }
+
+    if (length == 4 && std::memcmp(text, "true", 4) == 0)
+        return token(TokenType::TRUE, text, length);
+    if (length == 5 && std::memcmp(text, "false", 5) == 0)
+        return token(TokenType::FALSE, text, length);
+    if (length == 4 && std::memcmp(text, "null", 4) == 0)
+        return token(TokenType::NULL_TOKEN, text, length);
+    return fail();
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::token(TokenType type, const char *text, std::size_t length)
+{
+    switch (expect)
+    {
+    case Expect::Start:
+        // The top level must be an object
+        if (type != TokenType::LBRACE)
+            return fail();
+        return value(type, text, length);
+
+    case Expect::KeyOrEnd:
+        if (type == TokenType::RBRACE)
+            return close(true);
+        // fall through
+    case Expect::Key:
+        if (type != TokenType::STRING || !handler.key(text, length))
+            return fail();
+        expect = Expect::Colon;
+        return true;
+
+    case Expect::Colon:
+        if (type != TokenType::COLON)
+            return fail();
+        expect = Expect::Value;
+        return true;
+
+    case Expect::ValueOrEnd:
+        if (type == TokenType::RBRACKET)
+            return close(false);
+        // fall through
+    case Expect::Value:
+        return value(type, text, length);
+
+    case Expect::CommaOrEnd:
+        if (type == TokenType::COMMA)
+        {
+            expect = stack.topIsObject() ? Expect::Key : Expect::Value;
+            return true;
+        }
+        if (type == TokenType::RBRACE)
+            return close(true);
+        if (type == TokenType::RBRACKET)
+            return close(false);
+        return fail();
+
+    default:
+        return fail();
+    }
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::value(TokenType type, const char *text, std::size_t length)
+{
+    switch (type)
+    {
+    case TokenType::STRING:
+    case TokenType::NUMBER:
+    case TokenType::TRUE:
+    case TokenType::FALSE:
+    case TokenType::NULL_TOKEN:
+        if (!handler.value(type, text, length))
+            return fail();
+        expect = Expect::CommaOrEnd;
+        return true;
+
+    case TokenType::LBRACE:
+        if (!stack.push(true) || !handler.startObject())
+            return fail();
+        expect = Expect::KeyOrEnd;
+        return true;
+
+    case TokenType::LBRACKET:
+        if (!stack.push(false) || !handler.startArray())
+            return fail();
+        expect = Expect::ValueOrEnd;
+        return true;
+
+    default:
+        return fail();
+    }
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::close(bool object)
+{
+    if (stack.empty() || stack.topIsObject() != object)
+        return fail();
+    stack.pop();
+    if (!(object ? handler.endObject() : handler.endArray()))
+        return fail();
+    expect = stack.empty() ? Expect::Done : Expect::CommaOrEnd;
+    return true;
+}
+
+template <typename Handler>
+bool StreamParser<Handler>::fail()
+{
+    expect = Expect::Failed;
+    scan = Scan::None;
+    pending.clear();
+    return false;
+}
@@ -0,0 +1,371 @@
+#include "structural.h"
+#include "json_string.h"
+#include "lexer.h"
+#include "parser_impl.h"
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JP_X86 1
+#endif
+
+namespace
+{
+    // Bit i of each mask describes byte i of a 64-byte block
+    struct BlockMasks
+    {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op; // { } [ ] : ,
+        uint64_t space;
+    };
+
+    using ClassifyFn = void (*)(const char *block, BlockMasks &masks);
+
+    enum ByteClass : uint8_t
+    {
+        QUOTE = 1,
+        BACKSLASH = 2,
+        OP = 4,
+        SPACE = 8
+    };
+
+    struct ClassTable
+    {
+        uint8_t classes[256];
+        ClassTable() : classes()
+        {
+            classes[static_cast<unsigned char>('"')] = QUOTE;
+            classes[static_cast<unsigned char>('\\')] = BACKSLASH;
+            for (char c : {'{', '}', '[', ']', ':', ','})
+                classes[static_cast<unsigned char>(c)] = OP;
+            for (char c : {' ', '\t', '\n', '\r'})
+                classes[static_cast<unsigned char>(c)] = SPACE;
+        }
+    };
+
+    const ClassTable CLASS_TABLE;
+
+    void classifyScalar(const char *block, BlockMasks &masks)
+    {
+        masks = BlockMasks();
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            uint8_t c = CLASS_TABLE.classes[static_cast<unsigned char>(block[i])];
+            uint64_t bit = uint64_t(1) << i;
+            masks.quote |= (c & QUOTE) ? bit : 0;
+            masks.backslash |= (c & BACKSLASH) ? bit : 0;
+            masks.op |= (c & OP) ? bit : 0;
+            masks.space |= (c & SPACE) ? bit : 0;
+        }
+    }
+
+#ifdef JP_X86
+    // Braces and brackets differ from each other only in bit 5:
+    // '[' | 0x20 == '{' and ']' | 0x20 == '}', so two compares find all four
+    void classifySse2(const char *block, BlockMasks &masks)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i bit5 = _mm_set1_epi8(0x20);
+        const __m128i openBrace = _mm_set1_epi8('{');
+        const __m128i closeBrace = _mm_set1_epi8('}');
+        const __m128i colon = _mm_set1_epi8(':');
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i cr = _mm_set1_epi8('\r');
+
+        masks = BlockMasks();
+        for (unsigned i = 0; i < 4; ++i)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+            __m128i folded = _mm_or_si128(v, bit5);
+            __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+            __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                      _mm_or_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(v, cr)));
+            unsigned shift = 16 * i;
+            masks.quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+            masks.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+            masks.op |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(op))) << shift;
+            masks.space |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(ws))) << shift;
+        }
+    }
+
+    __attribute__((target("avx2"))) void classifyAvx2(const char *block, BlockMasks &masks)
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i bit5 = _mm256_set1_epi8(0x20);
+        const __m256i openBrace = _mm256_set1_epi8('{');
+        const __m256i closeBrace = _mm256_set1_epi8('}');
+        const __m256i colon = _mm256_set1_epi8(':');
+        const __m256i comma = _mm256_set1_epi8(',');
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i newline = _mm256_set1_epi8('\n');
+        const __m256i cr = _mm256_set1_epi8('\r');
+
+        masks = BlockMasks();
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32 * i));
+            __m256i folded = _mm256_or_si256(v, bit5);
+            __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)),
+                                         _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+            __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                         _mm256_or_si256(_mm256_cmpeq_epi8(v, newline), _mm256_cmpeq_epi8(v, cr)));
+            unsigned shift = 32 * i;
+            masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << shift;
+            masks.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << shift;
+            masks.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+            masks.space |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << shift;
+        }
+    }
+#endif
+
+    ClassifyFn classifier(Stage1Kernel kernel)
+    {
+        switch (kernel)
+        {
+#ifdef JP_X86
+        case Stage1Kernel::Avx2:
+            return classifyAvx2;
+        case Stage1Kernel::Sse2:
+            return classifySse2;
+#endif
+        default:
+            return classifyScalar;
+        }
+    }
+
+    // Bytes escaped by a backslash. Escapes are rare, so this walks the
+    // backslashes one by one; `carry` is set when the block ends in an
+    // unfinished escape.
+    uint64_t escapedBytes(uint64_t backslash, uint64_t &carry)
+    {
+        uint64_t escaped = carry;
+        uint64_t pending = backslash & ~carry;
+        carry = 0;
+        while (pending)
+        {
+            unsigned at = static_cast<unsigned>(__builtin_ctzll(pending));
+            if (at == 63)
+            {
+                carry = 1;
+                break;
+            }
+            escaped |= uint64_t(2) << at;
+            // The escaped byte can't start another escape
+            pending &= ~((uint64_t(4) << at) - 1);
+        }
+        return escaped;
+    }
+
+    // Bit i of the result is the XOR of bits 0..i: inside-string masks
+    // from quote positions
+    uint64_t prefixXor(uint64_t bits)
+    {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+}
+
+Stage1Kernel StructuralIndex::bestKernel()
+{
+    static const Stage1Kernel best = supported(Stage1Kernel::Avx2)   ? Stage1Kernel::Avx2
+                                     : supported(Stage1Kernel::Sse2) ? Stage1Kernel::Sse2
+                                                                     : Stage1Kernel::Scalar;
+    return best;
+}
+
+bool StructuralIndex::supported(Stage1Kernel kernel)
+{
+    switch (kernel)
+    {
+#ifdef JP_X86
+    case Stage1Kernel::Avx2:
+        return __builtin_cpu_supports("avx2");
+    case Stage1Kernel::Sse2:
+        return __builtin_cpu_supports("sse2");
+#endif
+    case Stage1Kernel::Auto:
+    case Stage1Kernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const char *StructuralIndex::kernelName(Stage1Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Stage1Kernel::Auto:
+        return kernelName(bestKernel());
+    case Stage1Kernel::Scalar:
+        return "scalar";
+    case Stage1Kernel::Sse2:
+        return "sse2";
+    case Stage1Kernel::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+bool StructuralIndex::build(const char *data, std::size_t size, Stage1Kernel kernel, std::size_t padding)
+{
+    if (size >= std::numeric_limits<uint32_t>::max())
+        return false;
+    if (kernel == Stage1Kernel::Auto || !supported(kernel))
+        kernel = bestKernel();
+    ClassifyFn classify = classifier(kernel);
+
+    // At most one entry per byte; grown, never shrunk, and not zeroed
+    if (capacity < size + 1)
+    {
+        entries.reset(new uint32_t[size + 1]);
+        capacity = size + 1;
+    }
+    uint32_t *out = entries.get();
+
+    uint64_t escapeCarry = 0;
+    uint64_t inStringCarry = 0; // all ones while a string is open
+    uint64_t scalarCarry = 0;   // the previous block ended inside a number or keyword
+    BlockMasks masks;
+    for (std::size_t base = 0; base < size; base += 64)
+    {
+        uint64_t valid = ~uint64_t(0);
+        if (size - base >= 64)
+        {
+            classify(data + base, masks);
+        }
+        else if (padding >= 63)
+        {
+            // Whatever the bytes past the end are, their bits are dropped;
+            // quotes and backslashes only affect later bytes
+            classify(data + base, masks);
+            valid = (uint64_t(1) << (size - base)) - 1;
+        }
+        else
+        {
+            // Pad the last block with spaces, which start no token
+            char last[64];
+            std::memset(last, ' ', sizeof(last));
+            std::memcpy(last, data + base, size - base);
+            classify(last, masks);
+        }
+
+        uint64_t quotes = masks.quote & ~escapedBytes(masks.backslash, escapeCarry);
+        // Set from an opening quote up to, not including, its closing quote
+        uint64_t inString = prefixXor(quotes) ^ inStringCarry;
+        inStringCarry = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+
+        // Numbers, keywords and stray bytes: runs of anything else outside
+        // strings; only the first byte of a run is indexed
+        uint64_t scalar = ~(masks.op | masks.space | quotes) & ~inString;
+        uint64_t scalarStarts = scalar & ~((scalar << 1) | scalarCarry);
+        scalarCarry = scalar >> 63;
+
+        uint64_t structurals = ((masks.op & ~inString) | quotes | scalarStarts) & valid;
+        while (structurals)
+        {
+            *out++ = static_cast<uint32_t>(base + __builtin_ctzll(structurals));
+            structurals &= structurals - 1;
+        }
+    }
+    count = static_cast<std::size_t>(out - entries.get());
+    return true;
+}
+
+IndexedLexer::IndexedLexer(const char *data, std::size_t size, const StructuralIndex &index)
+    : s(data), n(size), entry(index.positions()), last(index.positions() + index.size())
+{
+}
+
+Token IndexedLexer::scalarAt(std::size_t at)
+{
+    // Same scanners as Lexer; if the run continues past what they accept,
+    // Lexer would lex the rest as the next token, so remember where it is
+    char c = s[at];
+    Token token(TokenType::INVALID, at, 0, c);
+    std::size_t end = at + 1;
+    if (std::isalpha(static_cast<unsigned char>(c)))
+    {
+        end = at;
+        token = scanKeyword(s, n, end);
+    }
+    else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-')
+    {
+        end = at;
+        token = scanNumber(s, n, end);
+    }
+
+    if (end < n && !isJsonSpace(s[end]) && s[end] != '"' &&
+        !(CLASS_TABLE.classes[static_cast<unsigned char>(s[end])] & OP))
+        tail = end;
+    return token;
+}
+
+Token IndexedLexer::next()
+{
+    if (tail != 0)
+    {
+        std::size_t at = tail;
+        tail = 0;
+        return scalarAt(at);
+    }
+    if (entry == last)
+        return {TokenType::EOF_TOKEN, n};
+
+    std::size_t at = *entry++;
+    switch (s[at])
+    {
+    case '{':
+        return {TokenType::LBRACE, at, 1};
+    case '}':
+        return {TokenType::RBRACE, at, 1};
+    case '[':
+        return {TokenType::LBRACKET, at, 1};
+    case ']':
+        return {TokenType::RBRACKET, at, 1};
+    case ':':
+        return {TokenType::COLON, at, 1};
+    case ',':
+        return {TokenType::COMMA, at, 1};
+    case '"':
+    {
+        // The next entry is the closing quote; everything between is masked.
+        // The body still needs checking, which finds the same quote.
+        if (entry == last || scanStringBody(s + at + 1, s + n) != s + *entry)
+            return {TokenType::INVALID, at, 0, '"'};
+        std::size_t close = *entry++;
+        return {TokenType::STRING, at, close - at + 1};
+    }
+    default:
+        return scalarAt(at);
+    }
+}
+
+std::string IndexedLexer::text(const Token &token) const
+{
+    return std::string(s + token.pos, token.length);
+}
+
+std::string IndexedLexer::decodeString(const Token &token) const
+{
+    std::string value(token.length, '\0');
+    value.resize(decodeStringInto(s, token, &value[0]));
+    return value;
+}
+
+template class BasicParser<IndexedLexer>;
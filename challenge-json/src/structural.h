@@ -0,0 +1,70 @@
+#pragma once
+
+#include "token.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Two-stage lexing. Stage 1 (StructuralIndex::build) classifies the input
+// 64 bytes at a time with SIMD compares and records the offset of every
+// structural character outside strings, every unescaped quote and the
+// first byte of every number or keyword. Stage 2 (IndexedLexer) turns that
+// index into the same tokens Lexer produces, jumping from entry to entry
+// instead of looking at every byte.
+
+// Stage 1 implementations. Auto picks the best one the CPU supports.
+enum class Stage1Kernel
+{
+    Auto,
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+class StructuralIndex
+{
+public:
+    // Builds the index of data[0, size). Returns false for inputs of 4 GiB
+    // or more, whose offsets don't fit the index; use Lexer for those.
+    // Reusing one index across documents reuses its memory. If at least 63
+    // bytes past the end are readable (`padding`; their values don't
+    // matter), the last block is classified in place instead of copied.
+    bool build(const char *data, std::size_t size, Stage1Kernel kernel = Stage1Kernel::Auto,
+               std::size_t padding = 0);
+
+    const uint32_t *positions() const { return entries.get(); }
+    std::size_t size() const { return count; }
+
+    // The kernel Auto resolves to on this machine, and display names
+    static Stage1Kernel bestKernel();
+    static bool supported(Stage1Kernel kernel);
+    static const char *kernelName(Stage1Kernel kernel);
+
+private:
+    std::unique_ptr<uint32_t[]> entries;
+    std::size_t count = 0;
+    std::size_t capacity = 0;
+};
+
+// Stage 2: a lexer over a built index. Produces exactly the tokens Lexer
+// produces for the same input. The input and the index must outlive it.
+class IndexedLexer
+{
+private:
+    const char *s;
+    std::size_t n;
+    const uint32_t *entry;
+    const uint32_t *last;
+    std::size_t tail = 0; // rest of a scalar run the index doesn't list
+
+    Token scalarAt(std::size_t at);
+
+public:
+    IndexedLexer(const char *data, std::size_t size, const StructuralIndex &index);
+    Token next();
+
+    const char *data() const { return s; }
+    std::string text(const Token &token) const;
+    std::string decodeString(const Token &token) const;
+};
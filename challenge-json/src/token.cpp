@@ -1,4 +1,5 @@
 #include "token.h"
+#include "json_string.h"
 
 const char* tokenName(TokenType t)
 {
@@ -34,3 +35,11 @@ const char* tokenName(TokenType t)
         return "UNKNOWN";
     }
 }
+
+std::size_t decodeStringInto(const char *input, const Token &token, char *dest)
+{
+    if (token.type != TokenType::STRING)
+        return 0;
+
+    return unescapeString(input + token.pos + 1, input + token.pos + token.length - 1, dest);
+}
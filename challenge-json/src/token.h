@@ -20,15 +20,23 @@ enum class TokenType
     INVALID
 };
 
+// A token is a span of the input: [pos, pos + length). Tokens own no
+// memory, so producing and copying them never allocates; the lexer turns a
+// span back into text on request (Lexer::text, Lexer::decodeString).
 struct Token
 {
     TokenType type;
     std::size_t pos;
-    std::string value; // Store the actual token value
+    std::size_t length; // STRING spans include both quotes
     char badChar; // only meaningful for INVALID
     
-    Token(TokenType t, std::size_t p, const std::string& val = "", char bc = '\0')
-        : type(t), pos(p), value(val), badChar(bc) {}
+    Token(TokenType t, std::size_t p, std::size_t len = 0, char bc = '\0')
+        : type(t), pos(p), length(len), badChar(bc) {}
 };
 
 const char* tokenName(TokenType t);
+
+// Writes the contents of a STRING token of `input` to dest with escapes
+// resolved (\u escapes as UTF-8) and returns their length. dest must hold
+// token.length bytes.
+std::size_t decodeStringInto(const char *input, const Token &token, char *dest);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "token.h"
+#include <cstddef>
+
+// Trace policies for BasicLexer. The policy is a template parameter, so a
+// lexer built with NoTrace has no trace code in it at all, not even a
+// branch on a flag.
+struct NoTrace
+{
+    static void token(TokenType, std::size_t) {}
+};
+
+// Prints a "[LEX] <token> at pos <n>" line to std::cout for every token.
+struct StdoutTrace
+{
+    static void token(TokenType type, std::size_t pos);
+};
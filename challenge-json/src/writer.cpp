@@ -0,0 +1,386 @@
+#include "writer.h"
+#include "lexer.h"
+#include "parser_impl.h"
+#include "structural.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+    // What follows the backslash for each byte that needs escaping: 0 for
+    // bytes copied as is, 'u' for control bytes without a short form
+    struct EscapeTable
+    {
+        char next[256];
+
+        EscapeTable()
+        {
+            std::fill(next, next + 256, '\0');
+            std::fill(next, next + 0x20, 'u');
+            set('\b', 'b');
+            set('\f', 'f');
+            set('\n', 'n');
+            set('\r', 'r');
+            set('\t', 't');
+            set('"', '"');
+            set('\\', '\\');
+        }
+
+        void set(char c, char escape) { next[static_cast<unsigned char>(c)] = escape; }
+    };
+    const EscapeTable escapes;
+
+    const char digitPairs[] = "00010203040506070809"
+                              "10111213141516171819"
+                              "20212223242526272829"
+                              "30313233343536373839"
+                              "40414243444546474849"
+                              "50515253545556575859"
+                              "60616263646566676869"
+                              "70717273747576777879"
+                              "80818283848586878889"
+                              "90919293949596979899";
+
+    // Writes value's digits so they end just before `end`, two at a time,
+    // and returns where they start
+    char *formatDigits(uint64_t value, char *end)
+    {
+        while (value >= 100)
+        {
+            end -= 2;
+            std::memcpy(end, digitPairs + 2 * (value % 100), 2);
+            value /= 100;
+        }
+        if (value >= 10)
+        {
+            end -= 2;
+            std::memcpy(end, digitPairs + 2 * value, 2);
+        }
+        else
+        {
+            *--end = static_cast<char>('0' + value);
+        }
+        return end;
+    }
+
+    // Writes the document the parser reports, copying every scalar and
+    // key from the input: they are already valid JSON text
+    class RewriteHandler
+    {
+    public:
+        RewriteHandler(JsonWriter &writer, const char *input) : writer(&writer), input(input) {}
+
+        bool startObject()
+        {
+            writer->startObject();
+            return true;
+        }
+        bool key(const Token &token)
+        {
+            writer->rawKey(input + token.pos, token.length);
+            return true;
+        }
+        bool endObject()
+        {
+            writer->endObject();
+            return true;
+        }
+        bool startArray()
+        {
+            writer->startArray();
+            return true;
+        }
+        bool endArray()
+        {
+            writer->endArray();
+            return true;
+        }
+        bool value(const Token &token)
+        {
+            writer->rawValue(input + token.pos, token.length);
+            return true;
+        }
+
+    private:
+        JsonWriter *writer;
+        const char *input;
+    };
+}
+
+OutputBuffer::OutputBuffer(std::size_t initialCapacity)
+    : bytes(new char[initialCapacity]), capacity(initialCapacity)
+{
+}
+
+void OutputBuffer::grow(std::size_t n)
+{
+    // Doubling keeps appends amortized O(1)
+    std::size_t newCapacity = std::max(2 * capacity, length + n);
+    std::unique_ptr<char[]> newBytes(new char[newCapacity]);
+    std::memcpy(newBytes.get(), bytes.get(), length);
+    bytes = std::move(newBytes);
+    capacity = newCapacity;
+}
+
+JsonWriter::JsonWriter(OutputBuffer &out, WriteStyle style, unsigned indent)
+    : out(out), pretty(style == WriteStyle::Pretty), indent(indent)
+{
+}
+
+void JsonWriter::newline()
+{
+    std::size_t width = depth * indent;
+    char *p = out.reserve(width + 1);
+    *p = '\n';
+    std::memset(p + 1, ' ', width);
+    out.commit(width + 1);
+}
+
+char *JsonWriter::item(std::size_t length)
+{
+    // One reservation covers the separator, the indentation and the item
+    std::size_t width = pretty ? depth * indent : 0;
+    char *start = out.reserve(width + 2 + length);
+    char *p = start;
+    if (afterKey)
+    {
+        afterKey = false;
+        return p;
+    }
+    if (!first)
+        *p++ = ',';
+    first = false;
+    if (pretty && depth > 0)
+    {
+        *p++ = '\n';
+        std::memset(p, ' ', width);
+        p += width;
+    }
+    out.commit(p - start);
+    return p;
+}
+
+void JsonWriter::open(char bracket)
+{
+    *item(1) = bracket;
+    out.commit(1);
+    ++depth;
+    first = true;
+}
+
+void JsonWriter::close(char bracket)
+{
+    --depth;
+    // Empty containers stay on one line
+    if (pretty && !first)
+        newline();
+    out.append(bracket);
+    first = false;
+}
+
+void JsonWriter::rawKey(const char *text, std::size_t length)
+{
+    char *p = item(length + 2);
+    std::memcpy(p, text, length);
+    p[length] = ':';
+    p[length + 1] = ' ';
+    out.commit(length + (pretty ? 2 : 1));
+    afterKey = true;
+}
+
+void JsonWriter::rawValue(const char *text, std::size_t length)
+{
+    std::memcpy(item(length), text, length);
+    out.commit(length);
+}
+
+void JsonWriter::key(const char *text, std::size_t length)
+{
+    string(text, length);
+    out.append(pretty ? ": " : ":", pretty ? 2 : 1);
+    afterKey = true;
+}
+
+void JsonWriter::string(const char *text, std::size_t length)
+{
+    // Worst case every byte becomes a six-byte \u escape
+    char *start = item(6 * length + 2);
+    char *p = start;
+    *p++ = '"';
+    const char *end = text + length;
+    while (text != end)
+    {
+        // Clean runs are found by table lookup and copied in one go
+        const char *run = text;
+        while (text != end && !escapes.next[static_cast<unsigned char>(*text)])
+            ++text;
+        std::memcpy(p, run, text - run);
+        p += text - run;
+        if (text == end)
+            break;
+
+        unsigned char c = static_cast<unsigned char>(*text++);
+        *p++ = '\\';
+        *p++ = escapes.next[c];
+        if (escapes.next[c] == 'u')
+        {
+            *p++ = '0';
+            *p++ = '0';
+            *p++ = "0123456789abcdef"[c >> 4];
+            *p++ = "0123456789abcdef"[c & 15];
+        }
+    }
+    *p++ = '"';
+    out.commit(p - start);
+}
+
+void JsonWriter::integer(int64_t value)
+{
+    char digits[21];
+    char *end = digits + sizeof digits;
+    // Negate in unsigned arithmetic so INT64_MIN works
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    char *begin = formatDigits(magnitude, end);
+    if (value < 0)
+        *--begin = '-';
+    rawValue(begin, end - begin);
+}
+
+void JsonWriter::unsignedInteger(uint64_t value)
+{
+    char digits[20];
+    char *end = digits + sizeof digits;
+    char *begin = formatDigits(value, end);
+    rawValue(begin, end - begin);
+}
+
+bool JsonWriter::writeShortDecimal(double value)
+{
+    // value prints as m / 10^k, m an integer below 10^15, exactly when the
+    // division (correctly rounded, which is also what reading "m e-k" back
+    // computes) gives value again. If such an m exists it is value * 10^k
+    // rounded to the nearest integer: the scaling errs by far less than
+    // 0.5 below 10^15. Trying k upwards, the first hit has the fewest
+    // digits, and 15 or fewer significant digits pick out one double, so
+    // this is the shortest text.
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17};
+    double magnitude = std::fabs(value);
+    for (int k = 0; k < 18; ++k)
+    {
+        double m = std::round(magnitude * powers[k]);
+        if (m >= 1e15)
+            return false;
+        if (m / powers[k] != magnitude)
+            continue;
+
+        char text[40];
+        char *end = text + sizeof text;
+        char *begin = end;
+        if (k == 0)
+        {
+            *--begin = '0';
+            *--begin = '.';
+        }
+        begin = formatDigits(static_cast<uint64_t>(m), begin);
+        if (k > 0)
+        {
+            // Pad with zeros to k digits, then move the point in
+            while (end - begin < k)
+                *--begin = '0';
+            std::memmove(begin - 1, begin, end - begin - k);
+            --begin;
+            end[-k - 1] = '.';
+            if (end - begin == k + 1)
+                *--begin = '0';
+        }
+        if (std::signbit(value))
+            *--begin = '-';
+        rawValue(begin, end - begin);
+        return true;
+    }
+    return false;
+}
+
+void JsonWriter::number(double value)
+{
+    if (!std::isfinite(value))
+    {
+        null();
+        return;
+    }
+    if (writeShortDecimal(value))
+        return;
+    // 17 significant digits always read back exactly. A normal double that
+    // some text of 15 or fewer digits reads back to prints as that text at
+    // %.15g (trailing zeros dropped), so the first precision from 15 that
+    // round-trips gives the shortest text. Subnormals have fewer bits than
+    // that argument needs (5e-324 is one digit) and try every precision.
+    char text[32];
+    int length = 0;
+    for (int precision = std::fabs(value) < DBL_MIN ? 1 : 15; precision <= 17; ++precision)
+    {
+        length = std::snprintf(text, sizeof text, "%.*g", precision, value);
+        if (std::strtod(text, nullptr) == value)
+            break;
+    }
+    if (!std::memchr(text, '.', length) && !std::memchr(text, 'e', length))
+    {
+        std::memcpy(text + length, ".0", 3);
+        length += 2;
+    }
+    rawValue(text, length);
+}
+
+void JsonWriter::value(const Value &v)
+{
+    switch (v.type)
+    {
+    case ValueType::Null:
+        null();
+        break;
+    case ValueType::Bool:
+        boolean(v.asBool());
+        break;
+    case ValueType::Number:
+        if (v.numberKind == NumberKind::Int64)
+            integer(v.asInt64());
+        else if (v.numberKind == NumberKind::Uint64)
+            unsignedInteger(v.asUint64());
+        else
+            number(v.number);
+        break;
+    case ValueType::String:
+        string(v.string, v.length);
+        break;
+    case ValueType::Array:
+        startArray();
+        for (const Value &element : v)
+            value(element);
+        endArray();
+        break;
+    case ValueType::Object:
+        startObject();
+        for (std::size_t i = 0; i < v.size(); ++i)
+        {
+            const Member &m = v.member(i);
+            key(m.key, m.keyLength);
+            value(m.value);
+        }
+        endObject();
+        break;
+    }
+}
+
+bool rewrite(const char *data, std::size_t size, JsonWriter &writer, std::size_t maxDepth)
+{
+    StructuralIndex index;
+    if (index.build(data, size))
+        return BasicParser<IndexedLexer, RewriteHandler>(IndexedLexer(data, size, index),
+                                                         RewriteHandler(writer, data), maxDepth)
+            .parse();
+    return BasicParser<Lexer, RewriteHandler>(Lexer(data, size), RewriteHandler(writer, data), maxDepth).parse();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "depth_stack.h"
+#include "dom.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Growable byte buffer. Writers reserve room once per item and then store
+// into it directly, so appending costs a compare and a memcpy.
+class OutputBuffer
+{
+public:
+    explicit OutputBuffer(std::size_t initialCapacity = 64 * 1024);
+
+    // Room for n more bytes at the end; the caller advances with commit()
+    char *reserve(std::size_t n)
+    {
+        if (capacity - length < n)
+            grow(n);
+        return bytes.get() + length;
+    }
+    void commit(std::size_t n) { length += n; }
+
+    void append(const char *data, std::size_t n)
+    {
+        std::memcpy(reserve(n), data, n);
+        length += n;
+    }
+    void append(char c)
+    {
+        *reserve(1) = c;
+        ++length;
+    }
+
+    const char *data() const { return bytes.get(); }
+    std::size_t size() const { return length; }
+    void clear() { length = 0; } // keeps the capacity
+
+private:
+    void grow(std::size_t n);
+
+    std::unique_ptr<char[]> bytes;
+    std::size_t length = 0;
+    std::size_t capacity = 0;
+};
+
+enum class WriteStyle
+{
+    Minify, // no whitespace at all
+    Pretty  // one member or element per line, indented
+};
+
+// Emits JSON text into an OutputBuffer from a sequence of calls that
+// mirrors the parser handler interface. The writer adds the commas, colons
+// and (when pretty) newlines and indentation; callers only say what comes
+// next. Nothing checks that the calls form a document.
+class JsonWriter
+{
+public:
+    JsonWriter(OutputBuffer &out, WriteStyle style = WriteStyle::Minify, unsigned indent = 2);
+
+    void startObject() { open('{'); }
+    void endObject() { close('}'); }
+    void startArray() { open('['); }
+    void endArray() { close(']'); }
+
+    // A key or string value given decoded; quotes and escapes are added
+    void key(const char *text, std::size_t length);
+    void string(const char *text, std::size_t length);
+    // Text that is already JSON (a quoted string, a number, a keyword) and
+    // is copied as is; rawKey takes the key with its quotes
+    void rawKey(const char *text, std::size_t length);
+    void rawValue(const char *text, std::size_t length);
+
+    void integer(int64_t value);
+    void unsignedInteger(uint64_t value);
+    // The shortest text that reads back as the same double, with ".0" on
+    // integral values so they stay doubles. JSON has no infinity or NaN;
+    // those are written as null.
+    void number(double value);
+    void boolean(bool value) { rawValue(value ? "true" : "false", value ? 4 : 5); }
+    void null() { rawValue("null", 4); }
+
+    // A whole DOM value, recursively; Document bounds its depth
+    void value(const Value &v);
+
+private:
+    void open(char bracket);
+    void close(char bracket);
+    // Writes the comma and indentation due before the next key or value
+    // and returns where it goes, with room reserved for length bytes
+    char *item(std::size_t length);
+    void newline();
+    bool writeShortDecimal(double value); // number()'s fast path
+
+    OutputBuffer &out;
+    bool pretty;
+    unsigned indent;
+    std::size_t depth = 0;
+    bool first = true;     // nothing written yet in the open container
+    bool afterKey = false; // the next value is a member's
+};
+
+// Parses data[0, size) and writes it back out in the writer's style, in
+// one pass: scalars and keys are copied from the input unchanged, so the
+// cost is close to validation plus a copy. Returns false, with partial
+// output, if the document is invalid.
+bool rewrite(const char *data, std::size_t size, JsonWriter &writer, std::size_t maxDepth = DEFAULT_MAX_DEPTH);
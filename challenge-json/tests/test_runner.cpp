@@ -2,20 +2,37 @@
 // Builds a lightweight assertion framework and verifies parser behavior
 // against provided fixtures in tests/step1..step4.
 //
-// How to build and run (after Makefile update in a later step):
+// How to build and run:
 //   make jp_tests
 //   ./jp_tests
 //
 // Returns 0 on success (all tests pass), non-zero otherwise.
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <random>
 #include <vector>
 #include <string>
 #include <stdexcept>
 
+#include "binding.h"
+#include "dom.h"
 #include "file_utils.h"
 #include "lexer.h"
+#include "number.h"
+#include "ndjson.h"
 #include "parser.h"
+#include "query.h"
+#include "schema.h"
+#include "stream_parser_impl.h"
+#include "structural.h"
+#include "writer.h"
 
 struct TestCase {
     std::string name;
@@ -53,6 +70,595 @@ static bool runFile(const std::string& name, const std::string& path, bool expec
     }
 }
 
+static bool check(const std::string& name, bool ok) {
+    std::cout << (ok ? "[PASS] " : "[FAIL] ") << name << "\n";
+    return ok;
+}
+
+// DOM checks: the tree must survive the input and mirror the document
+static std::vector<bool> runDomChecks() {
+    std::vector<bool> results;
+    Document doc;
+    std::string input = "{\"a\":[1,22,{\"k\":null}],\"t\":true,\"s\":\"hi\",\"o\":{},\"e\":[]}";
+    bool parsed = doc.parse(input);
+    input.assign(input.size(), '#');
+    const Value& root = doc.root();
+    const Value* a = root.find("a");
+    results.push_back(check("DOM: parses and outlives its input", parsed && root.isObject() && root.size() == 5));
+    results.push_back(check("DOM: member order and keys", root.member(0).name() == "a" && root.member(4).name() == "e"));
+    results.push_back(check("DOM: array elements", a && a->isArray() && a->size() == 3 && (*a)[1].asNumber() == 22));
+    results.push_back(check("DOM: nested object in array", a && (*a)[2].find("k") && (*a)[2].find("k")->isNull()));
+    results.push_back(check("DOM: scalars", root.find("t")->asBool() && root.find("s")->str() == "hi"));
+    results.push_back(check("DOM: empty containers", root.find("o")->size() == 0 && root.find("e")->isArray()));
+    results.push_back(check("DOM: missing key", root.find("missing") == nullptr));
+    Document escaped;
+    escaped.parse("{\"s\":\"a\\nb\\u00e9\\ud83d\\ude00\\\"\\/ a long run of plain text after the escapes\"}");
+    results.push_back(check("DOM: escapes decode, \\u as UTF-8",
+                            escaped.root().find("s")->str() ==
+                                "a\nb\xc3\xa9\xf0\x9f\x98\x80\"/ a long run of plain text after the escapes"));
+    results.push_back(check("DOM: invalid input leaves a null root", !doc.parse("{\"a\":}") && doc.root().isNull()));
+    return results;
+}
+
+// IndexedLexer must produce Lexer's tokens, up to the first INVALID or EOF
+// (where the parser stops), with every stage-1 kernel
+static bool sameTokens(const std::string& json, Stage1Kernel kernel) {
+    StructuralIndex index;
+    if (!index.build(json.data(), json.size(), kernel))
+        return false;
+    Lexer bytes(json);
+    IndexedLexer indexed(json.data(), json.size(), index);
+    for (;;) {
+        Token a = bytes.next();
+        Token b = indexed.next();
+        if (a.type != b.type || a.pos != b.pos || a.length != b.length || a.badChar != b.badChar)
+            return false;
+        if (a.type == TokenType::INVALID || a.type == TokenType::EOF_TOKEN)
+            return true;
+    }
+}
+
+static std::vector<bool> runIndexChecks() {
+    std::vector<std::string> inputs = {
+        "", "{}", "  {\"a\" : [1, 22, true, false, null] }\n",
+        "{\"esc\":\"a\\\"b\\\\\",\"x\":\"{[,:]}\"}",
+        "{\"a\":12ab}", "{\"a\":truex}", "{\"a\":12-3}", "{\"a\":\"open",
+        "{\"a\":\"b\\", "x\\\"y", "{\"a\":1}\v", "{\"a\":\"\xc3\xa9\"}",
+    };
+    // Escapes and strings straddling 64-byte block boundaries
+    for (std::size_t pad = 55; pad < 70; ++pad)
+        inputs.push_back("{\"" + std::string(pad, 'k') + "\":\"\\\\\\\"x\",\"n\":[1,2]}");
+    std::mt19937 rng(7);
+    const char alphabet[] = "{}[]:,\"\\ \n10a-+.Etru enl\xc3\xa9\x01";
+    for (int i = 0; i < 400; ++i) {
+        std::string json(rng() % 200, ' ');
+        for (char& c : json)
+            c = alphabet[rng() % (sizeof(alphabet) - 1)];
+        inputs.push_back(json);
+    }
+
+    std::vector<bool> results;
+    const Stage1Kernel kernels[] = {Stage1Kernel::Scalar, Stage1Kernel::Sse2, Stage1Kernel::Avx2};
+    for (Stage1Kernel kernel : kernels) {
+        if (!StructuralIndex::supported(kernel))
+            continue;
+        bool same = true;
+        for (const std::string& json : inputs)
+            same = same && sameTokens(json, kernel);
+        results.push_back(check(std::string("Index: ") + StructuralIndex::kernelName(kernel) +
+                                " tokens match Lexer on " + std::to_string(inputs.size()) + " inputs", same));
+
+        // Building in place over padding must not index the padding,
+        // whatever it holds
+        bool padded = true;
+        StructuralIndex plain, inPlace;
+        for (const std::string& json : inputs) {
+            std::string buffer = json + std::string(64, '"');
+            buffer.replace(json.size() + 10, 3, "1[\\");
+            plain.build(json.data(), json.size(), kernel);
+            inPlace.build(buffer.data(), json.size(), kernel, 64);
+            padded = padded && plain.size() == inPlace.size() &&
+                     std::equal(plain.positions(), plain.positions() + plain.size(), inPlace.positions());
+        }
+        results.push_back(check(std::string("Index: ") + StructuralIndex::kernelName(kernel) +
+                                " padded build ignores the padding", padded));
+    }
+    return results;
+}
+
+// InputFile: whole content, then INPUT_PADDING zero bytes, mapped or read
+static std::vector<bool> runInputChecks() {
+    std::vector<bool> results;
+    const char* path = "/tmp/jp_tests_input.json";
+    bool allOk = true;
+    // A page exactly: the padding lies past the file's last page
+    for (std::size_t size : {std::size_t(1), std::size_t(4095), std::size_t(4096), std::size_t(70000)}) {
+        std::string content(size, ' ');
+        content[0] = '{';
+        content[size - 1] = '}';
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(content.data(), static_cast<std::streamsize>(size));
+        }
+        FileUtils::InputFile input(path);
+        bool ok = input.mapped() && input.size() == size && std::memcmp(input.data(), content.data(), size) == 0;
+        for (std::size_t i = 0; i < FileUtils::INPUT_PADDING; ++i)
+            ok = ok && input.data()[size + i] == '\0';
+        allOk = allOk && ok;
+    }
+    std::remove(path);
+    results.push_back(check("Input: files are mapped with zero padding", allOk));
+
+    FileUtils::InputFile empty("/dev/null");
+    results.push_back(check("Input: special files are read", !empty.mapped() && empty.size() == 0 &&
+                                                                empty.data()[0] == '\0'));
+    bool threw = false;
+    try {
+        FileUtils::InputFile missing("/nonexistent/jp.json");
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    results.push_back(check("Input: missing file throws", threw));
+    return results;
+}
+
+// Records SAX events as text, to compare chunkings of one document
+struct EventLog {
+    std::string* out;
+    bool startObject() { *out += "{"; return true; }
+    bool key(const char* text, std::size_t length) { out->append(text, length) += ":"; return true; }
+    bool endObject() { *out += "}"; return true; }
+    bool startArray() { *out += "["; return true; }
+    bool endArray() { *out += "]"; return true; }
+    bool value(TokenType, const char* text, std::size_t length) { out->append(text, length) += ","; return true; }
+};
+
+static bool streamParse(const std::string& json, std::size_t chunkSize, std::string* events = nullptr) {
+    std::string ignored;
+    StreamParser<EventLog> parser(EventLog{events ? events : &ignored});
+    for (std::size_t at = 0; at < json.size(); at += chunkSize) {
+        if (!parser.feed(json.data() + at, std::min(chunkSize, json.size() - at)))
+            return false;
+    }
+    return parser.finish();
+}
+
+// StreamParser must accept exactly what Parser accepts, however the input
+// is cut, and report the same events for every cut
+static std::vector<bool> runStreamChecks(const std::vector<TestCase>& cases) {
+    std::vector<std::string> inputs;
+    for (const auto& tc : cases)
+        inputs.push_back(tc.path.empty() ? tc.inlineJson : FileUtils::readFileForParsing(tc.path));
+    inputs.push_back("{\"a\":\"x\\\"y\",\"n\":12345,\"k\":[true,false,null]}  ");
+    inputs.push_back("{\"a\":1}}");
+    inputs.push_back("{\"a\":1]");
+    inputs.push_back("{\"a\":[1}");
+    inputs.push_back("{\"a\":tru");
+    inputs.push_back("{\"a\":\"open");
+    std::mt19937 rng(11);
+    const char alphabet[] = "{}[]:,\"\\ 10a-+.Etru enl\xc3\xa9\x01";
+    for (int i = 0; i < 400; ++i) {
+        std::string json = "{\"k\":";
+        std::size_t length = rng() % 40;
+        for (std::size_t j = 0; j < length; ++j)
+            json += alphabet[rng() % (sizeof(alphabet) - 1)];
+        inputs.push_back(json);
+    }
+
+    bool sameResult = true;
+    bool sameEvents = true;
+    for (const std::string& json : inputs) {
+        Parser parser{Lexer(json)};
+        bool expected = parser.parse();
+        std::string whole;
+        sameResult = sameResult && streamParse(json, json.size() + 1, &whole) == expected;
+        for (std::size_t chunkSize : {1, 2, 3, 7, 64}) {
+            std::string events;
+            bool ok = streamParse(json, chunkSize, &events);
+            sameResult = sameResult && ok == expected;
+            sameEvents = sameEvents && (!ok || events == whole);
+        }
+    }
+
+    std::vector<bool> results;
+    results.push_back(check("Stream: accepts what Parser accepts on " + std::to_string(inputs.size()) +
+                            " inputs in chunks of 1 to 64 bytes", sameResult));
+    results.push_back(check("Stream: the same events for every chunk size", sameEvents));
+
+    // Nothing accumulates but the open containers
+    StreamParser<> deep;
+    std::string open = "{\"k\":" + std::string(1000, '[');
+    results.push_back(check("Stream: depth tracks open containers",
+                            deep.feed(open) && deep.depth() == 1001 && deep.feed(std::string(1000, ']') + "}") &&
+                                deep.depth() == 0 && deep.finish()));
+    return results;
+}
+
+// NDJSON: per-line verdicts in input order, whatever the thread count
+static std::vector<bool> runNdjsonChecks() {
+    std::vector<bool> results;
+    std::string small = "{\"a\":1}\n\n{\"a\":}\r\n  \n{\"b\":[true]}\r\n[1]\n{\"c\":null}";
+    NdjsonResult r = validateLines(small.data(), small.size(), 1);
+    results.push_back(check("NDJSON: skips blank lines, numbers invalid ones from 1",
+                            r.records == 5 && r.invalidLines == std::vector<std::size_t>({3, 6})));
+
+    // Several batches' worth, with invalid lines scattered through it
+    std::string big;
+    std::vector<std::size_t> expected;
+    for (std::size_t line = 1; line <= 60000; ++line) {
+        if (line % 9973 == 0) {
+            big += "{\"id\":" + std::to_string(line) + ",}\n";
+            expected.push_back(line);
+        } else {
+            big += "{\"id\":" + std::to_string(line) + ",\"tags\":[\"x\",\"y\"],\"ok\":true}\n";
+        }
+    }
+    bool same = true;
+    for (unsigned threads : {1u, 2u, 3u, 8u}) {
+        NdjsonResult got = validateLines(big.data(), big.size(), threads);
+        same = same && got.records == 60000 && got.invalidLines == expected;
+    }
+    results.push_back(check("NDJSON: the same ordered errors on 1 to 8 threads", same));
+    return results;
+}
+
+// Nesting limits: exactly maxDepth levels parse, one more is rejected, and
+// hostile depth is rejected without touching the C++ stack
+static std::vector<bool> runDepthChecks() {
+    auto nested = [](std::size_t depth) {
+        return "{\"a\":" + std::string(depth - 1, '[') + std::string(depth - 1, ']') + "}";
+    };
+    auto parses = [](const std::string& json, std::size_t maxDepth) {
+        Parser parser(Lexer(json), NullHandler(), maxDepth);
+        StructuralIndex index;
+        index.build(json.data(), json.size());
+        IndexedParser indexed(IndexedLexer(json.data(), json.size(), index), NullHandler(), maxDepth);
+        StreamParser<> stream(NullStreamHandler(), maxDepth);
+        Document doc(maxDepth);
+        bool a = parser.parse(), b = indexed.parse(), c = stream.feed(json) && stream.finish(), d = doc.parse(json);
+        // Parsers that disagree fail the check whichever answer it expects
+        return a == b && b == c && c == d ? a : !a;
+    };
+
+    std::vector<bool> results;
+    results.push_back(check("Depth: default limit admits 1024 levels", parses(nested(1024), DEFAULT_MAX_DEPTH)));
+    results.push_back(check("Depth: 1025 levels are rejected by every parser", !parses(nested(1025), DEFAULT_MAX_DEPTH)));
+    results.push_back(check("Depth: small limits are exact", parses(nested(3), 3) && !parses(nested(4), 3)));
+    results.push_back(check("Depth: a million levels are rejected, not a crash", !parses(nested(1000000), DEFAULT_MAX_DEPTH)));
+    results.push_back(check("Depth: raised limits hold deep documents", parses(nested(100000), 100000)));
+    return results;
+}
+
+// Numbers convert to exact integers where they fit and to correctly
+// rounded doubles (checked against strtod) otherwise
+static std::vector<bool> runNumberChecks() {
+    std::vector<bool> results;
+    Document doc;
+    doc.parse("{\"n\":[9223372036854775807,-9223372036854775808,18446744073709551615,"
+              "18446744073709551616,-9223372036854775809,0.1,-2.5e-3,1e400,123456789012345678901234]}");
+    const Value& n = *doc.root().find("n");
+    results.push_back(check("Number: int64 limits stay exact",
+                            n[0].isInt64() && n[0].asInt64() == INT64_MAX && n[1].isInt64() && n[1].asInt64() == INT64_MIN));
+    results.push_back(check("Number: uint64 above INT64_MAX", n[2].isUint64() && !n[2].isInt64() && n[2].asUint64() == UINT64_MAX));
+    results.push_back(check("Number: out-of-range integers become doubles",
+                            !n[3].isUint64() && n[3].asNumber() == 18446744073709551616.0 &&
+                            !n[4].isInt64() && n[4].asNumber() == -9223372036854775809.0));
+    results.push_back(check("Number: fractions and exponents",
+                            n[5].asNumber() == 0.1 && n[6].asNumber() == -2.5e-3 && n[7].asNumber() == HUGE_VAL &&
+                            n[8].asNumber() == 123456789012345678901234.0));
+
+    std::mt19937_64 rng(3);
+    bool exact = true;
+    char text[64];
+    for (int i = 0; i < 20000 && exact; ++i) {
+        // Short decimals (the fast path) and random bit patterns (mostly not)
+        double expected;
+        if (i % 2)
+            std::snprintf(text, sizeof(text), "%.*g", 1 + static_cast<int>(rng() % 17), static_cast<double>(rng() % 100000000) / 1000);
+        else {
+            uint64_t bits = rng();
+            std::memcpy(&expected, &bits, sizeof(bits));
+            if (!std::isfinite(expected))
+                continue;
+            std::snprintf(text, sizeof(text), "%.17g", expected);
+        }
+        expected = std::strtod(text, nullptr);
+        double got = convertNumber(text, std::strlen(text)).toDouble();
+        exact = std::memcmp(&got, &expected, sizeof(got)) == 0 ||
+                (convertNumber(text, std::strlen(text)).kind != NumberKind::Double && got == expected);
+    }
+    results.push_back(check("Number: doubles match strtod on 20000 inputs", exact));
+    return results;
+}
+
+// Queries: selected values' text, in document order
+static std::string runQuery(const std::string& path, const std::string& json, bool* ok = nullptr) {
+    Query query(path);
+    std::vector<QueryMatch> matches;
+    bool valid = query.evaluate(json.data(), json.size(), matches);
+    if (ok)
+        *ok = valid;
+    std::string out;
+    for (const QueryMatch& m : matches)
+        out += json.substr(m.pos, m.length) + ";";
+    return out;
+}
+
+static std::vector<bool> runQueryChecks() {
+    std::string doc = "{\"items\":[{\"id\":1,\"tags\":[\"a\",\"b\"]},{\"id\":-2.5e3,\"skip\":{\"x\":[[\"]\"]]}},"
+                      "{\"name\":\"n\"},{\"id\":\"s\"}],\"k\\u0065y\":true,\"a b\":null,\"items2\":{}}";
+    std::vector<bool> results;
+    results.push_back(check("Query: wildcard over an array", runQuery("$.items[*].id", doc) == "1;-2.5e3;\"s\";"));
+    results.push_back(check("Query: index and nested array", runQuery("$.items[0].tags[1]", doc) == "\"b\";"));
+    results.push_back(check("Query: whole subtree text", runQuery("$.items[1].skip", doc) == "{\"x\":[[\"]\"]]};"));
+    results.push_back(check("Query: escaped key and bracket names",
+                            runQuery("$.key", doc) == "true;" && runQuery("$['a b']", doc) == "null;"));
+    results.push_back(check("Query: member wildcard", runQuery("$.items[2].*", doc) == "\"n\";"));
+    results.push_back(check("Query: no match is not an error", runQuery("$.items[9]", doc).empty() &&
+                                                                   runQuery("$.missing.id", doc).empty()));
+    results.push_back(check("Query: root", runQuery("$", "{\"a\":1}") == "{\"a\":1};"));
+    bool ok = true;
+    runQuery("$.a[*]", "{\"a\":[1,2", &ok);
+    results.push_back(check("Query: malformed structure is reported", !ok));
+    auto rejects = [](const std::string& path, const std::string& json) {
+        bool valid = true;
+        std::string out = runQuery(path, json, &valid);
+        return !valid && out.empty();
+    };
+    results.push_back(check("Query: malformed scalar matches are rejected",
+                            rejects("$.a", "{\"a\": tru}") && rejects("$.a", "{\"a\":01}") &&
+                                rejects("$.a", "{\"a\":\"x\\q\"}") && rejects("$.a", "{\"a\":1.}")));
+    results.push_back(check("Query: container matches are parsed in full",
+                            rejects("$.a", "{\"a\":[1 2]}") && rejects("$.a", "{\"a\":{\"b\":}}") &&
+                                rejects("$.a", "{\"a\":[1,]}") && runQuery("$.a", "{\"a\":[1,{\"b\":[]}]}") == "[1,{\"b\":[]}];"));
+    results.push_back(check("Query: the document must be one object, as for Parser",
+                            rejects("$[0]", "[1,2,3]") && rejects("$.a.b", "{\"a\":{\"b\":1}} xyz") &&
+                                rejects("$.a", "{\"a\":1} {}") && runQuery("$.a", " {\"a\":1}\n ") == "1;"));
+    bool threw = false;
+    try {
+        Query bad("$.items[");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    results.push_back(check("Query: malformed path throws", threw));
+    return results;
+}
+
+// Writer: re-emitted text, and DOM values surviving a write and re-parse
+static std::string rewriteText(const std::string& json, WriteStyle style, bool* ok = nullptr) {
+    OutputBuffer out(4); // tiny, so writes have to grow it
+    JsonWriter writer(out, style);
+    bool valid = rewrite(json.data(), json.size(), writer);
+    if (ok)
+        *ok = valid;
+    return std::string(out.data(), out.size());
+}
+
+static std::string writeDom(const std::string& json) {
+    Document doc;
+    if (!doc.parse(json))
+        return "<invalid>";
+    OutputBuffer out;
+    JsonWriter writer(out);
+    writer.value(doc.root());
+    return std::string(out.data(), out.size());
+}
+
+static std::vector<bool> runWriterChecks() {
+    std::vector<bool> results;
+    std::string doc = " { \"a\" : [ 1 , -2.5e3 , \"x\\ny\" ] ,\n\"o\" : { } , \"e\" : [ ] , \"t\" : true } ";
+    results.push_back(check("Writer: minify", rewriteText(doc, WriteStyle::Minify) ==
+                                                   "{\"a\":[1,-2.5e3,\"x\\ny\"],\"o\":{},\"e\":[],\"t\":true}"));
+    results.push_back(check("Writer: pretty", rewriteText(doc, WriteStyle::Pretty) ==
+                                                   "{\n  \"a\": [\n    1,\n    -2.5e3,\n    \"x\\ny\"\n  ],\n"
+                                                   "  \"o\": {},\n  \"e\": [],\n  \"t\": true\n}"));
+    bool ok = true;
+    rewriteText("{\"a\":[1,]}", WriteStyle::Minify, &ok);
+    results.push_back(check("Writer: invalid input is reported", !ok));
+
+    results.push_back(check("Writer: DOM strings are escaped",
+                            writeDom("{\"s\":\"q\\\"b\\\\ \\u0001\\t\\/\\u00e9\"}") ==
+                                "{\"s\":\"q\\\"b\\\\ \\u0001\\t/\xc3\xa9\"}"));
+    results.push_back(check("Writer: DOM integers are exact",
+                            writeDom("{\"n\":[0,-9223372036854775808,18446744073709551615,99,100]}") ==
+                                "{\"n\":[0,-9223372036854775808,18446744073709551615,99,100]}"));
+    results.push_back(check("Writer: DOM doubles are shortest and stay doubles",
+                            writeDom("{\"d\":[0.1,1.0,-0.0,1e300,2.5E-3,1e999,-123.456,1e-7,5e-324]}") ==
+                                "{\"d\":[0.1,1.0,-0.0,1e+300,0.0025,null,-123.456,0.0000001,5e-324]}"));
+
+    auto numberText = [](double d) {
+        OutputBuffer out;
+        JsonWriter writer(out);
+        writer.number(d);
+        return std::string(out.data(), out.size());
+    };
+    results.push_back(check("Writer: no trailing zeros where scaling rounds badly",
+                            numberText(4.35) == "4.35" && numberText(0.07) == "0.07" && numberText(-1.005) == "-1.005" &&
+                                numberText(5e-324) == "5e-324" && numberText(1e-320) == "1e-320" &&
+                                numberText(2.2250738585072014e-308) == "2.2250738585072014e-308"));
+
+    // Random doubles, and short decimals, must read back bit for bit
+    std::mt19937_64 rng(46);
+    bool exact = true;
+    for (int i = 0; i < 20000 && exact; ++i) {
+        uint64_t bits = rng();
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        if (i % 2)
+            d = static_cast<double>(bits % 1000000000) / std::pow(10.0, static_cast<int>(bits >> 60));
+        if (!std::isfinite(d))
+            continue;
+        OutputBuffer out;
+        JsonWriter writer(out);
+        writer.number(d);
+        std::string text(out.data(), out.size());
+        exact = convertNumber(text.data(), text.size()).toDouble() == d;
+    }
+    results.push_back(check("Writer: doubles round-trip on 20000 inputs", exact));
+    return results;
+}
+
+// Schema: the first violation's path and message, or the result
+static std::string runSchema(Schema& schema, const std::string& json) {
+    SchemaViolation violation;
+    switch (schema.validate(json.data(), json.size(), &violation)) {
+    case SchemaResult::Valid:
+        return "valid";
+    case SchemaResult::InvalidJson:
+        return "invalid";
+    default:
+        return violation.path + " " + violation.message;
+    }
+}
+
+static std::vector<bool> runSchemaChecks() {
+    std::vector<bool> results;
+    Schema schema("{\"type\":\"object\",\"required\":[\"id\",\"tags\"],\"properties\":{"
+                  "\"id\":{\"type\":\"integer\",\"minimum\":1,\"exclusiveMaximum\":100},"
+                  "\"name\":{\"type\":[\"string\",\"null\"],\"minLength\":2,\"maxLength\":4},"
+                  "\"kind\":{\"enum\":[\"a\",\"b\\u00e9\",3,null]},"
+                  "\"tags\":{\"type\":\"array\",\"minItems\":1,\"maxItems\":3,\"items\":{\"type\":\"string\"}},"
+                  "\"a/b\":{\"type\":\"object\",\"required\":[\"x\"]},"
+                  "\"any\":true,\"never\":false},\"title\":\"t\"}");
+    results.push_back(check("Schema: conforming document",
+                            runSchema(schema, "{\"id\":1.0,\"name\":\"\xc3\xa9t\xc3\xa9\",\"kind\":\"b\xc3\xa9\","
+                                              "\"tags\":[\"x\"],\"extra\":[{}],\"any\":[1,{\"k\":2}]}") == "valid"));
+    results.push_back(check("Schema: type and integer checks",
+                            runSchema(schema, "{\"id\":\"1\",\"tags\":[]}") == "/id expected integer" &&
+                                runSchema(schema, "{\"id\":1.5,\"tags\":[]}") == "/id expected integer"));
+    results.push_back(check("Schema: bounds",
+                            runSchema(schema, "{\"id\":0,\"tags\":[\"x\"]}") == "/id below the minimum" &&
+                                runSchema(schema, "{\"id\":100,\"tags\":[\"x\"]}") == "/id above the maximum"));
+    Schema lowFirst("{\"properties\":{\"a\":{\"exclusiveMinimum\":3,\"minimum\":5,"
+                    "\"exclusiveMaximum\":9,\"maximum\":7}}}");
+    Schema highFirst("{\"properties\":{\"a\":{\"minimum\":5,\"exclusiveMinimum\":3,"
+                     "\"maximum\":7,\"exclusiveMaximum\":9}}}");
+    Schema tie("{\"properties\":{\"a\":{\"maximum\":7,\"exclusiveMaximum\":7}}}");
+    results.push_back(check("Schema: combined bounds don't depend on keyword order",
+                            runSchema(lowFirst, "{\"a\":5}") == "valid" && runSchema(highFirst, "{\"a\":5}") == "valid" &&
+                                runSchema(lowFirst, "{\"a\":7}") == "valid" && runSchema(highFirst, "{\"a\":7}") == "valid" &&
+                                runSchema(lowFirst, "{\"a\":4}") == "/a below the minimum" &&
+                                runSchema(highFirst, "{\"a\":8}") == "/a above the maximum" &&
+                                runSchema(tie, "{\"a\":7}") == "/a above the maximum"));
+    results.push_back(check("Schema: lengths count code points",
+                            runSchema(schema, "{\"id\":2,\"tags\":[\"x\"],\"name\":\"\xc3\xa9\"}") ==
+                                "/name expected at least 2 characters"));
+    results.push_back(check("Schema: enum", runSchema(schema, "{\"id\":2,\"tags\":[\"x\"],\"kind\":3}") == "valid" &&
+                                                runSchema(schema, "{\"id\":2,\"tags\":[\"x\"],\"kind\":\"c\"}") ==
+                                                    "/kind expected one of the enum values"));
+    Schema emptyEnum("{\"properties\":{\"a\":{\"enum\":[]}}}");
+    results.push_back(check("Schema: an empty enum matches nothing",
+                            runSchema(emptyEnum, "{\"a\":5}") == "/a expected one of the enum values" &&
+                                runSchema(emptyEnum, "{\"a\":[]}") == "/a expected one of the enum values" &&
+                                runSchema(emptyEnum, "{\"b\":5}") == "valid"));
+    results.push_back(check("Schema: required, with the path escaped",
+                            runSchema(schema, "{\"id\":2}") == "/ missing required property \"tags\"" &&
+                                runSchema(schema, "{\"id\":2,\"tags\":[\"x\"],\"a/b\":{}}") ==
+                                    "/a~1b missing required property \"x\""));
+    results.push_back(check("Schema: items and item counts",
+                            runSchema(schema, "{\"id\":2,\"tags\":[\"x\",7]}") == "/tags/1 expected string" &&
+                                runSchema(schema, "{\"id\":2,\"tags\":[]}") == "/tags expected at least 1 items" &&
+                                runSchema(schema, "{\"id\":2,\"tags\":[\"a\",\"b\",\"c\",\"d\"]}") ==
+                                    "/tags expected at most 3 items"));
+    results.push_back(check("Schema: false schema",
+                            runSchema(schema, "{\"id\":2,\"tags\":[\"x\"],\"never\":0}") ==
+                                "/never expected nothing (false schema)"));
+    results.push_back(check("Schema: syntax errors are not violations",
+                            runSchema(schema, "{\"id\":2,\"tags\":[\"x\"],}") == "invalid"));
+    bool threw = false;
+    try {
+        Schema bad("{\"type\":\"string\",\"pattern\":\"^a\"}");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    results.push_back(check("Schema: unsupported keywords are rejected", threw));
+    return results;
+}
+
+struct BoundAddress {
+    std::string city;
+    std::string zip;
+};
+JSON_BIND(BoundAddress, JSON_FIELD(city), JSON_FIELD(zip))
+
+struct BoundRecord {
+    uint32_t id = 0;
+    std::string name;
+    bool active = false;
+    std::vector<int16_t> scores;
+    double ratio = 0;
+    BoundAddress address;
+    std::vector<BoundAddress> previous;
+};
+JSON_BIND(BoundRecord, JSON_FIELD(id), JSON_FIELD(name), JSON_FIELD(active), JSON_FIELD(scores),
+          JSON_FIELD(ratio), JSON_FIELD(address), JSON_FIELD(previous))
+
+struct BoundTree {
+    int value = 0;
+    std::vector<BoundTree> children;
+};
+JSON_BIND(BoundTree, JSON_FIELD(value), JSON_FIELD(children))
+
+struct BoundDuplicate {
+    int a = 0;
+    int b = 0;
+};
+JSON_BIND(BoundDuplicate, jsonField("\"a\"", &BoundType::a), jsonField("\"a\"", &BoundType::b))
+
+static std::vector<bool> runBindingChecks() {
+    std::vector<bool> results;
+    std::string json = "{\"id\":7,\"name\":\"Ann \\\"A\\\"\",\"active\":true,\"scores\":[1,-2,300],"
+                       "\"ratio\":0.25,\"address\":{\"city\":\"Springfield\",\"zip\":\"12345\"},"
+                       "\"previous\":[{\"city\":\"\",\"zip\":\"1\"},{\"city\":\"X\",\"zip\":\"2\"}]}";
+    BoundRecord record;
+    bool ok = fromJson(json.data(), json.size(), record);
+    results.push_back(check("Binding: reads every member type",
+                            ok && record.id == 7 && record.name == "Ann \"A\"" && record.active &&
+                                record.scores == std::vector<int16_t>{1, -2, 300} && record.ratio == 0.25 &&
+                                record.address.city == "Springfield" && record.previous.size() == 2 &&
+                                record.previous[0].zip == "1" && record.previous[1].zip == "2"));
+    OutputBuffer out;
+    toJson(record, out);
+    results.push_back(check("Binding: writes back the same document, members in binding order", std::string(out.data(), out.size()) == json));
+
+    BoundRecord other;
+    std::string unknown = "{\"extra\":[{\"deep\":[1,{\"x\":null}]},\"s\"],\"i\\u0064\":9,\"empty\":{},\"id\":3}";
+    results.push_back(check("Binding: skips unknown keys, decodes escaped ones",
+                            fromJson(unknown.data(), unknown.size(), other) && other.id == 3 && other.name.empty()));
+    auto rejects = [](const std::string& text) {
+        BoundRecord r;
+        return !fromJson(text.data(), text.size(), r);
+    };
+    results.push_back(check("Binding: wrong types and out-of-range integers",
+                            rejects("{\"id\":\"7\"}") && rejects("{\"id\":-1}") && rejects("{\"id\":1.5}") &&
+                                rejects("{\"id\":4294967296}") && rejects("{\"scores\":[32768]}") &&
+                                rejects("{\"active\":1}") && rejects("{\"address\":[]}")));
+    results.push_back(check("Binding: syntax errors, also in skipped values",
+                            rejects("{\"id\":1,}") && rejects("{\"id\":1} x") && rejects("{\"x\":[1,}") &&
+                                rejects("{\"x\":{\"a\" 1}}") && rejects("{\"x\":[1}") && rejects("[]")));
+
+    std::string deep;
+    for (int i = 0; i < 2000; ++i)
+        deep += "{\"children\":[";
+    BoundTree tree;
+    std::string shallow = "{\"value\":1,\"children\":[{\"value\":2,\"children\":[]},{\"value\":3}]}";
+    results.push_back(check("Binding: recursive types, depth limited",
+                            fromJson(shallow.data(), shallow.size(), tree) && tree.children.size() == 2 &&
+                                tree.children[1].value == 3 && !fromJson(deep.data(), deep.size(), tree) &&
+                                !rejects("{\"x\":" + std::string(1000, '[') + std::string(1000, ']') + "}") &&
+                                rejects("{\"x\":" + std::string(1024, '[') + std::string(1024, ']') + "}")));
+
+    bool threw = false;
+    try {
+        BoundDuplicate d;
+        fromJson("{}", 2, d);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    results.push_back(check("Binding: duplicate keys are rejected", threw));
+    return results;
+}
+
 int main() {
     std::vector<TestCase> cases = {
         // Fixture-based tests from provided steps
@@ -85,7 +691,26 @@ int main() {
         {"Inline: missing colon", "", "{\"a\" 1}", false},
         {"Inline: missing closing brace", "", "{\"a\":1", false},
         {"Inline: invalid top-level (array)", "", "[1,2,3]", false}, // top-level must be object per parser.parse
-        {"Inline: invalid token", "", "{\"a\":@}", false}
+        {"Inline: invalid token", "", "{\"a\":@}", false},
+        {"Inline: number grammar", "", "{\"n\":[-1,0,-0,0.5,-12.25e3,1E+2,4e-07,1e400]}", true},
+        {"Inline: bare minus", "", "{\"n\":-}", false},
+        {"Inline: leading zero", "", "{\"n\":01}", false},
+        {"Inline: leading plus", "", "{\"n\":+1}", false},
+        {"Inline: fraction without digits", "", "{\"n\":1.}", false},
+        {"Inline: fraction without integer", "", "{\"n\":.5}", false},
+        {"Inline: exponent without digits", "", "{\"n\":1e+}", false},
+        {"Inline: two fractions", "", "{\"n\":1.2.3}", false},
+        {"Inline: string escapes", "", "{\"s\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\"}", true},
+        {"Inline: UTF-8 text", "", "{\"s\":\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"}", true},
+        {"Inline: unknown escape", "", "{\"s\":\"\\x\"}", false},
+        {"Inline: short \\u escape", "", "{\"s\":\"\\u12\"}", false},
+        {"Inline: lone high surrogate", "", "{\"s\":\"\\ud83d\"}", false},
+        {"Inline: lone low surrogate", "", "{\"s\":\"\\ude00\"}", false},
+        {"Inline: raw control character", "", "{\"s\":\"a\tb\"}", false},
+        {"Inline: overlong UTF-8", "", "{\"s\":\"\xc0\xaf\"}", false},
+        {"Inline: UTF-8 surrogate", "", "{\"s\":\"\xed\xa0\x80\"}", false},
+        {"Inline: truncated UTF-8", "", "{\"s\":\"\xe2\x82\"}", false},
+        {"Inline: invalid key string", "", "{\"\\q\":1}", false}
     };
 
     int passed = 0;
@@ -103,6 +728,40 @@ int main() {
         if (ok) ++passed; else ++failed;
     }
 
+    for (bool ok : runDomChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runIndexChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runInputChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runStreamChecks(cases)) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runNdjsonChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runDepthChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runNumberChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runQueryChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runWriterChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runSchemaChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+    for (bool ok : runBindingChecks()) {
+        if (ok) ++passed; else ++failed;
+    }
+
     std::cout << "\nSummary: " << passed << " passed, " << failed << " failed\n";
     return failed == 0 ? 0 : 1;
 }